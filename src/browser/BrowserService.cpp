@@ -18,7 +18,6 @@
  */
 
 #include <QCheckBox>
-#include <QHostAddress>
 #include <QInputDialog>
 #include <QJsonArray>
 #include <QMessageBox>
@@ -34,6 +33,7 @@
 #include "BrowserSettings.h"
 #include "core/Database.h"
 #include "core/EntrySearcher.h"
+#include "core/EntryUrlIndex.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
 #include "core/PasswordGenerator.h"
@@ -585,32 +585,35 @@ BrowserService::searchEntries(const QSharedPointer<Database>& db, const QString&
         return entries;
     }
 
-    for (const auto& group : rootGroup->groupsRecursive(true)) {
-        if (group->isRecycled() || !group->resolveSearchingEnabled()) {
-            continue;
+    // Only entries on the base domain of the site can match. Local files and
+    // the keepassxc:// lookups are matched against every entry instead.
+    QList<Entry*> candidates;
+    if (siteUrlStr.startsWith("file://") || siteUrlStr.startsWith("keepassxc://")) {
+        const QList<Group*> groups = rootGroup->groupsRecursive(true);
+        for (const auto& group : groups) {
+            candidates.append(group->entries());
         }
+    } else {
+        candidates = db->urlIndex()->entries(rootGroup, baseDomain(QUrl(siteUrlStr).host()));
+    }
 
-        for (auto* entry : group->entries()) {
-            if (entry->isRecycled()) {
-                continue;
-            }
-
-            // Search for additional URL's starting with KP2A_URL
-            for (const auto& key : entry->attributes()->keys()) {
-                if (key.startsWith(ADDITIONAL_URL) && handleURL(entry->attributes()->value(key), siteUrlStr, formUrlStr)
-                    && !entries.contains(entry)) {
-                    entries.append(entry);
-                    continue;
-                }
-            }
+    for (auto* entry : asConst(candidates)) {
+        const auto* group = entry->group();
+        if (group->isRecycled() || !group->resolveSearchingEnabled() || entry->isRecycled()) {
+            continue;
+        }
 
-            if (!handleEntry(entry, siteUrlStr, formUrlStr)) {
-                continue;
-            }
+        if (handleEntry(entry, siteUrlStr, formUrlStr)) {
+            entries.append(entry);
+            continue;
+        }
 
-            // Additional URL check may have already inserted the entry to the list
-            if (!entries.contains(entry)) {
+        // Search for additional URL's starting with KP2A_URL
+        const QList<QString> keys = entry->attributes()->keys();
+        for (const auto& key : keys) {
+            if (key.startsWith(ADDITIONAL_URL) && handleURL(entry->attributes()->value(key), siteUrlStr, formUrlStr)) {
                 entries.append(entry);
+                break;
             }
         }
     }
@@ -649,13 +652,10 @@ BrowserService::searchEntries(const QString& siteUrlStr, const QString& formUrlS
     }
 
     // Search entries matching the hostname
-    QString hostname = QUrl(siteUrlStr).host();
     QList<Entry*> entries;
-    do {
-        for (const auto& db : databases) {
-            entries << searchEntries(db, siteUrlStr, formUrlStr);
-        }
-    } while (entries.isEmpty() && removeFirstDomain(hostname));
+    for (const auto& db : databases) {
+        entries << searchEntries(db, siteUrlStr, formUrlStr);
+    }
 
     return entries;
 }
@@ -725,7 +725,8 @@ void BrowserService::convertAttributesToCustomData(QSharedPointer<Database> db)
         return;
     }
 
-    for (auto* g : rootGroup->groupsRecursive(true)) {
+    const QList<Group*> groups = rootGroup->groupsRecursive(true);
+    for (auto* g : groups) {
         if (g->name() == KEEPASSHTTP_GROUP_NAME) {
             g->setName(KEEPASSXCBROWSER_GROUP_NAME);
             break;
@@ -899,7 +900,8 @@ Group* BrowserService::getDefaultEntryGroup(const QSharedPointer<Database>& sele
         return nullptr;
     }
 
-    for (auto* g : rootGroup->groupsRecursive(true)) {
+    const QList<Group*> groups = rootGroup->groupsRecursive(true);
+    for (auto* g : groups) {
         if (g->name() == KEEPASSXCBROWSER_GROUP_NAME && !g->isRecycled()) {
             return db->rootGroup()->findGroupByUuid(g->uuid());
         }
@@ -987,23 +989,6 @@ bool BrowserService::schemeFound(const QString& url)
     return !address.scheme().isEmpty();
 }
 
-bool BrowserService::removeFirstDomain(QString& hostname)
-{
-    int pos = hostname.indexOf(".");
-    if (pos < 0) {
-        return false;
-    }
-
-    // Don't remove the second-level domain if it's the only one
-    if (hostname.count(".") > 1) {
-        hostname = hostname.mid(pos + 1);
-        return !hostname.isEmpty();
-    }
-
-    // Nothing removed
-    return false;
-}
-
 /* Test if a search URL matches a custom entry. If the URL has the schema "keepassxc", some special checks will be made.
  * Otherwise, this simply delegates to handleURL(). */
 bool BrowserService::handleEntry(Entry* entry, const QString& url, const QString& submitUrl)
@@ -1082,26 +1067,7 @@ bool BrowserService::handleURL(const QString& entryUrl, const QString& siteUrlSt
  */
 QString BrowserService::baseDomain(const QString& hostname) const
 {
-    QUrl qurl = QUrl::fromUserInput(hostname);
-    QString host = qurl.host();
-
-    // If the hostname is an IP address, return it directly
-    QHostAddress hostAddress(hostname);
-    if (!hostAddress.isNull()) {
-        return hostname;
-    }
-
-    if (host.isEmpty() || !host.contains(qurl.topLevelDomain())) {
-        return {};
-    }
-
-    // Remove the top level domain part from the hostname, e.g. https://another.example.co.uk -> https://another.example
-    host.chop(qurl.topLevelDomain().length());
-    // Split the URL and select the last part, e.g. https://another.example -> example
-    QString baseDomain = host.split('.').last();
-    // Append the top level domain back to the URL, e.g. example -> example.co.uk
-    baseDomain.append(qurl.topLevelDomain());
-    return baseDomain;
+    return Tools::baseDomain(hostname);
 }
 
 QSharedPointer<Database> BrowserService::getDatabase()
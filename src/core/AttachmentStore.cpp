@@ -0,0 +1,355 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AttachmentStore.h"
+
+#include "crypto/CryptoHash.h"
+#include "crypto/Random.h"
+#include "crypto/SymmetricCipher.h"
+
+#include <QDir>
+#include <QTemporaryFile>
+
+const int AttachmentStore::DefaultSpillThreshold = 1024 * 1024;
+const int AttachmentStore::DefaultCacheSize = 32 * 1024 * 1024;
+
+AttachmentStore* AttachmentStore::s_instance(nullptr);
+
+struct AttachmentStore::Blob::Data
+{
+    ~Data()
+    {
+        if (s_instance) {
+            s_instance->release(*this);
+        }
+    }
+
+    QByteArray digest;
+    int size = 0;
+
+    // in-memory data, empty if the blob was spilled
+    QByteArray data;
+
+    // location and key of spilled data
+    qint64 offset = -1;
+    QByteArray key;
+    QByteArray iv;
+    quint64 id = 0;
+};
+
+bool AttachmentStore::Blob::isNull() const
+{
+    return d.isNull();
+}
+
+int AttachmentStore::Blob::size() const
+{
+    return d ? d->size : 0;
+}
+
+/**
+ * SHA-256 digest of the attachment data, which identifies it in the store.
+ */
+QByteArray AttachmentStore::Blob::digest() const
+{
+    return d ? d->digest : QByteArray();
+}
+
+/**
+ * Get the attachment data, decrypting it from the spill file if necessary.
+ * Returns an empty array if the spill file cannot be read, use the overload
+ * taking an output argument where this must be detected.
+ */
+QByteArray AttachmentStore::Blob::data() const
+{
+    QByteArray blobData;
+    data(blobData);
+    return blobData;
+}
+
+/**
+ * Get the attachment data, decrypting it from the spill file if necessary.
+ *
+ * @param data receives the attachment data
+ * @return false if the data could not be read from the spill file
+ */
+bool AttachmentStore::Blob::data(QByteArray& data) const
+{
+    if (!d) {
+        data.clear();
+        return true;
+    }
+    if (d->offset < 0 || !s_instance) {
+        data = d->data;
+        return true;
+    }
+    return s_instance->load(*d, data);
+}
+
+bool AttachmentStore::Blob::operator==(const Blob& other) const
+{
+    if (d == other.d) {
+        return true;
+    }
+    if (!d || !other.d) {
+        return false;
+    }
+    return d->size == other.d->size && d->digest == other.d->digest;
+}
+
+bool AttachmentStore::Blob::operator!=(const Blob& other) const
+{
+    return !(*this == other);
+}
+
+AttachmentStore::AttachmentStore()
+    : m_spillThreshold(DefaultSpillThreshold)
+    , m_cache(DefaultCacheSize)
+    , m_lastId(0)
+{
+    s_instance = this;
+}
+
+AttachmentStore::~AttachmentStore()
+{
+    s_instance = nullptr;
+}
+
+AttachmentStore* AttachmentStore::instance()
+{
+    static AttachmentStore store;
+    return &store;
+}
+
+/**
+ * Store attachment data.
+ *
+ * If identical data is already stored, a handle to the existing copy is
+ * returned. Otherwise data at or above the spill threshold is encrypted into
+ * the spill file. If spilling fails for any reason the data is kept in memory
+ * instead.
+ *
+ * @param data attachment data
+ * @return handle to the stored data
+ */
+AttachmentStore::Blob AttachmentStore::store(const QByteArray& data)
+{
+    const QByteArray digest = CryptoHash::hash(data, CryptoHash::Sha256);
+
+    Blob blob;
+    {
+        QMutexLocker locker(&m_mutex);
+        blob.d = m_blobs.value(digest).toStrongRef();
+    }
+    if (blob.d) {
+        return blob;
+    }
+
+    auto blobData = QSharedPointer<Blob::Data>::create();
+    blobData->digest = digest;
+    blobData->size = data.size();
+
+    if (data.size() < spillThreshold() || !spill(data, *blobData)) {
+        blobData->data = data;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // another thread may have stored the same data in the meantime
+    blob.d = m_blobs.value(digest).toStrongRef();
+    if (!blob.d) {
+        blob.d = blobData;
+        m_blobs.insert(digest, blob.d);
+    }
+    return blob;
+}
+
+/**
+ * Number of distinct attachments currently referenced.
+ */
+int AttachmentStore::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_blobs.size();
+}
+
+/**
+ * Size of the spill file, including the space of released attachments
+ * that has not been reused yet.
+ */
+qint64 AttachmentStore::spillFileSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_spillFile ? m_spillFile->size() : 0;
+}
+
+int AttachmentStore::spillThreshold() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_spillThreshold;
+}
+
+/**
+ * Set the minimum size of attachments that are moved to the spill file.
+ * Only affects attachments stored afterwards.
+ */
+void AttachmentStore::setSpillThreshold(int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_spillThreshold = bytes;
+}
+
+/**
+ * Set the maximum number of bytes of decrypted attachments kept in memory.
+ */
+void AttachmentStore::setCacheSize(int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(bytes);
+}
+
+bool AttachmentStore::spill(const QByteArray& data, Blob::Data& blob)
+{
+    QByteArray key = randomGen()->randomArray(32);
+    QByteArray iv = randomGen()->randomArray(SymmetricCipher::algorithmIvSize(SymmetricCipher::ChaCha20));
+
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+    QByteArray encrypted = data;
+    if (!cipher.init(key, iv) || !cipher.processInPlace(encrypted)) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_spillFile) {
+        m_spillFile.reset(new QTemporaryFile(QDir::tempPath() + "/keepassxc-spill-XXXXXX"));
+        if (!m_spillFile->open()) {
+            qWarning("AttachmentStore: Failed to create spill file: %s", qPrintable(m_spillFile->errorString()));
+            m_spillFile.reset();
+            return false;
+        }
+    }
+
+    const qint64 offset = allocateSpillRange(encrypted.size());
+    if (!m_spillFile->seek(offset) || m_spillFile->write(encrypted) != encrypted.size()) {
+        qWarning("AttachmentStore: Failed to write spill file: %s", qPrintable(m_spillFile->errorString()));
+        releaseSpillRange(offset, encrypted.size());
+        return false;
+    }
+
+    blob.offset = offset;
+    blob.key = key;
+    blob.iv = iv;
+    blob.id = ++m_lastId;
+    return true;
+}
+
+bool AttachmentStore::load(const Blob::Data& blob, QByteArray& data)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (QByteArray* cached = m_cache.object(blob.id)) {
+        data = *cached;
+        return true;
+    }
+
+    data.clear();
+    if (m_spillFile && m_spillFile->seek(blob.offset)) {
+        data = m_spillFile->read(blob.size);
+    }
+    locker.unlock();
+
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Decrypt);
+    if (data.size() != blob.size || !cipher.init(blob.key, blob.iv) || !cipher.processInPlace(data)) {
+        qWarning("AttachmentStore: Failed to read attachment from spill file.");
+        data.clear();
+        return false;
+    }
+
+    locker.relock();
+    m_cache.insert(blob.id, new QByteArray(data), data.size());
+    return true;
+}
+
+void AttachmentStore::release(const Blob::Data& blob)
+{
+    QMutexLocker locker(&m_mutex);
+    if (blob.offset >= 0) {
+        m_cache.remove(blob.id);
+        releaseSpillRange(blob.offset, blob.size);
+    }
+
+    // the digest may already refer to a newer blob with the same data
+    auto it = m_blobs.find(blob.digest);
+    if (it != m_blobs.end() && !it.value().toStrongRef()) {
+        m_blobs.erase(it);
+    }
+}
+
+/**
+ * Find space for data in the spill file, reusing the first released range
+ * that is large enough. Must be called with the mutex locked.
+ *
+ * @param size size of the data
+ * @return offset of the data in the spill file
+ */
+qint64 AttachmentStore::allocateSpillRange(qint64 size)
+{
+    for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+        if (it.value() >= size) {
+            const qint64 offset = it.key();
+            const qint64 remaining = it.value() - size;
+            m_freeRanges.erase(it);
+            if (remaining > 0) {
+                m_freeRanges.insert(offset + size, remaining);
+            }
+            return offset;
+        }
+    }
+    return m_spillFile->size();
+}
+
+/**
+ * Mark a range of the spill file as unused. Adjacent free ranges are merged
+ * and free space at the end of the file is truncated. Must be called with
+ * the mutex locked.
+ */
+void AttachmentStore::releaseSpillRange(qint64 offset, qint64 size)
+{
+    if (!m_spillFile || size <= 0) {
+        return;
+    }
+
+    auto next = m_freeRanges.lowerBound(offset);
+    if (next != m_freeRanges.end() && next.key() == offset + size) {
+        size += next.value();
+        next = m_freeRanges.erase(next);
+    }
+    if (next != m_freeRanges.begin()) {
+        auto previous = next;
+        --previous;
+        if (previous.key() + previous.value() == offset) {
+            offset = previous.key();
+            size += previous.value();
+            m_freeRanges.erase(previous);
+        }
+    }
+
+    if (offset + size >= m_spillFile->size() && m_spillFile->resize(offset)) {
+        return;
+    }
+    m_freeRanges.insert(offset, size);
+}
@@ -0,0 +1,107 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_ATTACHMENTSTORE_H
+#define KEEPASSXC_ATTACHMENTSTORE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QSharedPointer>
+
+class QTemporaryFile;
+
+/**
+ * Process-wide, content-addressed storage for attachment data.
+ *
+ * Attachments are keyed by their SHA-256 digest, so identical data stored by
+ * several entries and history items is kept once and reference counted by
+ * the blobs pointing to it.
+ *
+ * Attachments at or above the spill threshold are moved out of memory into a
+ * temporary spill file, each encrypted with its own random in-memory key, and
+ * are only decrypted again when their data is requested. Recently decrypted
+ * attachments are kept in a bounded LRU cache. The space of released
+ * attachments in the spill file is reused.
+ */
+class AttachmentStore
+{
+public:
+    /**
+     * Implicitly shared handle to stored attachment data.
+     */
+    class Blob
+    {
+    public:
+        Blob() = default;
+
+        bool isNull() const;
+        int size() const;
+        QByteArray digest() const;
+        QByteArray data() const;
+        bool data(QByteArray& data) const;
+
+        bool operator==(const Blob& other) const;
+        bool operator!=(const Blob& other) const;
+
+    private:
+        friend class AttachmentStore;
+        struct Data;
+
+        QSharedPointer<const Data> d;
+    };
+
+    ~AttachmentStore();
+    Q_DISABLE_COPY(AttachmentStore)
+
+    static AttachmentStore* instance();
+
+    Blob store(const QByteArray& data);
+    int count() const;
+    qint64 spillFileSize() const;
+
+    int spillThreshold() const;
+    void setSpillThreshold(int bytes);
+    void setCacheSize(int bytes);
+
+    static const int DefaultSpillThreshold;
+    static const int DefaultCacheSize;
+
+private:
+    AttachmentStore();
+
+    bool spill(const QByteArray& data, Blob::Data& blob);
+    bool load(const Blob::Data& blob, QByteArray& data);
+    void release(const Blob::Data& blob);
+    qint64 allocateSpillRange(qint64 size);
+    void releaseSpillRange(qint64 offset, qint64 size);
+
+    static AttachmentStore* s_instance;
+
+    mutable QMutex m_mutex;
+    int m_spillThreshold;
+    QScopedPointer<QTemporaryFile> m_spillFile;
+    QMap<qint64, qint64> m_freeRanges;
+    QCache<quint64, QByteArray> m_cache;
+    QHash<QByteArray, QWeakPointer<const Blob::Data>> m_blobs;
+    quint64 m_lastId;
+};
+
+#endif // KEEPASSXC_ATTACHMENTSTORE_H
@@ -45,6 +45,7 @@ public:
         AutoSaveNonDataChanges,
         BackupBeforeSave,
         UseAtomicSaves,
+        DeletedObjectsMaxAge,
         SearchLimitGroup,
         MinimizeOnOpenUrl,
         HideWindowOnCopy,
@@ -120,6 +121,8 @@ public:
         Security_ResetTouchIdTimeout,
         Security_ResetTouchIdScreenlock,
         Security_NoConfirmMoveEntryToRecycleBin,
+        Security_PrecomputeTransformedKey,
+        Security_UnlockCache,
 
         Browser_Enabled,
         Browser_ShowNotification,
@@ -68,6 +68,8 @@ private slots:
     void updateLastModified();
 
 private:
+    friend class EntrySnapshot;
+
     QHash<QString, QString> m_data;
 };
 
@@ -20,10 +20,15 @@
 
 #include "core/AsyncTask.h"
 #include "core/Clock.h"
+#include "core/EntryReferenceIndex.h"
+#include "core/EntrySearchIndex.h"
+#include "core/EntryUrlIndex.h"
 #include "core/FileWatcher.h"
 #include "core/Group.h"
 #include "core/Merger.h"
 #include "core/Metadata.h"
+#include "format/KdbxSnapshotCache.h"
+#include "format/KdbxXmlEntryCache.h"
 #include "format/KdbxXmlReader.h"
 #include "format/KeePass2Reader.h"
 #include "format/KeePass2Writer.h"
@@ -34,16 +39,48 @@
 #include <QFileInfo>
 #include <QSaveFile>
 #include <QTemporaryFile>
+#include <QThread>
 #include <QTimer>
 #include <QXmlStreamReader>
 
+#include <algorithm>
+
 QHash<QUuid, QPointer<Database>> Database::s_uuidMap;
 
+namespace
+{
+    /**
+     * Copy a group with its entries and subgroups, keeping uuids and times.
+     */
+    Group* cloneGroup(const Group* group, KdbxXmlEntryCache* cache)
+    {
+        Group* clonedGroup = group->clone(Entry::CloneNoFlags, Group::CloneNoFlags);
+        clonedGroup->setUpdateTimeinfo(false);
+
+        for (const Entry* entry : group->entries()) {
+            Entry* clonedEntry = entry->clone(Entry::CloneIncludeHistory);
+            clonedEntry->setUpdateTimeinfo(false);
+            clonedEntry->setGroup(clonedGroup);
+            cache->addAlias(clonedEntry, entry);
+        }
+
+        for (const Group* child : group->children()) {
+            cloneGroup(child, cache)->setParent(clonedGroup);
+        }
+
+        return clonedGroup;
+    }
+} // namespace
+
 Database::Database()
     : m_metadata(new Metadata(this))
     , m_data()
     , m_rootGroup(nullptr)
+    , m_referenceIndex(new EntryReferenceIndex())
+    , m_searchIndex(new EntrySearchIndex())
+    , m_urlIndex(new EntryUrlIndex())
     , m_fileWatcher(new FileWatcher(this))
+    , m_xmlEntryCache(new KdbxXmlEntryCache(this))
     , m_emitModified(false)
     , m_uuid(QUuid::createUuid())
 {
@@ -59,6 +96,7 @@ Database::Database()
     connect(this, SIGNAL(databaseOpened()), SLOT(updateCommonUsernames()));
     connect(this, SIGNAL(databaseSaved()), SLOT(updateCommonUsernames()));
     connect(m_fileWatcher, &FileWatcher::fileChanged, this, &Database::databaseFileChanged);
+    connect(&m_precomputeWatcher, &QFutureWatcherBase::finished, this, &Database::finishKeyPrecomputation);
 
     m_modified = false;
     m_emitModified = true;
@@ -137,6 +175,10 @@ bool Database::open(const QString& filePath, QSharedPointer<const CompositeKey>
     setEmitModified(false);
 
     KeePass2Reader reader;
+    reader.setPipelined(QThread::idealThreadCount() > 1);
+    if (m_unlockCache) {
+        reader.setSnapshotCache(KdbxSnapshotCache::instance(), filePath);
+    }
     if (!reader.readDatabase(&dbFile, std::move(key), this)) {
         if (error) {
             *error = tr("Error while reading the database: %1").arg(reader.errorString());
@@ -149,6 +191,7 @@ bool Database::open(const QString& filePath, QSharedPointer<const CompositeKey>
     dbFile.close();
 
     markAsClean();
+    precomputeNextKey();
 
     emit databaseOpened();
     m_fileWatcher->start(canonicalFilePath(), 30, 1);
@@ -159,6 +202,10 @@ bool Database::open(const QString& filePath, QSharedPointer<const CompositeKey>
 
 bool Database::isSaving()
 {
+    if (m_backgroundSave) {
+        return true;
+    }
+
     bool locked = m_saveMutex.tryLock();
     if (locked) {
         m_saveMutex.unlock();
@@ -208,6 +255,9 @@ bool Database::save(QString* error, bool atomic, bool backup)
  */
 bool Database::saveAs(const QString& filePath, QString* error, bool atomic, bool backup)
 {
+    // A running background save has to complete first
+    waitForBackgroundSave();
+
     // Disallow overlapping save operations
     if (isSaving()) {
         if (error) {
@@ -216,6 +266,112 @@ bool Database::saveAs(const QString& filePath, QString* error, bool atomic, bool
         return false;
     }
 
+    // Prevent destructive operations while saving
+    QMutexLocker locker(&m_saveMutex);
+
+    if (!canSave(filePath, error)) {
+        return false;
+    }
+
+    // Clear read-only flag
+    setReadOnly(false);
+    m_fileWatcher->stop();
+    compactDeletedObjects();
+
+    QFileInfo fileInfo(filePath);
+    auto realFilePath = fileInfo.exists() ? fileInfo.canonicalFilePath() : fileInfo.absoluteFilePath();
+    bool isNewFile = !QFile::exists(realFilePath);
+    bool ok = AsyncTask::runAndWaitForFuture([&] { return performSave(realFilePath, error, atomic, backup); });
+    if (ok) {
+        markAsClean();
+        setFilePath(filePath);
+        precomputeNextKey();
+        if (m_unlockCache) {
+            // the snapshot of the previous file can never match again
+            KdbxSnapshotCache::instance()->remove(realFilePath);
+        }
+        if (isNewFile) {
+            QFile::setPermissions(realFilePath, QFile::ReadUser | QFile::WriteUser);
+        }
+        m_fileWatcher->start(realFilePath, 30, 1);
+    } else {
+        // Saving failed, don't rewatch file since it does not represent our database
+        markAsModified();
+    }
+
+    return ok;
+}
+
+/**
+ * Save the database to its current file without blocking.
+ *
+ * The database is copied and the copy is written on a worker thread,
+ * so the database can be modified while it is being saved. Modifications
+ * made in the meantime keep the database marked as modified.
+ * backgroundSaveFinished() is emitted once the file has been written.
+ *
+ * @param error error message if the save could not be started
+ * @param atomic Use atomic file transactions
+ * @param backup Backup the existing database file, if exists
+ * @return true if the save was started
+ */
+bool Database::saveInBackground(QString* error, bool atomic, bool backup)
+{
+    if (m_data.filePath.isEmpty()) {
+        if (error) {
+            *error = tr("Could not save, database does not point to a valid file.");
+        }
+        return false;
+    }
+
+    if (isSaving()) {
+        if (error) {
+            *error = tr("Database save is already in progress.");
+        }
+        return false;
+    }
+
+    if (!canSave(m_data.filePath, error)) {
+        return false;
+    }
+
+    // Clear read-only flag
+    setReadOnly(false);
+    m_fileWatcher->stop();
+    compactDeletedObjects();
+
+    m_backgroundSave.reset(new BackgroundSave());
+    auto save = m_backgroundSave.data();
+    save->snapshot.reset(createSnapshot());
+    // the snapshot uses the precomputed key, this database must not reuse its seed
+    m_precomputedKey.reset();
+    save->key = m_data.key;
+    save->kdf = m_data.kdf;
+    save->filePath = m_data.filePath;
+
+    QFileInfo fileInfo(save->filePath);
+    save->realFilePath = fileInfo.exists() ? fileInfo.canonicalFilePath() : fileInfo.absoluteFilePath();
+    save->isNewFile = !QFile::exists(save->realFilePath);
+
+    Database* snapshot = save->snapshot.data();
+    QString* saveError = &save->error;
+    const QString realFilePath = save->realFilePath;
+    connect(&save->watcher, &QFutureWatcherBase::finished, this, &Database::finishBackgroundSave);
+    save->watcher.setFuture(
+        QtConcurrent::run([=] { return snapshot->performSave(realFilePath, saveError, atomic, backup); }));
+
+    return true;
+}
+
+/**
+ * Check whether the database may be saved to the given file.
+ *
+ * @param filePath Absolute path of the file to save
+ * @param error error message in case of failure
+ * @return true if saving is allowed
+ */
+bool Database::canSave(const QString& filePath, QString* error)
+{
     // Never save an uninitialized database
     if (!isInitialized()) {
         if (error) {
@@ -224,9 +380,6 @@ bool Database::saveAs(const QString& filePath, QString* error, bool atomic, bool
         return false;
     }
 
-    // Prevent destructive operations while saving
-    QMutexLocker locker(&m_saveMutex);
-
     if (filePath == m_data.filePath) {
         // Disallow saving to the same file if read-only
         if (m_data.isReadOnly) {
@@ -247,27 +400,113 @@ bool Database::saveAs(const QString& filePath, QString* error, bool atomic, bool
         }
     }
 
-    // Clear read-only flag
-    setReadOnly(false);
-    m_fileWatcher->stop();
+    return true;
+}
 
-    QFileInfo fileInfo(filePath);
-    auto realFilePath = fileInfo.exists() ? fileInfo.canonicalFilePath() : fileInfo.absoluteFilePath();
-    bool isNewFile = !QFile::exists(realFilePath);
-    bool ok = AsyncTask::runAndWaitForFuture([&] { return performSave(realFilePath, error, atomic, backup); });
+/**
+ * Copy the database for saving it in the background.
+ *
+ * Entries share their attribute and attachment data with the originals,
+ * so this is cheap compared to serializing the database. All times are
+ * kept as they are and the entries use the XML cache of this database.
+ */
+Database* Database::createSnapshot() const
+{
+    auto snapshot = new Database();
+    snapshot->setEmitModified(false);
+    s_uuidMap.remove(snapshot->m_uuid);
+
+    snapshot->m_data.filePath = m_data.filePath;
+    snapshot->m_data.cipher = m_data.cipher;
+    snapshot->m_data.compressionAlgorithm = m_data.compressionAlgorithm;
+    snapshot->m_data.key = m_data.key;
+    snapshot->m_data.kdf = m_data.kdf->clone();
+    snapshot->m_data.publicCustomData = m_data.publicCustomData;
+    snapshot->m_data.masterSeed->setHash(m_data.masterSeed->rawKey());
+    snapshot->m_data.transformedDatabaseKey->setHash(m_data.transformedDatabaseKey->rawKey());
+    snapshot->m_data.challengeResponseKey->setHash(m_data.challengeResponseKey->rawKey());
+    snapshot->m_precomputedKey = m_precomputedKey;
+
+    // snapshots share the entry cache of their database
+    delete snapshot->m_xmlEntryCache.data();
+    snapshot->m_xmlEntryCache = m_xmlEntryCache;
+
+    snapshot->setRootGroup(cloneGroup(m_rootGroup, m_xmlEntryCache));
+    snapshot->m_deletedObjects = m_deletedObjects;
+    snapshot->m_deletedObjectIndex = m_deletedObjectIndex;
+
+    auto findGroup = [snapshot](const Group* group) -> Group* {
+        return group ? snapshot->rootGroup()->findGroupByUuid(group->uuid()) : nullptr;
+    };
+
+    Metadata* meta = snapshot->metadata();
+    meta->setUpdateDatetime(false);
+    meta->copyAttributesFrom(m_metadata);
+    for (const QUuid& uuid : m_metadata->customIconsOrder()) {
+        meta->addCustomIcon(uuid, m_metadata->customIcon(uuid));
+    }
+    meta->customData()->copyDataFrom(m_metadata->customData());
+    meta->setRecycleBin(findGroup(m_metadata->recycleBin()));
+    meta->setRecycleBinChanged(m_metadata->recycleBinChanged());
+    meta->setEntryTemplatesGroup(findGroup(m_metadata->entryTemplatesGroup()));
+    meta->setEntryTemplatesGroupChanged(m_metadata->entryTemplatesGroupChanged());
+    meta->setLastSelectedGroup(findGroup(m_metadata->lastSelectedGroup()));
+    meta->setLastTopVisibleGroup(findGroup(m_metadata->lastTopVisibleGroup()));
+    meta->setDatabaseKeyChanged(m_metadata->databaseKeyChanged());
+    meta->setSettingsChanged(m_metadata->settingsChanged());
+
+    return snapshot;
+}
+
+void Database::finishBackgroundSave()
+{
+    if (!m_backgroundSave) {
+        return;
+    }
+
+    QScopedPointer<BackgroundSave> save(m_backgroundSave.take());
+    m_xmlEntryCache->clearAliases();
+
+    bool ok = save->watcher.result();
     if (ok) {
-        markAsClean();
-        setFilePath(filePath);
-        if (isNewFile) {
-            QFile::setPermissions(realFilePath, QFile::ReadUser | QFile::WriteUser);
+        // Take over the new seeds written to the file, unless the key was changed in the meantime
+        if (m_data.key == save->key && m_data.kdf == save->kdf) {
+            const DatabaseData& data = save->snapshot->m_data;
+            m_data.kdf = data.kdf;
+            m_data.masterSeed->setHash(data.masterSeed->rawKey());
+            m_data.transformedDatabaseKey->setHash(data.transformedDatabaseKey->rawKey());
+            m_data.challengeResponseKey->setHash(data.challengeResponseKey->rawKey());
         }
-        m_fileWatcher->start(realFilePath, 30, 1);
-    } else {
-        // Saving failed, don't rewatch file since it does not represent our database
-        markAsModified();
+        precomputeNextKey();
+        if (m_unlockCache) {
+            // the snapshot of the previous file can never match again
+            KdbxSnapshotCache::instance()->remove(save->realFilePath);
+        }
+
+        if (save->modified) {
+            // Changes made while saving still have to be saved
+            startModifiedTimer();
+        } else {
+            markAsClean();
+        }
+
+        if (save->isNewFile) {
+            QFile::setPermissions(save->realFilePath, QFile::ReadUser | QFile::WriteUser);
+        }
+        m_fileWatcher->start(save->realFilePath, 30, 1);
     }
+    // If saving failed, the file is not rewatched since it does not represent our database.
+    // The database stays modified, but the save is not retried until the next change.
 
-    return ok;
+    emit backgroundSaveFinished(ok, save->error);
+}
+
+void Database::waitForBackgroundSave()
+{
+    if (m_backgroundSave) {
+        m_backgroundSave->watcher.waitForFinished();
+        finishBackgroundSave();
+    }
 }
 
 bool Database::performSave(const QString& filePath, QString* error, bool atomic, bool backup)
@@ -422,6 +661,8 @@ bool Database::import(const QString& xmlExportPath, QString* error)
 
 void Database::releaseData()
 {
+    waitForBackgroundSave();
+
     // Prevent data release while saving
     QMutexLocker locker(&m_saveMutex);
 
@@ -436,14 +677,19 @@ void Database::releaseData()
     s_uuidMap.remove(m_uuid);
     m_uuid = QUuid();
 
+    m_precomputedKey.reset();
     m_data.clear();
     m_metadata->clear();
 
     setRootGroup(new Group());
 
     m_fileWatcher->stop();
+    if (m_xmlEntryCache && m_xmlEntryCache->parent() == this) {
+        m_xmlEntryCache->clear();
+    }
 
     m_deletedObjects.clear();
+    m_deletedObjectIndex.clear();
     m_commonUsernames.clear();
 }
 
@@ -538,10 +784,39 @@ void Database::setRootGroup(Group* group)
         emit databaseDiscarded();
     }
 
+    m_referenceIndex->clear();
+    m_searchIndex->clear();
+    m_urlIndex->clear();
     m_rootGroup = group;
     m_rootGroup->setParent(this);
 }
 
+void Database::indexEntry(Entry* entry)
+{
+    m_entryIndex.insert(entry->uuid(), entry);
+    m_referenceIndex->addEntry(entry);
+    m_searchIndex->addEntry(entry);
+    m_urlIndex->addEntry(entry);
+}
+
+void Database::unindexEntry(Entry* entry)
+{
+    m_entryIndex.remove(entry->uuid(), entry);
+    m_referenceIndex->removeEntry(entry);
+    m_searchIndex->removeEntry(entry);
+    m_urlIndex->removeEntry(entry);
+}
+
+void Database::indexGroup(Group* group)
+{
+    m_groupIndex.insert(group->uuid(), group);
+}
+
+void Database::unindexGroup(Group* group)
+{
+    m_groupIndex.remove(group->uuid(), group);
+}
+
 Metadata* Database::metadata()
 {
     return m_metadata;
@@ -582,6 +857,7 @@ void Database::setFilePath(const QString& filePath)
     if (filePath != m_data.filePath) {
         QString oldPath = m_data.filePath;
         m_data.filePath = filePath;
+        m_referenceIndex->invalidate();
         // Don't watch for changes until the next open or save operation
         m_fileWatcher->stop();
         emit filePathChanged(oldPath, filePath);
@@ -600,22 +876,62 @@ const QList<DeletedObject>& Database::deletedObjects() const
 
 bool Database::containsDeletedObject(const QUuid& uuid) const
 {
-    for (const DeletedObject& currentObject : m_deletedObjects) {
-        if (currentObject.uuid == uuid) {
-            return true;
-        }
-    }
-    return false;
+    return m_deletedObjectIndex.contains(uuid);
 }
 
 bool Database::containsDeletedObject(const DeletedObject& object) const
 {
-    for (const DeletedObject& currentObject : m_deletedObjects) {
-        if (currentObject.uuid == object.uuid) {
-            return true;
+    return m_deletedObjectIndex.contains(object.uuid);
+}
+
+/**
+ * Remove the deleted object with the given uuid.
+ * Removing the most recently added object is cheap.
+ *
+ * @return true if the object was found
+ */
+bool Database::removeDeletedObject(const QUuid& uuid)
+{
+    auto it = m_deletedObjectIndex.find(uuid);
+    if (it == m_deletedObjectIndex.end()) {
+        return false;
+    }
+
+    const int index = it.value();
+    m_deletedObjectIndex.erase(it);
+    m_deletedObjects.removeAt(index);
+    for (int i = index; i < m_deletedObjects.size(); ++i) {
+        m_deletedObjectIndex[m_deletedObjects.at(i).uuid] = i;
+    }
+    return true;
+}
+
+/**
+ * Remove the deleted objects with the given uuids in a single pass.
+ * Use this instead of removeDeletedObject() when removing many objects.
+ *
+ * @return number of removed objects
+ */
+int Database::removeDeletedObjects(const QSet<QUuid>& uuids)
+{
+    if (uuids.isEmpty()) {
+        return 0;
+    }
+
+    const int oldSize = m_deletedObjects.size();
+    m_deletedObjects.erase(std::remove_if(m_deletedObjects.begin(),
+                                          m_deletedObjects.end(),
+                                          [&](const DeletedObject& delObj) { return uuids.contains(delObj.uuid); }),
+                           m_deletedObjects.end());
+    const int removed = oldSize - m_deletedObjects.size();
+    if (removed > 0) {
+        m_deletedObjectIndex.clear();
+        m_deletedObjectIndex.reserve(m_deletedObjects.size());
+        for (int i = 0; i < m_deletedObjects.size(); ++i) {
+            m_deletedObjectIndex.insert(m_deletedObjects.at(i).uuid, i);
         }
     }
-    return false;
+    return removed;
 }
 
 void Database::setDeletedObjects(const QList<DeletedObject>& delObjs)
@@ -623,13 +939,78 @@ void Database::setDeletedObjects(const QList<DeletedObject>& delObjs)
     if (m_deletedObjects == delObjs) {
         return;
     }
-    m_deletedObjects = delObjs;
+
+    m_deletedObjects.clear();
+    m_deletedObjectIndex.clear();
+    m_deletedObjects.reserve(delObjs.size());
+    m_deletedObjectIndex.reserve(delObjs.size());
+    for (const DeletedObject& delObj : delObjs) {
+        insertDeletedObject(delObj);
+    }
 }
 
 void Database::addDeletedObject(const DeletedObject& delObj)
 {
     Q_ASSERT(delObj.deletionTime.timeSpec() == Qt::UTC);
-    m_deletedObjects.append(delObj);
+    insertDeletedObject(delObj);
+}
+
+void Database::insertDeletedObject(const DeletedObject& delObj)
+{
+    auto it = m_deletedObjectIndex.constFind(delObj.uuid);
+    if (it == m_deletedObjectIndex.constEnd()) {
+        m_deletedObjectIndex.insert(delObj.uuid, m_deletedObjects.size());
+        m_deletedObjects.append(delObj);
+        return;
+    }
+
+    // an object is recorded once, with the time it was first deleted
+    DeletedObject& existing = m_deletedObjects[it.value()];
+    if (delObj.deletionTime < existing.deletionTime) {
+        existing.deletionTime = delObj.deletionTime;
+    }
+}
+
+/**
+ * Maximum age in days of the deleted objects kept when saving,
+ * 0 if they are kept forever.
+ */
+int Database::deletedObjectsMaxAge() const
+{
+    return m_deletedObjectsMaxAge;
+}
+
+void Database::setDeletedObjectsMaxAge(int days)
+{
+    m_deletedObjectsMaxAge = qMax(0, days);
+}
+
+/**
+ * Forget the deleted objects older than the maximum age. Databases
+ * synchronized after that may bring the deleted objects back.
+ *
+ * @return number of removed deleted objects
+ */
+int Database::compactDeletedObjects()
+{
+    if (m_deletedObjectsMaxAge <= 0 || m_deletedObjects.isEmpty()) {
+        return 0;
+    }
+
+    const QDateTime limit = Clock::currentDateTimeUtc().addDays(-m_deletedObjectsMaxAge);
+    QList<DeletedObject> deletedObjects;
+    deletedObjects.reserve(m_deletedObjects.size());
+    for (const DeletedObject& delObj : asConst(m_deletedObjects)) {
+        if (delObj.deletionTime >= limit) {
+            deletedObjects.append(delObj);
+        }
+    }
+
+    const int removed = m_deletedObjects.size() - deletedObjects.size();
+    if (removed > 0) {
+        setDeletedObjects(deletedObjects);
+    }
+    return removed;
 }
 
 void Database::addDeletedObject(const QUuid& uuid)
@@ -667,6 +1048,32 @@ QByteArray Database::transformedDatabaseKey() const
     return m_data.transformedDatabaseKey->rawKey();
 }
 
+/**
+ * Serialized entries kept between saves, so unmodified entries
+ * do not have to be serialized again.
+ */
+KdbxXmlEntryCache* Database::xmlEntryCache() const
+{
+    return m_xmlEntryCache;
+}
+
+/**
+ * Index used by EntrySearcher to skip entries that can't match a search.
+ */
+EntrySearchIndex* Database::searchIndex() const
+{
+    return m_searchIndex.data();
+}
+
+/**
+ * Index of the entries by the base domain of their URLs, used to find the
+ * entries for a site.
+ */
+EntryUrlIndex* Database::urlIndex() const
+{
+    return m_urlIndex.data();
+}
+
 QByteArray Database::challengeResponseKey() const
 {
     return m_data.challengeResponseKey->rawKey();
@@ -724,10 +1131,14 @@ bool Database::setKey(const QSharedPointer<const CompositeKey>& key,
     if (!key) {
         m_data.key.reset();
         m_data.transformedDatabaseKey.reset(new PasswordKey());
+        m_precomputedKey.reset();
         return true;
     }
 
-    if (updateTransformSalt) {
+    QByteArray transformedDatabaseKey;
+    bool precomputed = updateTransformSalt && transformKey && takePrecomputedKey(key, transformedDatabaseKey);
+
+    if (updateTransformSalt && !precomputed) {
         m_data.kdf->randomizeSeed();
         Q_ASSERT(!m_data.kdf->seed().isEmpty());
     }
@@ -737,11 +1148,9 @@ bool Database::setKey(const QSharedPointer<const CompositeKey>& key,
         oldTransformedDatabaseKey.setHash(m_data.transformedDatabaseKey->rawKey());
     }
 
-    QByteArray transformedDatabaseKey;
-
     if (!transformKey) {
         transformedDatabaseKey = QByteArray(oldTransformedDatabaseKey.rawKey());
-    } else if (!key->transform(*m_data.kdf, transformedDatabaseKey, &m_keyError)) {
+    } else if (!precomputed && !key->transform(*m_data.kdf, transformedDatabaseKey, &m_keyError)) {
         return false;
     }
 
@@ -860,7 +1269,21 @@ bool Database::hasNonDataChanges() const
 
 void Database::markAsModified()
 {
+    // any change can affect the result of resolving placeholders
+    auto entry = qobject_cast<Entry*>(sender());
+    if (entry) {
+        m_referenceIndex->updateEntry(entry);
+        m_searchIndex->updateEntry(entry);
+        m_urlIndex->updateEntry(entry);
+    } else {
+        m_referenceIndex->invalidate();
+        m_searchIndex->markChanged();
+    }
+
     m_modified = true;
+    if (m_backgroundSave) {
+        m_backgroundSave->modified = true;
+    }
     if (m_emitModified && !m_modifiedTimer.isActive()) {
         // Small time delay prevents numerous consecutive saves due to repeated signals
         startModifiedTimer();
@@ -880,6 +1303,9 @@ void Database::markAsClean()
 
 void Database::markNonDataChange()
 {
+    // moved entries change which one a reference resolves to
+    m_referenceIndex->invalidate();
+    m_searchIndex->markChanged();
     m_hasNonDataChange = true;
 }
 
@@ -906,6 +1332,7 @@ void Database::setKdf(QSharedPointer<Kdf> kdf)
 {
     Q_ASSERT(!m_data.isReadOnly);
     m_data.kdf = std::move(kdf);
+    m_precomputedKey.reset();
 }
 
 bool Database::changeKdf(const QSharedPointer<Kdf>& kdf)
@@ -928,6 +1355,118 @@ bool Database::changeKdf(const QSharedPointer<Kdf>& kdf)
     return true;
 }
 
+bool Database::isKeyPrecomputationEnabled() const
+{
+    return m_keyPrecomputation;
+}
+
+/**
+ * Transform the key for the next save in advance.
+ *
+ * Whenever the database has been unlocked or saved, the key is transformed
+ * with a fresh KDF seed on a worker thread and the result is kept in secure
+ * memory. The next save uses it instead of running the KDF, so every save
+ * still gets a new seed. Keys with challenge-response components are always
+ * transformed while saving.
+ *
+ * @param enabled true to precompute transformed keys
+ */
+void Database::setKeyPrecomputationEnabled(bool enabled)
+{
+    m_keyPrecomputation = enabled;
+    if (enabled) {
+        precomputeNextKey();
+    } else {
+        m_precomputedKey.reset();
+    }
+}
+
+bool Database::isUnlockCacheEnabled() const
+{
+    return m_unlockCache;
+}
+
+/**
+ * Keep an encrypted snapshot of the database in memory after opening it,
+ * so opening the unchanged file again skips decrypting and parsing it.
+ *
+ * @param enabled true to use the snapshot cache in open()
+ */
+void Database::setUnlockCacheEnabled(bool enabled)
+{
+    m_unlockCache = enabled;
+}
+
+void Database::precomputeNextKey()
+{
+    m_precomputedKey.reset();
+    m_precomputePending = false;
+    if (!m_keyPrecomputation || m_data.isReadOnly || !m_data.key || !m_data.kdf
+        || !m_data.key->challengeResponseKeys().isEmpty()) {
+        return;
+    }
+
+    // the KDF may use a lot of memory, a new transformation waits for the running one
+    if (m_precomputeWatcher.isRunning()) {
+        m_precomputePending = true;
+        return;
+    }
+
+    auto precomputed = QSharedPointer<PrecomputedKey>::create();
+    precomputed->key = m_data.key;
+    precomputed->kdfParameters = m_data.kdf->writeParameters();
+    precomputed->kdf = m_data.kdf->clone();
+    precomputed->kdf->randomizeSeed();
+
+    // the task holds its own reference in case the key is discarded before it finishes
+    precomputed->result = QtConcurrent::run([precomputed] {
+        QByteArray transformedKey;
+        if (!precomputed->key->transform(*precomputed->kdf, transformedKey)) {
+            return false;
+        }
+        precomputed->transformedKey.setHash(transformedKey);
+        return true;
+    });
+    m_precomputedKey = precomputed;
+    m_precomputeWatcher.setFuture(precomputed->result);
+}
+
+/**
+ * Start the key transformation that was requested while another one was running.
+ */
+void Database::finishKeyPrecomputation()
+{
+    if (m_precomputePending) {
+        precomputeNextKey();
+    }
+}
+
+/**
+ * Replace the KDF seed with the precomputed one, waiting for the
+ * transformation to finish if necessary. The precomputed key is used once.
+ *
+ * @param key key that is about to be transformed
+ * @param transformedKey receives the transformed key
+ * @return true if a matching key was precomputed
+ */
+bool Database::takePrecomputedKey(const QSharedPointer<const CompositeKey>& key, QByteArray& transformedKey)
+{
+    QSharedPointer<PrecomputedKey> precomputed;
+    precomputed.swap(m_precomputedKey);
+
+    // the key or KDF settings may have changed since
+    if (!precomputed || precomputed->key != key || precomputed->kdfParameters != m_data.kdf->writeParameters()) {
+        return false;
+    }
+    if (!precomputed->result.result() || !m_data.kdf->setSeed(precomputed->kdf->seed())) {
+        return false;
+    }
+
+    const QByteArray rawKey = precomputed->transformedKey.rawKey();
+    transformedKey = QByteArray(rawKey.constData(), rawKey.size());
+    return true;
+}
+
 void Database::startModifiedTimer()
 {
     QMetaObject::invokeMethod(&m_modifiedTimer, "start", Q_ARG(int, 150));
@@ -20,10 +20,12 @@
 #define KEEPASSX_DATABASE_H
 
 #include <QDateTime>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QMutex>
 #include <QPointer>
 #include <QScopedPointer>
+#include <QSet>
 #include <QTimer>
 
 #include "config-keepassx.h"
@@ -34,9 +36,13 @@
 #include "keys/PasswordKey.h"
 
 class Entry;
+class EntryReferenceIndex;
+class EntrySearchIndex;
+class EntryUrlIndex;
 enum class EntryReferenceType;
 class FileWatcher;
 class Group;
+class KdbxXmlEntryCache;
 class Metadata;
 class QIODevice;
 
@@ -75,6 +81,7 @@ public:
               bool readOnly = false);
     bool save(QString* error = nullptr, bool atomic = true, bool backup = false);
     bool saveAs(const QString& filePath, QString* error = nullptr, bool atomic = true, bool backup = false);
+    bool saveInBackground(QString* error = nullptr, bool atomic = true, bool backup = false);
     bool extract(QByteArray&, QString* error = nullptr);
     bool import(const QString& xmlExportPath, QString* error = nullptr);
 
@@ -111,7 +118,12 @@ public:
     void addDeletedObject(const QUuid& uuid);
     bool containsDeletedObject(const QUuid& uuid) const;
     bool containsDeletedObject(const DeletedObject& uuid) const;
+    bool removeDeletedObject(const QUuid& uuid);
+    int removeDeletedObjects(const QSet<QUuid>& uuids);
     void setDeletedObjects(const QList<DeletedObject>& delObjs);
+    int deletedObjectsMaxAge() const;
+    void setDeletedObjectsMaxAge(int days);
+    int compactDeletedObjects();
 
     QList<QString> commonUsernames();
 
@@ -132,6 +144,14 @@ public:
     void setKdf(QSharedPointer<Kdf> kdf);
     bool changeKdf(const QSharedPointer<Kdf>& kdf);
     QByteArray transformedDatabaseKey() const;
+    bool isKeyPrecomputationEnabled() const;
+    void setKeyPrecomputationEnabled(bool enabled);
+    bool isUnlockCacheEnabled() const;
+    void setUnlockCacheEnabled(bool enabled);
+
+    KdbxXmlEntryCache* xmlEntryCache() const;
+    EntrySearchIndex* searchIndex() const;
+    EntryUrlIndex* urlIndex() const;
 
     static Database* databaseByUuid(const QUuid& uuid);
 
@@ -155,8 +175,12 @@ signals:
     void databaseSaved();
     void databaseDiscarded();
     void databaseFileChanged();
+    void backgroundSaveFinished(bool success, const QString& error);
 
 private:
+    friend class Entry;
+    friend class Group;
+
     struct DatabaseData
     {
         QString filePath;
@@ -196,22 +220,73 @@ private:
         }
     };
 
+    struct BackgroundSave
+    {
+        QScopedPointer<Database> snapshot;
+        QSharedPointer<const CompositeKey> key;
+        QSharedPointer<Kdf> kdf;
+        QString filePath;
+        QString realFilePath;
+        bool isNewFile = false;
+        bool modified = false;
+        QString error;
+        QFutureWatcher<bool> watcher;
+    };
+
+    struct PrecomputedKey
+    {
+        QSharedPointer<const CompositeKey> key;
+        QVariantMap kdfParameters;
+        QSharedPointer<Kdf> kdf;
+        PasswordKey transformedKey;
+        QFuture<bool> result;
+    };
+
     void createRecycleBin();
 
     bool writeDatabase(QIODevice* device, QString* error = nullptr);
     bool backupDatabase(const QString& filePath);
     bool restoreDatabase(const QString& filePath);
     bool performSave(const QString& filePath, QString* error, bool atomic, bool backup);
+    bool canSave(const QString& filePath, QString* error);
+    Database* createSnapshot() const;
+    void finishBackgroundSave();
+    void waitForBackgroundSave();
+    void precomputeNextKey();
+    void finishKeyPrecomputation();
+    bool takePrecomputedKey(const QSharedPointer<const CompositeKey>& key, QByteArray& transformedKey);
     void startModifiedTimer();
     void stopModifiedTimer();
+    void indexEntry(Entry* entry);
+    void unindexEntry(Entry* entry);
+    void indexGroup(Group* group);
+    void unindexGroup(Group* group);
+    void insertDeletedObject(const DeletedObject& delObj);
 
     QPointer<Metadata> const m_metadata;
     DatabaseData m_data;
     QPointer<Group> m_rootGroup;
     QList<DeletedObject> m_deletedObjects;
+    // position of each deleted object in m_deletedObjects
+    QHash<QUuid, int> m_deletedObjectIndex;
+    int m_deletedObjectsMaxAge = 0;
+    // all entries and groups of the database by uuid, maintained by Entry and Group
+    QMultiHash<QUuid, Entry*> m_entryIndex;
+    QMultiHash<QUuid, Group*> m_groupIndex;
+    QScopedPointer<EntryReferenceIndex> m_referenceIndex;
+    QScopedPointer<EntrySearchIndex> m_searchIndex;
+    QScopedPointer<EntryUrlIndex> m_urlIndex;
     QTimer m_modifiedTimer;
     QMutex m_saveMutex;
     QPointer<FileWatcher> m_fileWatcher;
+    QPointer<KdbxXmlEntryCache> m_xmlEntryCache;
+    QScopedPointer<BackgroundSave> m_backgroundSave;
+    QSharedPointer<PrecomputedKey> m_precomputedKey;
+    // the last started key transformation, at most one runs at a time
+    QFutureWatcher<bool> m_precomputeWatcher;
+    bool m_precomputePending = false;
+    bool m_keyPrecomputation = false;
+    bool m_unlockCache = false;
     bool m_modified = false;
     bool m_emitModified;
     bool m_hasNonDataChange = false;
@@ -22,6 +22,7 @@
 #include "core/Clock.h"
 #include "core/Database.h"
 #include "core/DatabaseIcons.h"
+#include "core/EntryReferenceIndex.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
 #include "core/Tools.h"
@@ -29,6 +30,7 @@
 
 #include <QDir>
 #include <QRegularExpression>
+#include <algorithm>
 #include <utility>
 
 const int Entry::DefaultIconNumber = 0;
@@ -36,6 +38,12 @@ const int Entry::ResolveMaximumDepth = 10;
 const QString Entry::AutoTypeSequenceUsername = "{USERNAME}{ENTER}";
 const QString Entry::AutoTypeSequencePassword = "{PASSWORD}{ENTER}";
 
+namespace
+{
+    // number of time dependent placeholders resolved by the current thread
+    thread_local int volatilePlaceholders = 0;
+} // namespace
+
 Entry::Entry()
     : m_attributes(new EntryAttributes(this))
     , m_attachments(new EntryAttachments(this))
@@ -70,7 +78,7 @@ Entry::~Entry()
         }
     }
 
-    qDeleteAll(m_history);
+    qDeleteAll(m_historyItems);
 }
 
 template <class T> inline bool Entry::set(T& property, const T& value)
@@ -354,6 +362,26 @@ bool Entry::isExpired() const
     return m_data.timeInfo.expires() && m_data.timeInfo.expiryTime() < Clock::currentDateTimeUtc();
 }
 
+/**
+ * Position of the entry in the order the groups are searched: the entries of
+ * a group come before those of its subgroups. Paths compare in that order.
+ */
+QVector<int> Entry::traversalPath() const
+{
+    QVector<int> path;
+    const Group* group = m_group;
+    if (!group) {
+        return path;
+    }
+
+    path << group->entries().indexOf(const_cast<Entry*>(this)) << -1;
+    for (; group->parentGroup(); group = group->parentGroup()) {
+        path << group->parentGroup()->children().indexOf(const_cast<Group*>(group));
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
 bool Entry::isRecycled() const
 {
     const Database* db = database();
@@ -511,7 +539,15 @@ QString Entry::path() const
 void Entry::setUuid(const QUuid& uuid)
 {
     Q_ASSERT(!uuid.isNull());
+
+    Database* db = database();
+    if (db) {
+        db->unindexEntry(this);
+    }
     set(m_uuid, uuid);
+    if (db) {
+        db->indexEntry(this);
+    }
 }
 
 void Entry::setIcon(int iconNumber)
@@ -638,21 +674,62 @@ void Entry::setExpiryTime(const QDateTime& dateTime)
     }
 }
 
+/**
+ * Get the history items as full entries. They are created from the history
+ * snapshots on first use and stay valid until they are removed from the
+ * history, changes to them are applied to the snapshots.
+ */
 QList<Entry*> Entry::historyItems()
 {
-    return m_history;
+    return static_cast<const Entry*>(this)->historyItems();
 }
 
 const QList<Entry*>& Entry::historyItems() const
+{
+    Q_ASSERT(m_historyItems.size() == m_history.size());
+
+    for (int i = 0; i < m_historyItems.size(); ++i) {
+        if (!m_historyItems[i]) {
+            m_historyItems[i] = m_history[i].toEntry();
+            connect(m_historyItems[i], SIGNAL(entryModified()), this, SLOT(updateHistoryItem()));
+        }
+    }
+    return m_historyItems;
+}
+
+const QList<EntrySnapshot>& Entry::historySnapshots() const
 {
     return m_history;
 }
 
+void Entry::setHistorySnapshots(const QList<EntrySnapshot>& history)
+{
+    qDeleteAll(m_historyItems);
+    m_historyItems.clear();
+    m_history = history;
+    for (int i = 0; i < m_history.size(); ++i) {
+        m_historyItems.append(nullptr);
+    }
+    emit entryModified();
+}
+
+/**
+ * Add a history item, taking ownership of it.
+ */
 void Entry::addHistoryItem(Entry* entry)
 {
     Q_ASSERT(!entry->parent());
 
-    m_history.append(entry);
+    m_history.append(EntrySnapshot(entry));
+    m_historyItems.append(entry);
+    connect(entry, SIGNAL(entryModified()), SLOT(updateHistoryItem()));
+    emit entryModified();
+}
+
+void Entry::addHistoryItem(const EntrySnapshot& snapshot)
+{
+    m_history.append(snapshot);
+    m_historyItems.append(nullptr);
     emit entryModified();
 }
 
@@ -665,15 +742,35 @@ void Entry::removeHistoryItems(const QList<Entry*>& historyEntries)
     for (Entry* entry : historyEntries) {
         Q_ASSERT(!entry->parent());
         Q_ASSERT(entry->uuid().isNull() || entry->uuid() == uuid());
-        Q_ASSERT(m_history.contains(entry));
+        Q_ASSERT(m_historyItems.contains(entry));
 
-        m_history.removeOne(entry);
+        int index = m_historyItems.indexOf(entry);
+        if (index >= 0) {
+            m_history.removeAt(index);
+            m_historyItems.removeAt(index);
+        }
         delete entry;
     }
 
     emit entryModified();
 }
 
+void Entry::updateHistoryItem()
+{
+    auto historyItem = qobject_cast<Entry*>(sender());
+    int index = m_historyItems.indexOf(historyItem);
+    if (index >= 0) {
+        m_history[index] = EntrySnapshot(historyItem);
+
+        // the history is part of the entry data, e.g. for the serialized XML
+        // cache, but changing it does not update the modification time
+        const bool updateTimeinfo = m_updateTimeinfo;
+        m_updateTimeinfo = false;
+        emit entryModified();
+        m_updateTimeinfo = updateTimeinfo;
+    }
+}
+
 void Entry::truncateHistory()
 {
     const Database* db = database();
@@ -685,39 +782,30 @@ void Entry::truncateHistory()
     bool changed = false;
     int histMaxItems = db->metadata()->historyMaxItems();
     if (histMaxItems > -1) {
-        int historyCount = 0;
-        QMutableListIterator<Entry*> i(m_history);
-        i.toBack();
-        while (i.hasPrevious()) {
-            historyCount++;
-            Entry* entry = i.previous();
-            if (historyCount > histMaxItems) {
-                delete entry;
-                i.remove();
-                changed = true;
-            }
+        while (m_history.size() > histMaxItems) {
+            m_history.removeFirst();
+            delete m_historyItems.takeFirst();
+            changed = true;
         }
     }
 
     int histMaxSize = db->metadata()->historyMaxSize();
     if (histMaxSize > -1) {
         int size = 0;
-        QSet<QByteArray> foundAttachments = attachments()->values();
+        QSet<QByteArray> foundAttachments = attachments()->digests();
 
-        QMutableListIterator<Entry*> i(m_history);
-        i.toBack();
-        while (i.hasPrevious()) {
-            Entry* historyItem = i.previous();
+        for (int i = m_history.size() - 1; i >= 0; --i) {
+            const EntrySnapshot& historyItem = m_history.at(i);
 
             // don't calculate size if it's already above the maximum
             if (size <= histMaxSize) {
-                size += historyItem->size();
-                foundAttachments += historyItem->attachments()->values();
+                size += historyItem.size();
+                foundAttachments += historyItem.attachmentDigests();
             }
 
             if (size > histMaxSize) {
-                delete historyItem;
-                i.remove();
+                m_history.removeAt(i);
+                delete m_historyItems.takeAt(i);
                 changed = true;
             }
         }
@@ -756,7 +844,7 @@ bool Entry::equals(const Entry* other, CompareItemOptions options) const
             return false;
         }
         for (int i = 0; i < m_history.count(); ++i) {
-            if (!m_history[i]->equals(other->m_history[i], options)) {
+            if (!m_history[i].equals(other->m_history[i], options)) {
                 return false;
             }
         }
@@ -792,13 +880,20 @@ Entry* Entry::clone(CloneFlags flags) const
 
     entry->m_autoTypeAssociations->copyDataFrom(m_autoTypeAssociations);
     if (flags & CloneIncludeHistory) {
-        for (Entry* historyItem : m_history) {
-            Entry* historyItemClone =
-                historyItem->clone(flags & ~CloneIncludeHistory & ~CloneNewUuid & ~CloneResetTimeInfo);
-            historyItemClone->setUpdateTimeinfo(false);
-            historyItemClone->setUuid(entry->uuid());
-            historyItemClone->setUpdateTimeinfo(true);
-            entry->addHistoryItem(historyItemClone);
+        const CloneFlags historyFlags = flags & ~CloneIncludeHistory & ~CloneNewUuid & ~CloneResetTimeInfo;
+        for (const EntrySnapshot& historyItem : m_history) {
+            if (historyFlags == CloneNoFlags) {
+                // the snapshot can be shared as is
+                EntrySnapshot historyItemClone = historyItem;
+                historyItemClone.m_uuid = entry->uuid();
+                entry->addHistoryItem(historyItemClone);
+            } else {
+                QScopedPointer<Entry> historyEntry(historyItem.toEntry());
+                QScopedPointer<Entry> historyItemClone(historyEntry->clone(historyFlags));
+                historyItemClone->setUpdateTimeinfo(false);
+                historyItemClone->setUuid(entry->uuid());
+                entry->addHistoryItem(EntrySnapshot(historyItemClone.data()));
+            }
         }
     }
 
@@ -834,13 +929,9 @@ void Entry::beginUpdate()
 {
     Q_ASSERT(m_tmpHistoryItem.isNull());
 
-    m_tmpHistoryItem.reset(new Entry());
-    m_tmpHistoryItem->setUpdateTimeinfo(false);
-    m_tmpHistoryItem->m_uuid = m_uuid;
-    m_tmpHistoryItem->m_data = m_data;
-    m_tmpHistoryItem->m_attributes->copyDataFrom(m_attributes);
-    m_tmpHistoryItem->m_attachments->copyDataFrom(m_attachments);
-    m_tmpHistoryItem->m_autoTypeAssociations->copyDataFrom(m_autoTypeAssociations);
+    m_tmpHistoryItem.reset(new EntrySnapshot(this));
+    // custom data isn't kept in history items created by edits
+    m_tmpHistoryItem->m_customData.clear();
 
     m_modifiedSinceBegin = false;
 }
@@ -849,8 +940,7 @@ bool Entry::endUpdate()
 {
     Q_ASSERT(!m_tmpHistoryItem.isNull());
     if (m_modifiedSinceBegin) {
-        m_tmpHistoryItem->setUpdateTimeinfo(true);
-        addHistoryItem(m_tmpHistoryItem.take());
+        addHistoryItem(*m_tmpHistoryItem);
         truncateHistory();
     }
 
@@ -943,6 +1033,7 @@ QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDe
         return resolveUrlPlaceholder(strUrl, typeOfPlaceholder);
     }
     case PlaceholderType::Totp:
+        ++volatilePlaceholders;
         // totp can't have placeholder inside
         return totp();
     case PlaceholderType::CustomAttribute: {
@@ -965,6 +1056,7 @@ QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDe
     case PlaceholderType::DateTimeUtcHour:
     case PlaceholderType::DateTimeUtcMinute:
     case PlaceholderType::DateTimeUtcSecond:
+        ++volatilePlaceholders;
         return resolveMultiplePlaceholdersRecursive(resolveDateTimePlaceholder(typeOfPlaceholder), maxDepth - 1);
     }
 
@@ -1187,7 +1279,24 @@ Entry* Entry::resolveReference(const QString& str) const
 
 QString Entry::resolveMultiplePlaceholders(const QString& str) const
 {
-    return resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth);
+    const Database* db = database();
+    if (!db || !str.contains('{')) {
+        return resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth);
+    }
+
+    QString result;
+    quint64 generation;
+    if (db->m_referenceIndex->placeholder(this, str, result, generation)) {
+        return result;
+    }
+
+    const int volatileBefore = volatilePlaceholders;
+    result = resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth);
+    // results that depend on the current time must not be remembered
+    if (volatilePlaceholders == volatileBefore) {
+        db->m_referenceIndex->insertPlaceholder(this, str, result, generation);
+    }
+    return result;
 }
 
 QString Entry::resolvePlaceholder(const QString& placeholder) const
@@ -1380,3 +1489,108 @@ bool EntryData::equals(const EntryData& other, CompareItemOptions options) const
 
     return true;
 }
+
+EntrySnapshot::EntrySnapshot()
+    : m_data()
+    , m_attributes(new EntryAttributes::Data())
+{
+}
+
+EntrySnapshot::EntrySnapshot(const Entry* entry)
+    : m_uuid(entry->m_uuid)
+    , m_data(entry->m_data)
+    , m_attributes(entry->m_attributes->m_data)
+    , m_attachments(entry->m_attachments->m_attachments)
+    , m_autoTypeAssociations(entry->m_autoTypeAssociations->m_associations)
+    , m_customData(entry->m_customData->m_data)
+{
+}
+
+const QUuid& EntrySnapshot::uuid() const
+{
+    return m_uuid;
+}
+
+const EntryData& EntrySnapshot::data() const
+{
+    return m_data;
+}
+
+const TimeInfo& EntrySnapshot::timeInfo() const
+{
+    return m_data.timeInfo;
+}
+
+QString EntrySnapshot::attributeValue(const QString& key) const
+{
+    return m_attributes->value(key);
+}
+
+const QMap<QString, AttachmentStore::Blob>& EntrySnapshot::attachments() const
+{
+    return m_attachments;
+}
+
+QSet<QByteArray> EntrySnapshot::attachmentDigests() const
+{
+    QSet<QByteArray> digests;
+    for (const AttachmentStore::Blob& blob : m_attachments) {
+        digests.insert(blob.digest());
+    }
+    return digests;
+}
+
+bool EntrySnapshot::hasCustomData() const
+{
+    return !m_customData.isEmpty();
+}
+
+/**
+ * Same as Entry::size() for the entry the snapshot was taken from.
+ */
+int EntrySnapshot::size() const
+{
+    int size = m_attributes->size();
+    const QRegularExpression delimiter(",|:|;");
+
+    for (const AutoTypeAssociations::Association& association : m_autoTypeAssociations) {
+        size += association.sequence.toUtf8().size() + association.window.toUtf8().size();
+    }
+    for (auto it = m_attachments.constBegin(); it != m_attachments.constEnd(); ++it) {
+        size += it.key().toUtf8().size() + it.value().size();
+    }
+    for (auto it = m_customData.constBegin(); it != m_customData.constEnd(); ++it) {
+        size += it.key().toUtf8().size() + it.value().toUtf8().size();
+    }
+    const QStringList tags = m_data.tags.split(delimiter, QString::SkipEmptyParts);
+    for (const QString& tag : tags) {
+        size += tag.toUtf8().size();
+    }
+
+    return size;
+}
+
+bool EntrySnapshot::equals(const EntrySnapshot& other, CompareItemOptions options) const
+{
+    return m_uuid == other.m_uuid && m_data.equals(other.m_data, options) && m_customData == other.m_customData
+           && (m_attributes == other.m_attributes || *m_attributes == *other.m_attributes)
+           && m_attachments == other.m_attachments && m_autoTypeAssociations == other.m_autoTypeAssociations;
+}
+
+/**
+ * Create an entry with the state of the snapshot. The entry isn't part of
+ * any group and has no history.
+ */
+Entry* EntrySnapshot::toEntry() const
+{
+    auto entry = new Entry();
+    entry->setUpdateTimeinfo(false);
+    entry->m_uuid = m_uuid;
+    entry->m_data = m_data;
+    entry->m_attributes->m_data = m_attributes;
+    entry->m_attachments->m_attachments = m_attachments;
+    entry->m_autoTypeAssociations->m_associations = m_autoTypeAssociations;
+    entry->m_customData->m_data = m_customData;
+    entry->setUpdateTimeinfo(true);
+    return entry;
+}
@@ -26,6 +26,7 @@
 #include <QSet>
 #include <QUrl>
 #include <QUuid>
+#include <QVector>
 
 #include "core/AutoTypeAssociations.h"
 #include "core/CustomData.h"
@@ -35,6 +36,7 @@
 #include "core/TimeInfo.h"
 
 class Database;
+class Entry;
 class Group;
 namespace Totp
 {
@@ -72,10 +74,49 @@ struct EntryData
     bool equals(const EntryData& other, CompareItemOptions options) const;
 };
 
+/**
+ * Immutable copy of the state of an entry, used for its history items.
+ *
+ * The attribute, attachment, auto-type and custom data containers are
+ * implicitly shared with the entry the snapshot was taken from, so taking a
+ * snapshot doesn't copy any values and consecutive history items share
+ * everything that didn't change between them.
+ */
+class EntrySnapshot
+{
+public:
+    EntrySnapshot();
+    explicit EntrySnapshot(const Entry* entry);
+
+    const QUuid& uuid() const;
+    const EntryData& data() const;
+    const TimeInfo& timeInfo() const;
+    QString attributeValue(const QString& key) const;
+    const QMap<QString, AttachmentStore::Blob>& attachments() const;
+    QSet<QByteArray> attachmentDigests() const;
+    bool hasCustomData() const;
+    int size() const;
+
+    bool equals(const EntrySnapshot& other, CompareItemOptions options = CompareItemDefault) const;
+    Entry* toEntry() const;
+
+private:
+    friend class Entry;
+
+    QUuid m_uuid;
+    EntryData m_data;
+    QSharedDataPointer<EntryAttributes::Data> m_attributes;
+    QMap<QString, AttachmentStore::Blob> m_attachments;
+    QList<AutoTypeAssociations::Association> m_autoTypeAssociations;
+    QHash<QString, QString> m_customData;
+};
+
 class Entry : public QObject
 {
     Q_OBJECT
 
+    friend class EntrySnapshot;
+
 public:
     Entry();
     ~Entry();
@@ -110,6 +151,7 @@ public:
     QSharedPointer<Totp::Settings> totpSettings() const;
     int size() const;
     QString path() const;
+    QVector<int> traversalPath() const;
 
     bool hasTotp() const;
     bool isExpired() const;
@@ -149,7 +191,10 @@ public:
 
     QList<Entry*> historyItems();
     const QList<Entry*>& historyItems() const;
+    const QList<EntrySnapshot>& historySnapshots() const;
+    void setHistorySnapshots(const QList<EntrySnapshot>& history);
     void addHistoryItem(Entry* entry);
+    void addHistoryItem(const EntrySnapshot& snapshot);
     void removeHistoryItems(const QList<Entry*>& historyEntries);
     void truncateHistory();
 
@@ -261,6 +306,7 @@ private slots:
     void updateTimeinfo();
     void updateModifiedSinceBegin();
     void updateTotp();
+    void updateHistoryItem();
 
 private:
     QString resolveMultiplePlaceholdersRecursive(const QString& str, int maxDepth) const;
@@ -279,9 +325,11 @@ private:
     QPointer<EntryAttachments> m_attachments;
     QPointer<AutoTypeAssociations> m_autoTypeAssociations;
     QPointer<CustomData> m_customData;
-    QList<Entry*> m_history; // Items sorted from oldest to newest
+    QList<EntrySnapshot> m_history; // Items sorted from oldest to newest
+    // Materialized history items, null until they are requested
+    mutable QList<Entry*> m_historyItems;
 
-    QScopedPointer<Entry> m_tmpHistoryItem;
+    QScopedPointer<EntrySnapshot> m_tmpHistoryItem;
     bool m_modifiedSinceBegin;
     QPointer<Group> m_group;
     bool m_updateTimeinfo;
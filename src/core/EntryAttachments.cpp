@@ -17,8 +17,6 @@
 
 #include "EntryAttachments.h"
 
-#include "core/Global.h"
-
 #include <QSet>
 #include <QStringList>
 
@@ -39,15 +37,51 @@ bool EntryAttachments::hasKey(const QString& key) const
 
 QSet<QByteArray> EntryAttachments::values() const
 {
-    return asConst(m_attachments).values().toSet();
+    QSet<QByteArray> values;
+    for (const auto& blob : m_attachments) {
+        values.insert(blob.data());
+    }
+    return values;
 }
 
+/**
+ * Get the data of an attachment. Large attachments are kept encrypted
+ * outside of memory and only decrypted when requested.
+ */
 QByteArray EntryAttachments::value(const QString& key) const
+{
+    return m_attachments.value(key).data();
+}
+
+/**
+ * Get the digest identifying the data of an attachment.
+ * Attachments with identical data have the same digest.
+ */
+QByteArray EntryAttachments::digest(const QString& key) const
+{
+    return m_attachments.value(key).digest();
+}
+
+QSet<QByteArray> EntryAttachments::digests() const
+{
+    QSet<QByteArray> digests;
+    for (const auto& blob : m_attachments) {
+        digests.insert(blob.digest());
+    }
+    return digests;
+}
+
+AttachmentStore::Blob EntryAttachments::blob(const QString& key) const
 {
     return m_attachments.value(key);
 }
 
 void EntryAttachments::set(const QString& key, const QByteArray& value)
+{
+    set(key, AttachmentStore::instance()->store(value));
+}
+
+void EntryAttachments::set(const QString& key, const AttachmentStore::Blob& blob)
 {
     bool emitModified = false;
     bool addAttachment = !m_attachments.contains(key);
@@ -56,8 +90,8 @@ void EntryAttachments::set(const QString& key, const QByteArray& value)
         emit aboutToBeAdded(key);
     }
 
-    if (addAttachment || m_attachments.value(key) != value) {
-        m_attachments.insert(key, value);
+    if (addAttachment || m_attachments.value(key) != blob) {
+        m_attachments.insert(key, blob);
         emitModified = true;
     }
 
@@ -114,7 +148,7 @@ void EntryAttachments::remove(const QStringList& keys)
 
 void EntryAttachments::rename(const QString& key, const QString& newKey)
 {
-    const QByteArray val = value(key);
+    const AttachmentStore::Blob val = blob(key);
     remove(key);
     set(newKey, val);
 }
@@ -21,6 +21,8 @@
 #include <QMap>
 #include <QObject>
 
+#include "core/AttachmentStore.h"
+
 class QStringList;
 
 class EntryAttachments : public QObject
@@ -33,7 +35,11 @@ public:
     bool hasKey(const QString& key) const;
     QSet<QByteArray> values() const;
     QByteArray value(const QString& key) const;
+    QByteArray digest(const QString& key) const;
+    QSet<QByteArray> digests() const;
+    AttachmentStore::Blob blob(const QString& key) const;
     void set(const QString& key, const QByteArray& value);
+    void set(const QString& key, const AttachmentStore::Blob& blob);
     void remove(const QString& key);
     void remove(const QStringList& keys);
     void rename(const QString& key, const QString& newKey);
@@ -55,7 +61,9 @@ signals:
     void reset();
 
 private:
-    QMap<QString, QByteArray> m_attachments;
+    friend class EntrySnapshot;
+
+    QMap<QString, AttachmentStore::Blob> m_attachments;
 };
 
 #endif // KEEPASSX_ENTRYATTACHMENTS_H
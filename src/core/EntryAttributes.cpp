@@ -20,6 +20,11 @@
 
 #include "core/Global.h"
 
+#include <QMutex>
+#include <QSet>
+
+#include <algorithm>
+
 const QString EntryAttributes::TitleKey = "Title";
 const QString EntryAttributes::UserNameKey = "UserName";
 const QString EntryAttributes::PasswordKey = "Password";
@@ -34,6 +39,42 @@ const QString EntryAttributes::SearchTextGroupName = "SearchText";
 
 const QString EntryAttributes::RememberCmdExecAttr = "_EXEC_CMD";
 
+namespace
+{
+    /**
+     * Get a shared copy of a custom attribute key, so entries with the same
+     * custom attributes don't store the key again. Keys that are no longer
+     * used by any attribute are dropped whenever the table has doubled in size.
+     */
+    QString internKey(const QString& key)
+    {
+        static QMutex mutex;
+        static QSet<QString> keys;
+        static int pruneSize = 1024;
+
+        QMutexLocker locker(&mutex);
+        auto it = keys.constFind(key);
+        if (it != keys.constEnd()) {
+            return *it;
+        }
+
+        if (keys.size() >= pruneSize) {
+            // only the table holds a detached key, copies are made with the mutex locked
+            for (auto keyIt = keys.begin(); keyIt != keys.end();) {
+                if (keyIt->isDetached()) {
+                    keyIt = keys.erase(keyIt);
+                } else {
+                    ++keyIt;
+                }
+            }
+            pruneSize = qMax(1024, keys.size() * 2);
+        }
+
+        keys.insert(key);
+        return key;
+    }
+} // namespace
+
 EntryAttributes::EntryAttributes(QObject* parent)
     : QObject(parent)
 {
@@ -42,58 +83,91 @@ EntryAttributes::EntryAttributes(QObject* parent)
 
 QList<QString> EntryAttributes::keys() const
 {
-    return m_attributes.keys();
+    static const QStringList sortedDefaultKeys = [] {
+        QStringList keys = DefaultAttributes;
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }();
+
+    // merge the default keys into the sorted custom keys
+    QList<QString> keyList;
+    keyList.reserve(DefaultAttributeCount + m_data->customAttributes.size());
+    int i = 0;
+    for (const CustomAttribute& attribute : m_data->customAttributes) {
+        while (i < sortedDefaultKeys.size() && sortedDefaultKeys.at(i) < attribute.key) {
+            keyList.append(sortedDefaultKeys.at(i++));
+        }
+        keyList.append(attribute.key);
+    }
+    while (i < sortedDefaultKeys.size()) {
+        keyList.append(sortedDefaultKeys.at(i++));
+    }
+    return keyList;
 }
 
 bool EntryAttributes::hasKey(const QString& key) const
 {
-    return m_attributes.contains(key);
+    return contains(key);
 }
 
 QList<QString> EntryAttributes::customKeys() const
 {
     QList<QString> customKeys;
-    const QList<QString> keyList = keys();
-    for (const QString& key : keyList) {
-        if (!isDefaultAttribute(key)) {
-            customKeys.append(key);
-        }
+    customKeys.reserve(m_data->customAttributes.size());
+    for (const CustomAttribute& attribute : m_data->customAttributes) {
+        customKeys.append(attribute.key);
     }
     return customKeys;
 }
 
 QString EntryAttributes::value(const QString& key) const
 {
-    return m_attributes.value(key);
+    return m_data->value(key);
 }
 
 QList<QString> EntryAttributes::values(const QList<QString>& keys) const
 {
     QList<QString> values;
     for (const QString& key : keys) {
-        values.append(m_attributes.value(key));
+        values.append(m_data->value(key));
     }
     return values;
 }
 
 bool EntryAttributes::contains(const QString& key) const
 {
-    return m_attributes.contains(key);
+    return defaultIndex(key) >= 0 || m_data->findCustom(key) >= 0;
 }
 
 bool EntryAttributes::containsValue(const QString& value) const
 {
-    return asConst(m_attributes).values().contains(value);
+    for (const QString& defaultValue : m_data->defaultValues) {
+        if (defaultValue == value) {
+            return true;
+        }
+    }
+    for (const CustomAttribute& attribute : m_data->customAttributes) {
+        if (attribute.value == value) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool EntryAttributes::isProtected(const QString& key) const
 {
-    return m_protectedAttributes.contains(key);
+    const int index = defaultIndex(key);
+    if (index >= 0) {
+        return m_data->protectedDefaults & (1 << index);
+    }
+
+    const int customIndex = m_data->findCustom(key);
+    return customIndex >= 0 && m_data->customAttributes.at(customIndex).isProtected;
 }
 
 bool EntryAttributes::isReference(const QString& key) const
 {
-    if (!m_attributes.contains(key)) {
+    if (!contains(key)) {
         Q_ASSERT(false);
         return false;
     }
@@ -104,31 +178,45 @@ bool EntryAttributes::isReference(const QString& key) const
 
 void EntryAttributes::set(const QString& key, const QString& value, bool protect)
 {
-    bool emitModified = false;
-
-    bool addAttribute = !m_attributes.contains(key);
-    bool changeValue = !addAttribute && (m_attributes.value(key) != value);
-    bool defaultAttribute = isDefaultAttribute(key);
-
-    if (addAttribute && !defaultAttribute) {
-        emit aboutToBeAdded(key);
+    const Data* data = m_data.constData();
+    const int index = defaultIndex(key);
+    const int customIndex = index < 0 ? data->findCustom(key) : -1;
+
+    bool defaultAttribute = index >= 0;
+    bool addAttribute = !defaultAttribute && customIndex < 0;
+    bool changeValue = false;
+    bool wasProtected = false;
+    if (defaultAttribute) {
+        changeValue = data->defaultValues[index] != value;
+        wasProtected = data->protectedDefaults & (1 << index);
+    } else if (!addAttribute) {
+        const CustomAttribute& attribute = data->customAttributes.at(customIndex);
+        changeValue = attribute.value != value;
+        wasProtected = attribute.isProtected;
     }
 
-    if (addAttribute || changeValue) {
-        m_attributes.insert(key, value);
-        emitModified = true;
+    if (addAttribute) {
+        emit aboutToBeAdded(key);
     }
 
-    if (protect) {
-        if (!m_protectedAttributes.contains(key)) {
-            emitModified = true;
+    bool emitModified = addAttribute || changeValue || protect != wasProtected;
+    if (emitModified) {
+        Data* d = m_data.data();
+        if (defaultAttribute) {
+            d->defaultValues[index] = value;
+            if (protect) {
+                d->protectedDefaults |= (1 << index);
+            } else {
+                d->protectedDefaults &= ~(1 << index);
+            }
+        } else if (addAttribute) {
+            d->customAttributes.insert(d->lowerBound(key), {internKey(key), value, protect});
+        } else {
+            CustomAttribute& attribute = d->customAttributes[customIndex];
+            attribute.value = value;
+            attribute.isProtected = protect;
         }
-        m_protectedAttributes.insert(key);
-    } else if (m_protectedAttributes.remove(key)) {
-        emitModified = true;
-    }
 
-    if (emitModified) {
         emit entryAttributesModified();
     }
 
@@ -145,14 +233,14 @@ void EntryAttributes::remove(const QString& key)
 {
     Q_ASSERT(!isDefaultAttribute(key));
 
-    if (!m_attributes.contains(key)) {
+    const int index = m_data.constData()->findCustom(key);
+    if (index < 0) {
         return;
     }
 
     emit aboutToBeRemoved(key);
 
-    m_attributes.remove(key);
-    m_protectedAttributes.remove(key);
+    m_data->customAttributes.remove(index);
 
     emit removed(key);
     emit entryAttributesModified();
@@ -163,27 +251,26 @@ void EntryAttributes::rename(const QString& oldKey, const QString& newKey)
     Q_ASSERT(!isDefaultAttribute(oldKey));
     Q_ASSERT(!isDefaultAttribute(newKey));
 
-    if (!m_attributes.contains(oldKey)) {
+    const Data* data = m_data.constData();
+    const int index = data->findCustom(oldKey);
+    if (index < 0) {
         Q_ASSERT(false);
         return;
     }
 
-    if (m_attributes.contains(newKey)) {
+    if (contains(newKey)) {
         Q_ASSERT(false);
         return;
     }
 
-    QString data = value(oldKey);
-    bool protect = isProtected(oldKey);
+    CustomAttribute attribute = data->customAttributes.at(index);
+    attribute.key = internKey(newKey);
 
     emit aboutToRename(oldKey, newKey);
 
-    m_attributes.remove(oldKey);
-    m_attributes.insert(newKey, data);
-    if (protect) {
-        m_protectedAttributes.remove(oldKey);
-        m_protectedAttributes.insert(newKey);
-    }
+    Data* d = m_data.data();
+    d->customAttributes.remove(d->findCustom(oldKey));
+    d->customAttributes.insert(d->lowerBound(newKey), attribute);
 
     emit entryAttributesModified();
     emit renamed(oldKey, newKey);
@@ -197,24 +284,7 @@ void EntryAttributes::copyCustomKeysFrom(const EntryAttributes* other)
 
     emit aboutToBeReset();
 
-    // remove all non-default keys
-    const QList<QString> keyList = keys();
-    for (const QString& key : keyList) {
-        if (!isDefaultAttribute(key)) {
-            m_attributes.remove(key);
-            m_protectedAttributes.remove(key);
-        }
-    }
-
-    const QList<QString> otherKeyList = other->keys();
-    for (const QString& key : otherKeyList) {
-        if (!isDefaultAttribute(key)) {
-            m_attributes.insert(key, other->value(key));
-            if (other->isProtected(key)) {
-                m_protectedAttributes.insert(key);
-            }
-        }
-    }
+    m_data->customAttributes = other->m_data->customAttributes;
 
     emit reset();
     emit entryAttributesModified();
@@ -222,23 +292,8 @@ void EntryAttributes::copyCustomKeysFrom(const EntryAttributes* other)
 
 bool EntryAttributes::areCustomKeysDifferent(const EntryAttributes* other)
 {
-    // check if they are equal ignoring the order of the keys
-    if (keys().toSet() != other->keys().toSet()) {
-        return true;
-    }
-
-    const QList<QString> keyList = keys();
-    for (const QString& key : keyList) {
-        if (isDefaultAttribute(key)) {
-            continue;
-        }
-
-        if (isProtected(key) != other->isProtected(key) || value(key) != other->value(key)) {
-            return true;
-        }
-    }
-
-    return false;
+    // both lists are sorted by key, so the order of the keys doesn't matter
+    return m_data.constData()->customAttributes != other->m_data->customAttributes;
 }
 
 void EntryAttributes::copyDataFrom(const EntryAttributes* other)
@@ -246,8 +301,7 @@ void EntryAttributes::copyDataFrom(const EntryAttributes* other)
     if (*this != *other) {
         emit aboutToBeReset();
 
-        m_attributes = other->m_attributes;
-        m_protectedAttributes = other->m_protectedAttributes;
+        m_data = other->m_data;
 
         emit reset();
         emit entryAttributesModified();
@@ -256,7 +310,7 @@ void EntryAttributes::copyDataFrom(const EntryAttributes* other)
 
 QUuid EntryAttributes::referenceUuid(const QString& key) const
 {
-    if (!m_attributes.contains(key)) {
+    if (!contains(key)) {
         Q_ASSERT(false);
         return {};
     }
@@ -274,12 +328,12 @@ QUuid EntryAttributes::referenceUuid(const QString& key) const
 
 bool EntryAttributes::operator==(const EntryAttributes& other) const
 {
-    return (m_attributes == other.m_attributes && m_protectedAttributes == other.m_protectedAttributes);
+    return m_data == other.m_data || *m_data == *other.m_data;
 }
 
 bool EntryAttributes::operator!=(const EntryAttributes& other) const
 {
-    return (m_attributes != other.m_attributes || m_protectedAttributes != other.m_protectedAttributes);
+    return !(*this == other);
 }
 
 QRegularExpressionMatch EntryAttributes::matchReference(const QString& text)
@@ -295,27 +349,96 @@ void EntryAttributes::clear()
 {
     emit aboutToBeReset();
 
-    m_attributes.clear();
-    m_protectedAttributes.clear();
-
-    for (const QString& key : DefaultAttributes) {
-        m_attributes.insert(key, "");
-    }
+    m_data = new Data();
 
     emit reset();
     emit entryAttributesModified();
 }
 
 int EntryAttributes::attributesSize() const
+{
+    return m_data->size();
+}
+
+bool EntryAttributes::isDefaultAttribute(const QString& key)
+{
+    return defaultIndex(key) >= 0;
+}
+
+/**
+ * Slot of a default attribute, -1 for custom attributes.
+ */
+int EntryAttributes::defaultIndex(const QString& key)
+{
+    for (int i = 0; i < DefaultAttributeCount; ++i) {
+        if (key == DefaultAttributes.at(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool EntryAttributes::CustomAttribute::operator==(const CustomAttribute& other) const
+{
+    return key == other.key && value == other.value && isProtected == other.isProtected;
+}
+
+bool EntryAttributes::CustomAttribute::operator!=(const CustomAttribute& other) const
+{
+    return !(*this == other);
+}
+
+int EntryAttributes::Data::findCustom(const QString& key) const
+{
+    const int index = lowerBound(key);
+    if (index < customAttributes.size() && customAttributes.at(index).key == key) {
+        return index;
+    }
+    return -1;
+}
+
+int EntryAttributes::Data::lowerBound(const QString& key) const
+{
+    auto it = std::lower_bound(
+        customAttributes.constBegin(),
+        customAttributes.constEnd(),
+        key,
+        [](const CustomAttribute& attribute, const QString& otherKey) { return attribute.key < otherKey; });
+    return static_cast<int>(it - customAttributes.constBegin());
+}
+
+QString EntryAttributes::Data::value(const QString& key) const
+{
+    const int index = defaultIndex(key);
+    if (index >= 0) {
+        return defaultValues[index];
+    }
+
+    const int customIndex = findCustom(key);
+    return customIndex >= 0 ? customAttributes.at(customIndex).value : QString();
+}
+
+int EntryAttributes::Data::size() const
 {
     int size = 0;
-    for (auto it = m_attributes.constBegin(); it != m_attributes.constEnd(); ++it) {
-        size += it.key().toUtf8().size() + it.value().toUtf8().size();
+    for (int i = 0; i < DefaultAttributeCount; ++i) {
+        size += DefaultAttributes.at(i).toUtf8().size() + defaultValues[i].toUtf8().size();
+    }
+    for (const CustomAttribute& attribute : customAttributes) {
+        size += attribute.key.toUtf8().size() + attribute.value.toUtf8().size();
     }
     return size;
 }
 
-bool EntryAttributes::isDefaultAttribute(const QString& key)
+bool EntryAttributes::Data::operator==(const Data& other) const
 {
-    return DefaultAttributes.contains(key);
+    if (protectedDefaults != other.protectedDefaults || customAttributes != other.customAttributes) {
+        return false;
+    }
+    for (int i = 0; i < DefaultAttributeCount; ++i) {
+        if (defaultValues[i] != other.defaultValues[i]) {
+            return false;
+        }
+    }
+    return true;
 }
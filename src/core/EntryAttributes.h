@@ -19,12 +19,12 @@
 #ifndef KEEPASSX_ENTRYATTRIBUTES_H
 #define KEEPASSX_ENTRYATTRIBUTES_H
 
-#include <QMap>
 #include <QObject>
 #include <QRegularExpression>
-#include <QSet>
+#include <QSharedData>
 #include <QStringList>
 #include <QUuid>
+#include <QVector>
 
 class EntryAttributes : public QObject
 {
@@ -82,8 +82,41 @@ signals:
     void reset();
 
 private:
-    QMap<QString, QString> m_attributes;
-    QSet<QString> m_protectedAttributes;
+    friend class EntrySnapshot;
+
+    static const int DefaultAttributeCount = 5;
+
+    struct CustomAttribute
+    {
+        QString key;
+        QString value;
+        bool isProtected;
+
+        bool operator==(const CustomAttribute& other) const;
+        bool operator!=(const CustomAttribute& other) const;
+    };
+
+    /**
+     * Implicitly shared attribute values. The default attributes have fixed
+     * slots in the order of DefaultAttributes, the custom attributes are
+     * kept sorted by key and their keys are shared by all entries.
+     */
+    struct Data : public QSharedData
+    {
+        QString defaultValues[DefaultAttributeCount];
+        quint8 protectedDefaults = 0;
+        QVector<CustomAttribute> customAttributes;
+
+        int findCustom(const QString& key) const;
+        int lowerBound(const QString& key) const;
+        QString value(const QString& key) const;
+        int size() const;
+        bool operator==(const Data& other) const;
+    };
+
+    static int defaultIndex(const QString& key);
+
+    QSharedDataPointer<Data> m_data;
 };
 
 #endif // KEEPASSX_ENTRYATTRIBUTES_H
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EntryReferenceIndex.h"
+
+#include "core/Entry.h"
+#include "core/Group.h"
+
+#include <algorithm>
+
+const int EntryReferenceIndex::MaxPlaceholders = 50000;
+
+EntryReferenceIndex::EntryReferenceIndex()
+    : m_built(false)
+    , m_generation(0)
+{
+}
+
+/**
+ * Find the first entry of the database with a field matching a reference.
+ *
+ * @param rootGroup root group of the database, used to build the index
+ * @param referenceType field to search in
+ * @param term value the field has to be equal to
+ * @return the matching entry or nullptr
+ */
+Entry* EntryReferenceIndex::find(const Group* rootGroup, EntryReferenceType referenceType, const QString& term)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_built) {
+        const QList<Entry*> entries = rootGroup->entriesRecursive();
+        for (Entry* entry : entries) {
+            addEntryLocked(entry);
+        }
+        m_built = true;
+    }
+
+    const QList<Entry*> candidates = m_entries.value(Key(static_cast<int>(referenceType), term));
+    if (candidates.size() <= 1) {
+        return candidates.value(0);
+    }
+
+    // several entries match, return the same one as a search through the groups
+    return *std::min_element(candidates.constBegin(), candidates.constEnd(), [](const Entry* lhs, const Entry* rhs) {
+        return lhs->traversalPath() < rhs->traversalPath();
+    });
+}
+
+/**
+ * Look up a resolved placeholder string.
+ *
+ * @param entry entry the string belongs to
+ * @param str string with placeholders
+ * @param result receives the resolved string
+ * @param generation receives the state of the database to pass to insertPlaceholder()
+ * @return true if the string was found
+ */
+bool EntryReferenceIndex::placeholder(const Entry* entry, const QString& str, QString& result, quint64& generation) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    generation = m_generation;
+    auto it = m_placeholders.constFind(qMakePair(entry, str));
+    if (it == m_placeholders.constEnd()) {
+        return false;
+    }
+    result = it.value();
+    return true;
+}
+
+/**
+ * Remember a resolved placeholder string. It is dropped if the database
+ * changed since the generation was obtained from placeholder().
+ */
+void EntryReferenceIndex::insertPlaceholder(const Entry* entry,
+                                            const QString& str,
+                                            const QString& result,
+                                            quint64 generation)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (generation != m_generation) {
+        return;
+    }
+    if (m_placeholders.size() >= MaxPlaceholders) {
+        m_placeholders.clear();
+    }
+    m_placeholders.insert(qMakePair(entry, str), result);
+}
+
+void EntryReferenceIndex::addEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+
+    invalidateLocked();
+    if (m_built) {
+        addEntryLocked(entry);
+    }
+}
+
+void EntryReferenceIndex::removeEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+
+    invalidateLocked();
+    if (m_built) {
+        removeEntryLocked(entry);
+    }
+}
+
+/**
+ * Index the current field values of a modified entry.
+ */
+void EntryReferenceIndex::updateEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+
+    invalidateLocked();
+    if (m_built && m_keys.contains(entry)) {
+        removeEntryLocked(entry);
+        addEntryLocked(entry);
+    }
+}
+
+/**
+ * Forget the resolved placeholder strings.
+ */
+void EntryReferenceIndex::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    invalidateLocked();
+}
+
+void EntryReferenceIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    invalidateLocked();
+    m_entries.clear();
+    m_keys.clear();
+    m_built = false;
+}
+
+void EntryReferenceIndex::addEntryLocked(Entry* entry)
+{
+    const QList<Key> entryKeys = keys(entry);
+    for (const Key& key : entryKeys) {
+        m_entries[key].append(entry);
+    }
+    m_keys.insert(entry, entryKeys);
+}
+
+void EntryReferenceIndex::removeEntryLocked(Entry* entry)
+{
+    const QList<Key> entryKeys = m_keys.take(entry);
+    for (const Key& key : entryKeys) {
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            it.value().removeOne(entry);
+            if (it.value().isEmpty()) {
+                m_entries.erase(it);
+            }
+        }
+    }
+}
+
+void EntryReferenceIndex::invalidateLocked()
+{
+    ++m_generation;
+    m_placeholders.clear();
+}
+
+/**
+ * Values an entry can be referenced by. Uuid references are resolved through
+ * the uuid index of the database instead.
+ */
+QList<EntryReferenceIndex::Key> EntryReferenceIndex::keys(const Entry* entry)
+{
+    QList<Key> keys;
+    auto addKey = [&keys](EntryReferenceType type, const QString& value) {
+        const Key key(static_cast<int>(type), value);
+        if (!value.isEmpty() && !keys.contains(key)) {
+            keys.append(key);
+        }
+    };
+
+    addKey(EntryReferenceType::Title, entry->title());
+    addKey(EntryReferenceType::UserName, entry->username());
+    addKey(EntryReferenceType::Password, entry->password());
+    addKey(EntryReferenceType::Url, entry->url());
+    addKey(EntryReferenceType::Notes, entry->notes());
+
+    const EntryAttributes* attributes = entry->attributes();
+    const QList<QString> attributeKeys = attributes->keys();
+    for (const QString& key : attributeKeys) {
+        addKey(EntryReferenceType::CustomAttributes, attributes->value(key));
+    }
+
+    return keys;
+}
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KEEPASSX_ENTRYREFERENCEINDEX_H
+#define KEEPASSX_ENTRYREFERENCEINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+
+class Entry;
+class Group;
+enum class EntryReferenceType;
+
+/**
+ * Lookup structures for resolving the placeholders of the entries of a
+ * database.
+ *
+ * The index maps the field values that {REF:...} placeholders search in to
+ * the entries having them. It is built on the first lookup and then kept up
+ * to date by the database as entries are added, modified and removed.
+ *
+ * Resolved placeholder strings are remembered until anything in the
+ * database changes.
+ */
+class EntryReferenceIndex
+{
+public:
+    EntryReferenceIndex();
+
+    Entry* find(const Group* rootGroup, EntryReferenceType referenceType, const QString& term);
+
+    bool placeholder(const Entry* entry, const QString& str, QString& result, quint64& generation) const;
+    void insertPlaceholder(const Entry* entry, const QString& str, const QString& result, quint64 generation);
+
+    void addEntry(Entry* entry);
+    void removeEntry(Entry* entry);
+    void updateEntry(Entry* entry);
+    void invalidate();
+    void clear();
+
+    static const int MaxPlaceholders;
+
+private:
+    typedef QPair<int, QString> Key;
+
+    void addEntryLocked(Entry* entry);
+    void removeEntryLocked(Entry* entry);
+    void invalidateLocked();
+    static QList<Key> keys(const Entry* entry);
+
+    mutable QMutex m_mutex;
+    bool m_built;
+    QHash<Key, QList<Entry*>> m_entries;
+    QHash<const Entry*, QList<Key>> m_keys;
+    QHash<QPair<const Entry*, QString>, QString> m_placeholders;
+    quint64 m_generation;
+};
+
+#endif // KEEPASSX_ENTRYREFERENCEINDEX_H
@@ -0,0 +1,402 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EntrySearchIndex.h"
+
+#include "core/Entry.h"
+#include "core/Global.h"
+#include "core/Group.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    typedef EntrySearcher::Field Field;
+
+    // trigram that never occurs in text, marks the entries to check for every term on a field
+    const quint64 UnindexedTrigram = Q_UINT64_C(0xFFFFFFFFFFFF);
+
+    // the searcher matches terms without a field against these
+    const QList<Field> DefaultFields{Field::Title, Field::Username, Field::Url, Field::Notes};
+
+    quint64 trigramKey(Field field, const QChar* trigram)
+    {
+        return (static_cast<quint64>(field) << 48) | (static_cast<quint64>(trigram[0].unicode()) << 32)
+               | (static_cast<quint64>(trigram[1].unicode()) << 16) | trigram[2].unicode();
+    }
+
+    quint64 unindexedKey(Field field)
+    {
+        return (static_cast<quint64>(field) << 48) | UnindexedTrigram;
+    }
+
+    void addTrigrams(Field field, const QString& text, QVector<quint64>& keys)
+    {
+        const QString folded = text.toCaseFolded();
+        for (int i = 0; i + 3 <= folded.size(); ++i) {
+            keys.append(trigramKey(field, folded.constData() + i));
+        }
+    }
+
+    QVector<quint64> entryKeys(const Entry* entry)
+    {
+        QVector<quint64> keys;
+        const EntryAttributes* attributes = entry->attributes();
+
+        // title, username and url are searched with their placeholders resolved
+        auto addField = [&](Field field, const QString& key, bool resolved) {
+            const QString value = attributes->value(key);
+            if (attributes->isProtected(key) || (resolved && value.contains('{'))) {
+                keys.append(unindexedKey(field));
+            } else {
+                addTrigrams(field, value, keys);
+            }
+        };
+        addField(Field::Title, EntryAttributes::TitleKey, true);
+        addField(Field::Username, EntryAttributes::UserNameKey, true);
+        addField(Field::Url, EntryAttributes::URLKey, true);
+        addField(Field::Notes, EntryAttributes::NotesKey, false);
+
+        const QList<QString> customKeys = attributes->customKeys();
+        for (const QString& key : customKeys) {
+            addTrigrams(Field::AttributeKV, key, keys);
+            if (attributes->isProtected(key)) {
+                keys.append(unindexedKey(Field::AttributeKV));
+            } else {
+                addTrigrams(Field::AttributeKV, attributes->value(key), keys);
+            }
+        }
+
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    QList<Field> termFields(const EntrySearcher::SearchTerm& term)
+    {
+        if (term.exclude) {
+            return {};
+        }
+
+        switch (term.field) {
+        case Field::Undefined:
+            return DefaultFields;
+        case Field::Title:
+        case Field::Username:
+        case Field::Url:
+        case Field::Notes:
+        case Field::AttributeKV:
+            return {term.field};
+        default:
+            return {};
+        }
+    }
+
+    bool hasTrigram(const QStringList& literals)
+    {
+        for (const QString& literal : literals) {
+            if (literal.size() >= 3) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    QVector<int> intersect(const QVector<int>& lhs, const QVector<int>& rhs)
+    {
+        QVector<int> result;
+        std::set_intersection(
+            lhs.constBegin(), lhs.constEnd(), rhs.constBegin(), rhs.constEnd(), std::back_inserter(result));
+        return result;
+    }
+
+    QVector<int> unite(const QVector<int>& lhs, const QVector<int>& rhs)
+    {
+        QVector<int> result;
+        std::set_union(lhs.constBegin(), lhs.constEnd(), rhs.constBegin(), rhs.constEnd(), std::back_inserter(result));
+        return result;
+    }
+} // namespace
+
+EntrySearchIndex::EntrySearchIndex()
+    : m_built(false)
+    , m_generation(0)
+{
+}
+
+/**
+ * Find the entries that can match all search terms. Terms the index can't
+ * narrow down, such as excluding terms or regular expressions with
+ * alternatives, don't restrict the result.
+ *
+ * @param rootGroup root group of the database, used to build the index
+ * @param searchTerms terms of the search
+ * @param result receives the candidate entries
+ * @return false if no term could be used, all entries are candidates then
+ */
+bool EntrySearchIndex::candidates(const Group* rootGroup,
+                                  const QList<EntrySearcher::SearchTerm>& searchTerms,
+                                  QSet<const Entry*>& result)
+{
+    QList<const EntrySearcher::SearchTerm*> indexedTerms;
+    for (const EntrySearcher::SearchTerm& term : searchTerms) {
+        if (!termFields(term).isEmpty() && hasTrigram(literals(term.regex))) {
+            indexedTerms.append(&term);
+        }
+    }
+    if (indexedTerms.isEmpty()) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    buildLocked(rootGroup);
+
+    QVector<int> ids;
+    for (int i = 0; i < indexedTerms.size(); ++i) {
+        const EntrySearcher::SearchTerm& term = *indexedTerms.at(i);
+        const QStringList termLiterals = literals(term.regex);
+
+        QVector<int> termIds;
+        const QList<Field> fields = termFields(term);
+        for (Field field : fields) {
+            termIds = unite(termIds, fieldCandidates(field, termLiterals));
+        }
+
+        ids = i == 0 ? termIds : intersect(ids, termIds);
+        if (ids.isEmpty()) {
+            break;
+        }
+    }
+
+    result.clear();
+    result.reserve(ids.size());
+    for (int id : asConst(ids)) {
+        result.insert(m_entries.at(id));
+    }
+    return true;
+}
+
+/**
+ * Build the index or bring it up to date, so the next search doesn't
+ * have to. Call this while the application is idle.
+ *
+ * @param rootGroup root group of the database
+ */
+void EntrySearchIndex::build(const Group* rootGroup)
+{
+    QMutexLocker locker(&m_mutex);
+    buildLocked(rootGroup);
+}
+
+void EntrySearchIndex::addEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    if (m_built && !m_ids.contains(entry)) {
+        addEntryLocked(entry);
+    }
+}
+
+void EntrySearchIndex::removeEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    if (m_built) {
+        removeEntryLocked(entry);
+        m_dirty.remove(entry);
+    }
+}
+
+/**
+ * Index a modified entry again on the next search.
+ */
+void EntrySearchIndex::updateEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    if (m_built && m_ids.contains(entry)) {
+        m_dirty.insert(entry);
+    }
+}
+
+/**
+ * Note a change of the database that can affect search results but not the
+ * index, such as modified groups.
+ */
+void EntrySearchIndex::markChanged()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+}
+
+void EntrySearchIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_ids.clear();
+    m_keys.clear();
+    m_postings.clear();
+    m_dirty.clear();
+    m_built = false;
+    ++m_generation;
+}
+
+/**
+ * Counter of the changes to the database, a search is still valid while it
+ * doesn't change.
+ */
+quint64 EntrySearchIndex::generation() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_generation;
+}
+
+/**
+ * Get the literal strings every match of a regular expression contains.
+ * The search terms are converted to simple expressions, anything beyond
+ * escaped characters, wildcards and anchors results in an empty list.
+ */
+QStringList EntrySearchIndex::literals(const QRegularExpression& regex)
+{
+    const QString pattern = regex.pattern();
+    QStringList literals;
+    QString literal;
+
+    auto flush = [&]() {
+        if (!literal.isEmpty()) {
+            literals.append(literal);
+            literal.clear();
+        }
+    };
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == '\\') {
+            if (i + 1 >= pattern.size() || pattern.at(i + 1).isLetterOrNumber()) {
+                return {};
+            }
+            literal.append(pattern.at(++i));
+        } else if (c == '.') {
+            flush();
+        } else if (c == '*' || c == '?') {
+            // the preceding character is optional
+            literal.chop(1);
+            flush();
+        } else if (c == '+') {
+            flush();
+        } else if ((c == '^' && i == 0) || (c == '$' && i == pattern.size() - 1)) {
+            flush();
+        } else if (QStringLiteral("^$|()[]{}").contains(c)) {
+            return {};
+        } else {
+            literal.append(c);
+        }
+    }
+    flush();
+
+    return literals;
+}
+
+void EntrySearchIndex::buildLocked(const Group* rootGroup)
+{
+    // entries are indexed again under a new id when modified, start over once most ids are unused
+    if (!m_built || m_entries.size() > 2 * m_ids.size() + 1024) {
+        m_entries.clear();
+        m_ids.clear();
+        m_keys.clear();
+        m_postings.clear();
+        m_dirty.clear();
+        const QList<Entry*> entries = rootGroup->entriesRecursive();
+        for (Entry* entry : entries) {
+            addEntryLocked(entry);
+        }
+        m_built = true;
+    } else {
+        updateDirtyLocked();
+    }
+}
+
+void EntrySearchIndex::addEntryLocked(Entry* entry)
+{
+    // ids only grow, so appending keeps the postings sorted
+    const int id = m_entries.size();
+    m_entries.append(entry);
+    m_ids.insert(entry, id);
+
+    const QVector<quint64> keys = entryKeys(entry);
+    for (quint64 key : keys) {
+        m_postings[key].append(id);
+    }
+    m_keys.insert(entry, keys);
+}
+
+void EntrySearchIndex::removeEntryLocked(const Entry* entry)
+{
+    auto it = m_ids.find(entry);
+    if (it == m_ids.end()) {
+        return;
+    }
+
+    const int id = it.value();
+    m_ids.erase(it);
+    m_entries[id] = nullptr;
+
+    const QVector<quint64> keys = m_keys.take(entry);
+    for (quint64 key : keys) {
+        auto posting = m_postings.find(key);
+        if (posting == m_postings.end()) {
+            continue;
+        }
+        QVector<int>& ids = posting.value();
+        auto position = std::lower_bound(ids.begin(), ids.end(), id);
+        if (position != ids.end() && *position == id) {
+            ids.erase(position);
+        }
+        if (ids.isEmpty()) {
+            m_postings.erase(posting);
+        }
+    }
+}
+
+void EntrySearchIndex::updateDirtyLocked()
+{
+    for (Entry* entry : asConst(m_dirty)) {
+        removeEntryLocked(entry);
+        addEntryLocked(entry);
+    }
+    m_dirty.clear();
+}
+
+QVector<int> EntrySearchIndex::fieldCandidates(EntrySearcher::Field field, const QStringList& literals) const
+{
+    QVector<int> ids;
+    bool constrained = false;
+    for (const QString& literal : literals) {
+        const QString folded = literal.toCaseFolded();
+        for (int i = 0; i + 3 <= folded.size(); ++i) {
+            const QVector<int> posting = m_postings.value(trigramKey(field, folded.constData() + i));
+            ids = constrained ? intersect(ids, posting) : posting;
+            constrained = true;
+            if (ids.isEmpty()) {
+                break;
+            }
+        }
+    }
+
+    return unite(ids, m_postings.value(unindexedKey(field)));
+}
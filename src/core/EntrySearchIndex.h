@@ -0,0 +1,78 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KEEPASSX_ENTRYSEARCHINDEX_H
+#define KEEPASSX_ENTRYSEARCHINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QVector>
+
+#include "core/EntrySearcher.h"
+
+/**
+ * Trigram index over the searchable fields of the entries of a database.
+ *
+ * The index narrows down the entries that can match a search, the search
+ * terms are still matched against each remaining entry. It is built on the
+ * first search and then kept up to date by the database as entries are
+ * added, modified and removed. Modified entries are indexed again on the
+ * next search. The database widget builds it ahead of time while idle.
+ *
+ * Passwords and protected values are never indexed. Fields that are
+ * protected or contain placeholders make the entry a candidate for every
+ * term searching that field.
+ */
+class EntrySearchIndex
+{
+public:
+    EntrySearchIndex();
+
+    bool candidates(const Group* rootGroup,
+                    const QList<EntrySearcher::SearchTerm>& searchTerms,
+                    QSet<const Entry*>& result);
+    void build(const Group* rootGroup);
+
+    void addEntry(Entry* entry);
+    void removeEntry(Entry* entry);
+    void updateEntry(Entry* entry);
+    void markChanged();
+    void clear();
+    quint64 generation() const;
+
+    static QStringList literals(const QRegularExpression& regex);
+
+private:
+    void buildLocked(const Group* rootGroup);
+    void addEntryLocked(Entry* entry);
+    void removeEntryLocked(const Entry* entry);
+    void updateDirtyLocked();
+    QVector<int> fieldCandidates(EntrySearcher::Field field, const QStringList& literals) const;
+
+    mutable QMutex m_mutex;
+    bool m_built;
+    quint64 m_generation;
+    QVector<Entry*> m_entries;
+    QHash<const Entry*, int> m_ids;
+    QHash<const Entry*, QVector<quint64>> m_keys;
+    QHash<quint64, QVector<int>> m_postings;
+    QSet<Entry*> m_dirty;
+};
+
+#endif // KEEPASSX_ENTRYSEARCHINDEX_H
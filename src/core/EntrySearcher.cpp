@@ -18,9 +18,44 @@
 
 #include "EntrySearcher.h"
 
+#include "core/Database.h"
+#include "core/EntrySearchIndex.h"
 #include "core/Group.h"
 #include "core/Tools.h"
 
+#include <QThreadPool>
+#include <QtConcurrent>
+
+namespace
+{
+    // below this number of entries a search isn't worth spreading over threads
+    const int ParallelSearchThreshold = 1000;
+
+    /**
+     * Get the text a regular expression matches, a null string if the
+     * expression contains anything but literal characters.
+     */
+    QString literalText(const QRegularExpression& regex)
+    {
+        const QString pattern = regex.pattern();
+        QString text;
+        for (int i = 0; i < pattern.size(); ++i) {
+            const QChar c = pattern.at(i);
+            if (c == '\\') {
+                if (i + 1 >= pattern.size() || pattern.at(i + 1).isLetterOrNumber()) {
+                    return {};
+                }
+                text.append(pattern.at(++i));
+            } else if (QStringLiteral(".^$|()[]{}*+?").contains(c)) {
+                return {};
+            } else {
+                text.append(c);
+            }
+        }
+        return text;
+    }
+} // namespace
+
 EntrySearcher::EntrySearcher(bool caseSensitive, bool skipProtected)
     : m_caseSensitive(caseSensitive)
     , m_skipProtected(skipProtected)
@@ -69,18 +104,24 @@ QList<Entry*> EntrySearcher::search(const QString& searchString, const Group* ba
 QList<Entry*> EntrySearcher::repeat(const Group* baseGroup, bool forceSearch)
 {
     Q_ASSERT(baseGroup);
+    return repeatEntries(candidates(baseGroup, forceSearch));
+}
 
-    QList<Entry*> results;
-    for (const auto group : baseGroup->groupsRecursive(true)) {
-        if (forceSearch || group->resolveSearchingEnabled()) {
-            for (const auto entry : group->entries()) {
-                if (searchEntryImpl(entry)) {
-                    results.append(entry);
-                }
-            }
-        }
-    }
-    return results;
+/**
+ * Parse the search string without searching yet. The returned entries
+ * can then be searched in batches using repeatEntries(), which allows
+ * spreading a search over time and cancelling it.
+ *
+ * @param searchString search terms
+ * @param baseGroup group to start search from, cannot be null
+ * @param forceSearch ignore group search settings
+ * @return entries that have to be searched, in the order of the results
+ */
+QList<Entry*> EntrySearcher::prepare(const QString& searchString, const Group* baseGroup, bool forceSearch)
+{
+    Q_ASSERT(baseGroup);
+    parseSearchTerms(searchString);
+    return candidates(baseGroup, forceSearch);
 }
 
 /**
@@ -92,6 +133,7 @@ QList<Entry*> EntrySearcher::repeat(const Group* baseGroup, bool forceSearch)
  */
 QList<Entry*> EntrySearcher::searchEntries(const QList<SearchTerm>& searchTerms, const QList<Entry*>& entries)
 {
+    m_lastSearch = LastSearch();
     m_searchTerms = searchTerms;
     return repeatEntries(entries);
 }
@@ -106,6 +148,7 @@ QList<Entry*> EntrySearcher::searchEntries(const QList<SearchTerm>& searchTerms,
  */
 QList<Entry*> EntrySearcher::searchEntries(const QString& searchString, const QList<Entry*>& entries)
 {
+    m_lastSearch = LastSearch();
     parseSearchTerms(searchString);
     return repeatEntries(entries);
 }
@@ -119,11 +162,29 @@ QList<Entry*> EntrySearcher::searchEntries(const QString& searchString, const QL
 QList<Entry*> EntrySearcher::repeatEntries(const QList<Entry*>& entries)
 {
     QList<Entry*> results;
-    for (auto* entry : entries) {
-        if (searchEntryImpl(entry)) {
-            results.append(entry);
+    if (entries.size() >= ParallelSearchThreshold && QThreadPool::globalInstance()->maxThreadCount() > 1) {
+        // Compile the expressions up front, the entries are matched independently and keep their order
+        for (const auto& term : asConst(m_searchTerms)) {
+            term.regex.optimize();
+        }
+        results = QtConcurrent::blockingFiltered(entries, [this](const Entry* entry) { return searchEntryImpl(entry); });
+    } else {
+        for (auto* entry : entries) {
+            if (searchEntryImpl(entry)) {
+                results.append(entry);
+            }
+        }
+    }
+
+    // Collect the matches of a group search, which may be checked in several batches
+    if (m_lastSearch.unchecked > 0) {
+        m_lastSearch.unchecked -= entries.size();
+        m_lastSearch.matches.append(results);
+        if (m_lastSearch.unchecked < 0) {
+            m_lastSearch = LastSearch();
         }
     }
+
     return results;
 }
 
@@ -142,15 +203,110 @@ bool EntrySearcher::isCaseSensitive() const
     return m_caseSensitive;
 }
 
-bool EntrySearcher::searchEntryImpl(const Entry* entry)
+/**
+ * Get the entries of a group and its children that can match the current
+ * search terms. If the terms only narrow down the previous search of the
+ * same group and the database is unchanged, only its matches are returned.
+ */
+QList<Entry*> EntrySearcher::candidates(const Group* baseGroup, bool forceSearch)
+{
+    const Database* db = baseGroup->database();
+    const Group* rootGroup = baseGroup;
+    while (rootGroup->parentGroup()) {
+        rootGroup = rootGroup->parentGroup();
+    }
+    // Only groups of the database tree are indexed and tracked for changes
+    if (!db || rootGroup != db->rootGroup()) {
+        m_lastSearch = LastSearch();
+        QList<Entry*> entries;
+        const QList<const Group*> groups = baseGroup->groupsRecursive(true);
+        for (const auto group : groups) {
+            if (forceSearch || group->resolveSearchingEnabled()) {
+                entries.append(group->entries());
+            }
+        }
+        return entries;
+    }
+
+    const quint64 generation = db->searchIndex()->generation();
+    QList<Entry*> entries;
+    if (m_lastSearch.baseGroup == baseGroup && m_lastSearch.unchecked == 0 && m_lastSearch.forceSearch == forceSearch
+        && m_lastSearch.database == db->uuid() && m_lastSearch.generation == generation
+        && isRefinement(m_lastSearch.searchTerms, m_searchTerms)) {
+        entries = m_lastSearch.matches;
+    } else {
+        // Skip the entries the search index rules out
+        QSet<const Entry*> indexed;
+        const bool useIndex = db->searchIndex()->candidates(rootGroup, m_searchTerms, indexed);
+
+        const QList<const Group*> groups = baseGroup->groupsRecursive(true);
+        for (const auto group : groups) {
+            if (forceSearch || group->resolveSearchingEnabled()) {
+                for (const auto entry : group->entries()) {
+                    if (!useIndex || indexed.contains(entry)) {
+                        entries.append(entry);
+                    }
+                }
+            }
+        }
+    }
+
+    m_lastSearch.baseGroup = baseGroup;
+    m_lastSearch.forceSearch = forceSearch;
+    m_lastSearch.database = db->uuid();
+    m_lastSearch.generation = generation;
+    m_lastSearch.searchTerms = m_searchTerms;
+    m_lastSearch.matches.clear();
+    m_lastSearch.unchecked = entries.size();
+    return entries;
+}
+
+/**
+ * Check if every entry matching the search terms also matches the previous
+ * terms, as when the last term is extended or terms are added.
+ */
+bool EntrySearcher::isRefinement(const QList<SearchTerm>& previousTerms, const QList<SearchTerm>& searchTerms)
 {
-    // Pre-load in case they are needed
-    auto attributes_keys = entry->attributes()->customKeys();
-    auto attributes = QStringList(attributes_keys + entry->attributes()->values(attributes_keys));
-    auto attachments = QStringList(entry->attachments()->keys());
-    // Build a group hierarchy to allow searching for e.g. /group1/subgroup*
-    auto hierarchy = entry->group()->hierarchy().join('/').prepend("/");
+    if (searchTerms.size() < previousTerms.size()) {
+        return false;
+    }
 
+    for (int i = 0; i < previousTerms.size(); ++i) {
+        const SearchTerm& previous = previousTerms.at(i);
+        const SearchTerm& term = searchTerms.at(i);
+        if (previous.field != term.field || previous.exclude != term.exclude
+            || previous.regex.patternOptions() != term.regex.patternOptions()) {
+            return false;
+        }
+        // the word selects the attribute or whether the group path is searched
+        if (previous.field == Field::AttributeValue && previous.word != term.word) {
+            return false;
+        }
+        if (previous.field == Field::Group && previous.word.contains('/') != term.word.contains('/')) {
+            return false;
+        }
+        if (previous.regex.pattern() == term.regex.pattern()) {
+            continue;
+        }
+        // a longer text excludes more entries, except for excluded terms
+        const QString previousText = literalText(previous.regex);
+        const QString text = literalText(term.regex);
+        const Qt::CaseSensitivity cs =
+            term.regex.patternOptions().testFlag(QRegularExpression::CaseInsensitiveOption) ? Qt::CaseInsensitive
+                                                                                            : Qt::CaseSensitive;
+        if (term.exclude || previousText.isNull() || text.isNull() || !text.contains(previousText, cs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Match an entry against the search terms. May be called from several
+ * threads at once, as long as the database isn't modified meanwhile.
+ */
+bool EntrySearcher::searchEntryImpl(const Entry* entry) const
+{
     // By default, empty term matches every entry.
     // However when skipping protected fields, we will recject everything instead
     bool found = !m_skipProtected;
@@ -174,11 +330,14 @@ bool EntrySearcher::searchEntryImpl(const Entry* entry)
         case Field::Notes:
             found = term.regex.match(entry->notes()).hasMatch();
             break;
-        case Field::AttributeKV:
+        case Field::AttributeKV: {
+            const auto attributes_keys = entry->attributes()->customKeys();
+            const auto attributes = QStringList(attributes_keys + entry->attributes()->values(attributes_keys));
             found = !attributes.filter(term.regex).empty();
             break;
+        }
         case Field::Attachment:
-            found = !attachments.filter(term.regex).empty();
+            found = !QStringList(entry->attachments()->keys()).filter(term.regex).empty();
             break;
         case Field::AttributeValue:
             if (m_skipProtected && entry->attributes()->isProtected(term.word)) {
@@ -190,6 +349,8 @@ bool EntrySearcher::searchEntryImpl(const Entry* entry)
         case Field::Group:
             // Match against the full hierarchy if the word contains a '/' otherwise just the group name
             if (term.word.contains('/')) {
+                // Build a group hierarchy to allow searching for e.g. /group1/subgroup*
+                const auto hierarchy = entry->group()->hierarchy().join('/').prepend("/");
                 found = term.regex.match(hierarchy).hasMatch();
             } else {
                 found = term.regex.match(entry->group()->name()).hasMatch();
@@ -21,6 +21,7 @@
 
 #include <QRegularExpression>
 #include <QString>
+#include <QUuid>
 
 class Group;
 class Entry;
@@ -56,6 +57,7 @@ public:
     QList<Entry*> search(const QList<SearchTerm>& searchTerms, const Group* baseGroup, bool forceSearch = false);
     QList<Entry*> search(const QString& searchString, const Group* baseGroup, bool forceSearch = false);
     QList<Entry*> repeat(const Group* baseGroup, bool forceSearch = false);
+    QList<Entry*> prepare(const QString& searchString, const Group* baseGroup, bool forceSearch = false);
 
     QList<Entry*> searchEntries(const QList<SearchTerm>& searchTerms, const QList<Entry*>& entries);
     QList<Entry*> searchEntries(const QString& searchString, const QList<Entry*>& entries);
@@ -65,13 +67,33 @@ public:
     bool isCaseSensitive() const;
 
 private:
-    bool searchEntryImpl(const Entry* entry);
+    /**
+     * Previous search of a group in a database. Its matches are searched
+     * again when the next query is an extension of it.
+     */
+    struct LastSearch
+    {
+        const Group* baseGroup = nullptr;
+        bool forceSearch = false;
+        QUuid database;
+        quint64 generation = 0;
+        QList<SearchTerm> searchTerms;
+        QList<Entry*> matches;
+        // number of entries that still have to be passed to repeatEntries()
+        int unchecked = 0;
+    };
+
+    QList<Entry*> candidates(const Group* baseGroup, bool forceSearch);
+    bool searchEntryImpl(const Entry* entry) const;
     void parseSearchTerms(const QString& searchString);
 
+    static bool isRefinement(const QList<SearchTerm>& previousTerms, const QList<SearchTerm>& searchTerms);
+
     bool m_caseSensitive;
     bool m_skipProtected;
     QRegularExpression m_termParser;
     QList<SearchTerm> m_searchTerms;
+    LastSearch m_lastSearch;
 
     friend class TestEntrySearcher;
 };
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EntryUrlIndex.h"
+
+#include "core/Entry.h"
+#include "core/Global.h"
+#include "core/Group.h"
+#include "core/Tools.h"
+
+#include <QUrl>
+#include <algorithm>
+
+// attribute keys of additional URLs, as used by KeePass2Android
+const QString EntryUrlIndex::AdditionalUrlPrefix = QStringLiteral("KP2A_URL");
+
+namespace
+{
+    /**
+     * Get the base domain of a URL the way BrowserService matches entry URLs.
+     * URLs without a host never match, the base domain itself may be empty.
+     */
+    bool urlDomain(const QString& url, QString& domain)
+    {
+        if (url.isEmpty()) {
+            return false;
+        }
+
+        const QUrl qurl = url.contains("://") ? QUrl(url) : QUrl::fromUserInput(url);
+        if (qurl.host().isEmpty()) {
+            return false;
+        }
+
+        domain = Tools::baseDomain(qurl.host());
+        return true;
+    }
+} // namespace
+
+EntryUrlIndex::EntryUrlIndex()
+    : m_built(false)
+{
+}
+
+/**
+ * Find the entries with a URL on a base domain.
+ *
+ * @param rootGroup root group of the database, used to build the index
+ * @param domain base domain of the site, as returned by Tools::baseDomain()
+ * @return entries in the order of a search through the groups
+ */
+QList<Entry*> EntryUrlIndex::entries(const Group* rootGroup, const QString& domain)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_built) {
+        const QList<Entry*> allEntries = rootGroup->entriesRecursive();
+        for (Entry* entry : allEntries) {
+            addEntryLocked(entry);
+        }
+        m_built = true;
+    } else {
+        for (Entry* entry : asConst(m_dirty)) {
+            removeEntryLocked(entry);
+            addEntryLocked(entry);
+        }
+    }
+    m_dirty.clear();
+
+    QList<Entry*> entries = m_entries.value(domain);
+    locker.unlock();
+
+    if (entries.size() > 1) {
+        QHash<const Entry*, QVector<int>> paths;
+        for (const Entry* entry : asConst(entries)) {
+            paths.insert(entry, entry->traversalPath());
+        }
+        std::sort(entries.begin(), entries.end(), [&paths](const Entry* lhs, const Entry* rhs) {
+            return paths.value(lhs) < paths.value(rhs);
+        });
+    }
+    return entries;
+}
+
+void EntryUrlIndex::addEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_built && !m_domains.contains(entry)) {
+        addEntryLocked(entry);
+    }
+}
+
+void EntryUrlIndex::removeEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_built) {
+        removeEntryLocked(entry);
+        m_dirty.remove(entry);
+    }
+}
+
+/**
+ * Index a modified entry again on the next lookup.
+ */
+void EntryUrlIndex::updateEntry(Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_built && m_domains.contains(entry)) {
+        m_dirty.insert(entry);
+    }
+}
+
+void EntryUrlIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_domains.clear();
+    m_dirty.clear();
+    m_built = false;
+}
+
+/**
+ * Get the base domains of the URL and the additional URLs of an entry.
+ */
+QStringList EntryUrlIndex::domains(const Entry* entry)
+{
+    QStringList domains;
+    QString domain;
+    if (urlDomain(entry->url(), domain)) {
+        domains.append(domain);
+    }
+
+    const QList<QString> keys = entry->attributes()->customKeys();
+    for (const QString& key : keys) {
+        if (key.startsWith(AdditionalUrlPrefix) && urlDomain(entry->attributes()->value(key), domain)
+            && !domains.contains(domain)) {
+            domains.append(domain);
+        }
+    }
+    return domains;
+}
+
+void EntryUrlIndex::addEntryLocked(Entry* entry)
+{
+    const QStringList entryDomains = domains(entry);
+    for (const QString& domain : entryDomains) {
+        m_entries[domain].append(entry);
+    }
+    m_domains.insert(entry, entryDomains);
+}
+
+void EntryUrlIndex::removeEntryLocked(const Entry* entry)
+{
+    const QStringList entryDomains = m_domains.take(entry);
+    for (const QString& domain : entryDomains) {
+        auto it = m_entries.find(domain);
+        if (it == m_entries.end()) {
+            continue;
+        }
+        it.value().removeOne(const_cast<Entry*>(entry));
+        if (it.value().isEmpty()) {
+            m_entries.erase(it);
+        }
+    }
+}
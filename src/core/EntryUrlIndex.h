@@ -0,0 +1,65 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_ENTRYURLINDEX_H
+#define KEEPASSX_ENTRYURLINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+
+class Entry;
+class Group;
+
+/**
+ * Index of the entries of a database by the base domain of their URLs.
+ *
+ * Both the URL of an entry and its additional URL attributes are indexed,
+ * so a lookup finds every entry one of whose URLs shares the base domain of
+ * a site. It is built on the first lookup and then kept up to date by the
+ * database as entries are added, modified and removed. Modified entries are
+ * indexed again on the next lookup.
+ */
+class EntryUrlIndex
+{
+public:
+    EntryUrlIndex();
+
+    QList<Entry*> entries(const Group* rootGroup, const QString& domain);
+
+    void addEntry(Entry* entry);
+    void removeEntry(Entry* entry);
+    void updateEntry(Entry* entry);
+    void clear();
+
+    static QStringList domains(const Entry* entry);
+
+    static const QString AdditionalUrlPrefix;
+
+private:
+    void addEntryLocked(Entry* entry);
+    void removeEntryLocked(const Entry* entry);
+
+    QMutex m_mutex;
+    bool m_built;
+    QHash<QString, QList<Entry*>> m_entries;
+    QHash<const Entry*, QStringList> m_domains;
+    QSet<Entry*> m_dirty;
+};
+
+#endif // KEEPASSX_ENTRYURLINDEX_H
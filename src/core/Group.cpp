@@ -22,6 +22,7 @@
 #include "core/Clock.h"
 #include "core/Config.h"
 #include "core/DatabaseIcons.h"
+#include "core/EntryReferenceIndex.h"
 #include "core/Global.h"
 #include "core/Metadata.h"
 #include "core/Tools.h"
@@ -32,6 +33,20 @@
 
 #include <QtConcurrent>
 
+namespace
+{
+    // true if the group is the given group or one of its subgroups
+    bool isInSubtree(const Group* group, const Group* ancestor)
+    {
+        for (; group; group = group->parentGroup()) {
+            if (group == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace
+
 const int Group::DefaultIconNumber = 48;
 const int Group::RecycleBinIconNumber = 43;
 const QString Group::RootAutoTypeSequence = "{USERNAME}{TAB}{PASSWORD}{ENTER}";
@@ -73,6 +88,10 @@ Group::~Group()
         m_db->addDeletedObject(delGroup);
     }
 
+    if (m_db) {
+        m_db->unindexGroup(this);
+    }
+
     cleanupParent();
 }
 
@@ -313,7 +332,13 @@ bool Group::equals(const Group* other, CompareItemOptions options) const
 
 void Group::setUuid(const QUuid& uuid)
 {
+    if (m_db) {
+        m_db->unindexGroup(this);
+    }
     set(m_uuid, uuid);
+    if (m_db) {
+        m_db->indexGroup(this);
+    }
 }
 
 void Group::setName(const QString& name)
@@ -452,13 +477,16 @@ void Group::setParent(Group* parent, int index)
         emit groupAboutToAdd(this, index);
         Q_ASSERT(index <= parent->m_children.size());
         parent->m_children.insert(index, this);
+        parent->invalidateRecursiveCache();
     } else {
         emit aboutToMove(this, parent, index);
         m_parent->m_children.removeAll(this);
+        m_parent->invalidateRecursiveCache();
         m_parent = parent;
         QObject::setParent(parent);
         Q_ASSERT(index <= parent->m_children.size());
         parent->m_children.insert(index, this);
+        parent->invalidateRecursiveCache();
     }
 
     if (m_updateTimeinfo) {
@@ -548,22 +576,25 @@ const QList<Entry*>& Group::entries() const
     return m_entries;
 }
 
+/**
+ * Entries of the group and all its subgroups. The list is cached until the
+ * structure of the subtree changes, so getting it repeatedly is cheap.
+ */
 QList<Entry*> Group::entriesRecursive(bool includeHistoryItems) const
 {
-    QList<Entry*> entryList;
-
-    entryList.append(m_entries);
+    updateRecursiveCache();
+    if (!includeHistoryItems) {
+        return m_entriesRecursive;
+    }
 
-    if (includeHistoryItems) {
-        for (Entry* entry : m_entries) {
+    QList<Entry*> entryList;
+    for (const Group* group : asConst(m_groupsRecursive)) {
+        entryList.append(group->m_entries);
+        for (Entry* entry : group->m_entries) {
             entryList.append(entry->historyItems());
         }
     }
 
-    for (Group* group : m_children) {
-        entryList.append(group->entriesRecursive(includeHistoryItems));
-    }
-
     return entryList;
 }
 
@@ -580,6 +611,18 @@ Entry* Group::findEntryByUuid(const QUuid& uuid, bool recursive) const
         return nullptr;
     }
 
+    if (m_db) {
+        const auto& index = m_db->m_entryIndex;
+        for (auto it = index.constFind(uuid); it != index.constEnd() && it.key() == uuid; ++it) {
+            Entry* entry = it.value();
+            if (recursive ? isInSubtree(entry->group(), this) : entry->group() == this) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    // groups outside of a database aren't indexed
     auto entries = m_entries;
     if (recursive) {
         entries = entriesRecursive(false);
@@ -615,6 +658,13 @@ Entry* Group::findEntryBySearchTerm(const QString& term, EntryReferenceType refe
                "Database::findEntryRecursive",
                "Can't search entry with \"referenceType\" parameter equal to \"Unknown\"");
 
+    if (referenceType == EntryReferenceType::QUuid) {
+        return findEntryByUuid(QUuid::fromRfc4122(QByteArray::fromHex(term.toLatin1())));
+    }
+    if (m_db && m_db->rootGroup() == this && referenceType != EntryReferenceType::Unknown && !term.isEmpty()) {
+        return m_db->m_referenceIndex->find(this, referenceType, term);
+    }
+
     const QList<Group*> groups = groupsRecursive(true);
 
     for (const Group* group : groups) {
@@ -753,30 +803,25 @@ QString Group::print(bool recursive, bool flatten, int depth)
 
 QList<const Group*> Group::groupsRecursive(bool includeSelf) const
 {
-    QList<const Group*> groupList;
-    if (includeSelf) {
-        groupList.append(this);
-    }
+    updateRecursiveCache();
 
-    for (const Group* group : asConst(m_children)) {
-        groupList.append(group->groupsRecursive(true));
+    QList<const Group*> groupList;
+    groupList.reserve(m_groupsRecursive.size());
+    for (int i = includeSelf ? 0 : 1; i < m_groupsRecursive.size(); ++i) {
+        groupList.append(m_groupsRecursive.at(i));
     }
 
     return groupList;
 }
 
+/**
+ * Group and all its subgroups in pre-order. Like entriesRecursive() the
+ * list is cached, the list including the group itself is not copied.
+ */
 QList<Group*> Group::groupsRecursive(bool includeSelf)
 {
-    QList<Group*> groupList;
-    if (includeSelf) {
-        groupList.append(this);
-    }
-
-    for (Group* group : asConst(m_children)) {
-        groupList.append(group->groupsRecursive(true));
-    }
-
-    return groupList;
+    updateRecursiveCache();
+    return includeSelf ? m_groupsRecursive : m_groupsRecursive.mid(1);
 }
 
 QSet<QUuid> Group::customIconsRecursive() const
@@ -787,11 +832,15 @@ QSet<QUuid> Group::customIconsRecursive() const
         result.insert(iconUuid());
     }
 
-    const QList<Entry*> entryList = entriesRecursive(true);
-    for (Entry* entry : entryList) {
+    for (Entry* entry : m_entries) {
         if (!entry->iconUuid().isNull()) {
             result.insert(entry->iconUuid());
         }
+        for (const EntrySnapshot& historyItem : entry->historySnapshots()) {
+            if (!historyItem.data().customIcon.isNull()) {
+                result.insert(historyItem.data().customIcon);
+            }
+        }
     }
 
     for (Group* group : m_children) {
@@ -843,7 +892,19 @@ Group* Group::findGroupByUuid(const QUuid& uuid)
         return nullptr;
     }
 
-    for (Group* group : groupsRecursive(true)) {
+    if (m_db) {
+        const auto& index = m_db->m_groupIndex;
+        for (auto it = index.constFind(uuid); it != index.constEnd() && it.key() == uuid; ++it) {
+            if (isInSubtree(it.value(), this)) {
+                return it.value();
+            }
+        }
+        return nullptr;
+    }
+
+    // groups outside of a database aren't indexed
+    const QList<Group*> groups = groupsRecursive(true);
+    for (Group* group : groups) {
         if (group->uuid() == uuid) {
             return group;
         }
@@ -927,9 +988,11 @@ void Group::addEntry(Entry* entry)
     emit entryAboutToAdd(entry);
 
     m_entries << entry;
+    invalidateRecursiveCache();
     connect(entry, SIGNAL(entryDataChanged(Entry*)), SIGNAL(entryDataChanged(Entry*)));
     if (m_db) {
         connect(entry, SIGNAL(entryModified()), m_db, SLOT(markAsModified()));
+        m_db->indexEntry(entry);
     }
 
     emit groupModified();
@@ -947,8 +1010,10 @@ void Group::removeEntry(Entry* entry)
     entry->disconnect(this);
     if (m_db) {
         entry->disconnect(m_db);
+        m_db->unindexEntry(entry);
     }
     m_entries.removeAll(entry);
+    invalidateRecursiveCache();
     emit groupModified();
     emit entryRemoved(entry);
 }
@@ -962,6 +1027,7 @@ void Group::moveEntryUp(Entry* entry)
 
     emit entryAboutToMoveUp(row);
     m_entries.move(row, row - 1);
+    invalidateRecursiveCache();
     emit entryMovedUp();
     emit groupNonDataChange();
 }
@@ -975,22 +1041,36 @@ void Group::moveEntryDown(Entry* entry)
 
     emit entryAboutToMoveDown(row);
     m_entries.move(row, row + 1);
+    invalidateRecursiveCache();
     emit entryMovedDown();
     emit groupNonDataChange();
 }
 
 void Group::connectDatabaseSignalsRecursive(Database* db)
 {
+    const bool reindex = m_db != db;
     if (m_db) {
         disconnect(m_db);
+        if (reindex) {
+            m_db->unindexGroup(this);
+        }
+    }
+    if (db && reindex) {
+        db->indexGroup(this);
     }
 
     for (Entry* entry : asConst(m_entries)) {
         if (m_db) {
             entry->disconnect(m_db);
+            if (reindex) {
+                m_db->unindexEntry(entry);
+            }
         }
         if (db) {
             connect(entry, SIGNAL(entryModified()), db, SLOT(markAsModified()));
+            if (reindex) {
+                db->indexEntry(entry);
+            }
         }
     }
 
@@ -1020,11 +1100,43 @@ void Group::cleanupParent()
     if (m_parent) {
         emit groupAboutToRemove(this);
         m_parent->m_children.removeAll(this);
+        m_parent->invalidateRecursiveCache();
         emit groupModified();
         emit groupRemoved();
     }
 }
 
+void Group::updateRecursiveCache() const
+{
+    if (m_recursiveCacheValid) {
+        return;
+    }
+
+    m_entriesRecursive = m_entries;
+    m_groupsRecursive.clear();
+    m_groupsRecursive.append(const_cast<Group*>(this));
+    for (const Group* group : asConst(m_children)) {
+        group->updateRecursiveCache();
+        m_entriesRecursive.append(group->m_entriesRecursive);
+        m_groupsRecursive.append(group->m_groupsRecursive);
+    }
+    m_recursiveCacheValid = true;
+}
+
+/**
+ * Drop the cached lists of the group and its ancestors. A cache is only
+ * valid if the caches of all subgroups are, so the walk can stop at the
+ * first ancestor without one.
+ */
+void Group::invalidateRecursiveCache()
+{
+    for (Group* group = this; group && group->m_recursiveCacheValid; group = group->m_parent) {
+        group->m_recursiveCacheValid = false;
+        group->m_entriesRecursive.clear();
+        group->m_groupsRecursive.clear();
+    }
+}
+
 void Group::recCreateDelObjects()
 {
     if (m_db) {
@@ -1163,14 +1275,16 @@ void Group::applyGroupIconTo(Group* other)
 
 void Group::applyGroupIconToChildGroups()
 {
-    for (Group* recursiveChild : groupsRecursive(false)) {
+    const QList<Group*> groups = groupsRecursive(false);
+    for (Group* recursiveChild : groups) {
         applyGroupIconTo(recursiveChild);
     }
 }
 
 void Group::applyGroupIconToChildEntries()
 {
-    for (Entry* recursiveEntry : entriesRecursive(false)) {
+    const QList<Entry*> entries = entriesRecursive(false);
+    for (Entry* recursiveEntry : entries) {
         applyGroupIconTo(recursiveEntry);
     }
 }
@@ -1184,6 +1298,7 @@ void Group::sortChildrenRecursively(bool reverse)
             return reverse ? name1.compare(name2, Qt::CaseInsensitive) > 0
                            : name1.compare(name2, Qt::CaseInsensitive) < 0;
         });
+    invalidateRecursiveCache();
 
     for (auto child : m_children) {
         child->sortChildrenRecursively(reverse);
@@ -207,6 +207,8 @@ private:
     void connectDatabaseSignalsRecursive(Database* db);
     void cleanupParent();
     void recCreateDelObjects();
+    void updateRecursiveCache() const;
+    void invalidateRecursiveCache();
 
     Entry* findEntryByPathRecursive(const QString& entryPath, const QString& basePath);
     Group* findGroupByPathRecursive(const QString& groupPath, const QString& basePath);
@@ -218,6 +220,11 @@ private:
     QList<Group*> m_children;
     QList<Entry*> m_entries;
 
+    // entries and groups of the subtree in traversal order, built on demand
+    mutable QList<Entry*> m_entriesRecursive;
+    mutable QList<Group*> m_groupsRecursive;
+    mutable bool m_recursiveCacheValid = false;
+
     QPointer<CustomData> m_customData;
 
     QPointer<Group> m_parent;
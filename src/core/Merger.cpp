@@ -231,8 +231,8 @@ void Merger::moveGroup(Group* group, Group* targetGroup)
 void Merger::eraseEntry(Entry* entry)
 {
     Database* database = entry->database();
-    // most simple method to remove an item from DeletedObjects :(
-    const QList<DeletedObject> deletions = database->deletedObjects();
+    const QUuid uuid = entry->uuid();
+    const bool wasDeleted = database->containsDeletedObject(uuid);
     Group* parentGroup = entry->group();
     const bool groupUpdateTimeInfo = parentGroup ? parentGroup->canUpdateTimeinfo() : false;
     if (parentGroup) {
@@ -242,14 +242,28 @@ void Merger::eraseEntry(Entry* entry)
     if (parentGroup) {
         parentGroup->setUpdateTimeinfo(groupUpdateTimeInfo);
     }
-    database->setDeletedObjects(deletions);
+    if (!wasDeleted) {
+        database->removeDeletedObject(uuid);
+    }
 }
 
 void Merger::eraseGroup(Group* group)
 {
     Database* database = group->database();
-    // most simple method to remove an item from DeletedObjects :(
-    const QList<DeletedObject> deletions = database->deletedObjects();
+    // remember the objects that are deleted along with the group
+    QSet<QUuid> uuids;
+    const QList<Entry*> entries = group->entriesRecursive(false);
+    for (const Entry* entry : entries) {
+        if (!database->containsDeletedObject(entry->uuid())) {
+            uuids << entry->uuid();
+        }
+    }
+    const QList<Group*> groups = group->groupsRecursive(true);
+    for (const Group* child : groups) {
+        if (!database->containsDeletedObject(child->uuid())) {
+            uuids << child->uuid();
+        }
+    }
     Group* parentGroup = group->parentGroup();
     const bool groupUpdateTimeInfo = parentGroup ? parentGroup->canUpdateTimeinfo() : false;
     if (parentGroup) {
@@ -259,7 +273,8 @@ void Merger::eraseGroup(Group* group)
     if (parentGroup) {
         parentGroup->setUpdateTimeinfo(groupUpdateTimeInfo);
     }
-    database->setDeletedObjects(deletions);
+    // removing the tombstones one by one would renumber the later ones every time
+    database->removeDeletedObjects(uuids);
 }
 
 Merger::ChangeList
@@ -301,8 +316,7 @@ Merger::resolveEntryConflict_KeepLocal(const MergeContext& context, const Entry*
         // old entry is an active change of the database!
         changes << tr("Reapplying older target entry on top of newer source %1 [%2]")
                        .arg(targetEntry->title(), targetEntry->uuidToHex());
-        Entry* agedTargetEntry = targetEntry->clone(Entry::CloneNoFlags);
-        targetEntry->addHistoryItem(agedTargetEntry);
+        targetEntry->addHistoryItem(EntrySnapshot(targetEntry));
     }
     return changes;
 }
@@ -408,32 +422,32 @@ Merger::resolveEntryConflict(const MergeContext& context, const Entry* sourceEnt
 bool Merger::mergeHistory(const Entry* sourceEntry, Entry* targetEntry, Group::MergeMode mergeMethod)
 {
     Q_UNUSED(mergeMethod);
-    const auto targetHistoryItems = targetEntry->historyItems();
-    const auto sourceHistoryItems = sourceEntry->historyItems();
+    const auto targetHistoryItems = targetEntry->historySnapshots();
+    const auto sourceHistoryItems = sourceEntry->historySnapshots();
     const int comparison = compare(sourceEntry->timeInfo().lastModificationTime(),
                                    targetEntry->timeInfo().lastModificationTime(),
                                    CompareItemIgnoreMilliseconds);
     const bool preferLocal = mergeMethod == Group::KeepLocal || comparison < 0;
     const bool preferRemote = mergeMethod == Group::KeepRemote || comparison > 0;
 
-    QMap<QDateTime, Entry*> merged;
-    for (Entry* historyItem : targetHistoryItems) {
-        const QDateTime modificationTime = Clock::serialized(historyItem->timeInfo().lastModificationTime());
+    QMap<QDateTime, EntrySnapshot> merged;
+    for (const EntrySnapshot& historyItem : targetHistoryItems) {
+        const QDateTime modificationTime = Clock::serialized(historyItem.timeInfo().lastModificationTime());
         if (merged.contains(modificationTime)
-            && !merged[modificationTime]->equals(historyItem, CompareItemIgnoreMilliseconds)) {
+            && !merged[modificationTime].equals(historyItem, CompareItemIgnoreMilliseconds)) {
             ::qWarning("Inconsistent history entry of %s[%s] at %s contains conflicting changes - conflict resolution "
                        "may lose data!",
                        qPrintable(sourceEntry->title()),
                        qPrintable(sourceEntry->uuidToHex()),
                        qPrintable(modificationTime.toString("yyyy-MM-dd HH-mm-ss-zzz")));
         }
-        merged[modificationTime] = historyItem->clone(Entry::CloneNoFlags);
+        merged[modificationTime] = historyItem;
     }
-    for (Entry* historyItem : sourceHistoryItems) {
+    for (const EntrySnapshot& historyItem : sourceHistoryItems) {
         // Items with same modification-time changes will be regarded as same (like KeePass2)
-        const QDateTime modificationTime = Clock::serialized(historyItem->timeInfo().lastModificationTime());
+        const QDateTime modificationTime = Clock::serialized(historyItem.timeInfo().lastModificationTime());
         if (merged.contains(modificationTime)
-            && !merged[modificationTime]->equals(historyItem, CompareItemIgnoreMilliseconds)) {
+            && !merged[modificationTime].equals(historyItem, CompareItemIgnoreMilliseconds)) {
             ::qWarning(
                 "History entry of %s[%s] at %s contains conflicting changes - conflict resolution may lose data!",
                 qPrintable(sourceEntry->title()),
@@ -442,10 +456,10 @@ bool Merger::mergeHistory(const Entry* sourceEntry, Entry* targetEntry, Group::M
         }
         if (preferRemote && merged.contains(modificationTime)) {
             // forcefully apply the remote history item
-            delete merged.take(modificationTime);
+            merged.remove(modificationTime);
         }
         if (!merged.contains(modificationTime)) {
-            merged[modificationTime] = historyItem->clone(Entry::CloneNoFlags);
+            merged[modificationTime] = historyItem;
         }
     }
 
@@ -462,38 +476,40 @@ bool Merger::mergeHistory(const Entry* sourceEntry, Entry* targetEntry, Group::M
     if (targetModificationTime < sourceModificationTime) {
         if (preferLocal && merged.contains(targetModificationTime)) {
             // forcefully apply the local history item
-            delete merged.take(targetModificationTime);
+            merged.remove(targetModificationTime);
         }
         if (!merged.contains(targetModificationTime)) {
-            merged[targetModificationTime] = targetEntry->clone(Entry::CloneNoFlags);
+            merged[targetModificationTime] = EntrySnapshot(targetEntry);
         }
     } else if (targetModificationTime > sourceModificationTime) {
         if (preferRemote && !merged.contains(sourceModificationTime)) {
             // forcefully apply the remote history item
-            delete merged.take(sourceModificationTime);
+            merged.remove(sourceModificationTime);
         }
         if (!merged.contains(sourceModificationTime)) {
-            merged[sourceModificationTime] = sourceEntry->clone(Entry::CloneNoFlags);
+            merged[sourceModificationTime] = EntrySnapshot(sourceEntry);
         }
     }
 
     bool changed = false;
     const int maxItems = targetEntry->database()->metadata()->historyMaxItems();
     const auto updatedHistoryItems = merged.values();
+    auto itemAt = [](const QList<EntrySnapshot>& items, int index) -> const EntrySnapshot* {
+        return index >= 0 && index < items.count() ? &items.at(index) : nullptr;
+    };
     for (int i = 0; i < maxItems; ++i) {
-        const Entry* oldEntry = targetHistoryItems.value(targetHistoryItems.count() - i);
-        const Entry* newEntry = updatedHistoryItems.value(updatedHistoryItems.count() - i);
+        const EntrySnapshot* oldEntry = itemAt(targetHistoryItems, targetHistoryItems.count() - i);
+        const EntrySnapshot* newEntry = itemAt(updatedHistoryItems, updatedHistoryItems.count() - i);
         if (!oldEntry && !newEntry) {
             continue;
         }
-        if (oldEntry && newEntry && oldEntry->equals(newEntry, CompareItemIgnoreMilliseconds)) {
+        if (oldEntry && newEntry && oldEntry->equals(*newEntry, CompareItemIgnoreMilliseconds)) {
             continue;
         }
         changed = true;
         break;
     }
     if (!changed) {
-        qDeleteAll(updatedHistoryItems);
         return false;
     }
     // We need to prevent any modification to the database since every change should be tracked either
@@ -502,11 +518,7 @@ bool Merger::mergeHistory(const Entry* sourceEntry, Entry* targetEntry, Group::M
     const bool blockedSignals = targetEntry->blockSignals(true);
     bool updateTimeInfo = targetEntry->canUpdateTimeinfo();
     targetEntry->setUpdateTimeinfo(false);
-    targetEntry->removeHistoryItems(targetHistoryItems);
-    for (Entry* historyItem : merged) {
-        Q_ASSERT(!historyItem->parent());
-        targetEntry->addHistoryItem(historyItem);
-    }
+    targetEntry->setHistorySnapshots(updatedHistoryItems);
     targetEntry->truncateHistory();
     targetEntry->blockSignals(blockedSignals);
     targetEntry->setUpdateTimeinfo(updateTimeInfo);
@@ -528,7 +540,7 @@ Merger::ChangeList Merger::mergeDeletions(const MergeContext& context)
     const auto sourceDeletions = context.m_sourceDb->deletedObjects();
 
     QList<DeletedObject> deletions;
-    QMap<QUuid, DeletedObject> mergedDeletions;
+    QHash<QUuid, DeletedObject> mergedDeletions;
     QList<Entry*> entries;
     QList<Group*> groups;
 
@@ -26,6 +26,7 @@
 #include "git-info.h"
 #include <QCoreApplication>
 #include <QElapsedTimer>
+#include <QHostAddress>
 #include <QIODevice>
 #include <QImageReader>
 #include <QLocale>
@@ -289,6 +290,35 @@ namespace Tools
         return true;
     }
 
+    /**
+     * Gets the base domain of URL.
+     *
+     * Returns the base domain, e.g. https://another.example.co.uk -> example.co.uk
+     */
+    QString baseDomain(const QString& hostname)
+    {
+        QUrl qurl = QUrl::fromUserInput(hostname);
+        QString host = qurl.host();
+
+        // If the hostname is an IP address, return it directly
+        QHostAddress hostAddress(hostname);
+        if (!hostAddress.isNull()) {
+            return hostname;
+        }
+
+        if (host.isEmpty() || !host.contains(qurl.topLevelDomain())) {
+            return {};
+        }
+
+        // Remove the top level domain part, e.g. https://another.example.co.uk -> https://another.example
+        host.chop(qurl.topLevelDomain().length());
+        // Split the URL and select the last part, e.g. https://another.example -> example
+        QString baseDomain = host.split('.').last();
+        // Append the top level domain back to the URL, e.g. example -> example.co.uk
+        baseDomain.append(qurl.topLevelDomain());
+        return baseDomain;
+    }
+
     // Escape common regex symbols except for *, ?, and |
     auto regexEscape = QRegularExpression(R"re(([-[\]{}()+.,\\\/^$#]))re");
 
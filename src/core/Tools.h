@@ -43,6 +43,7 @@ namespace Tools
     void sleep(int ms);
     void wait(int ms);
     bool checkUrlValid(const QString& urlField);
+    QString baseDomain(const QString& hostname);
     QString uuidToHex(const QUuid& uuid);
     QUuid hexToUuid(const QString& uuid);
     QRegularExpression convertToRegex(const QString& string,
@@ -27,7 +27,7 @@
 #include "format/KeePass2.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/HashedBlockStream.h"
-#include "streams/QtIOCompressor"
+#include "streams/ParallelGzipStream.h"
 #include "streams/SymmetricCipherStream.h"
 
 bool Kdbx3Writer::writeDatabase(QIODevice* device, Database* db)
@@ -111,18 +111,17 @@ bool Kdbx3Writer::writeDatabase(QIODevice* device, Database* db)
     }
 
     QIODevice* outputDevice = nullptr;
-    QScopedPointer<QtIOCompressor> ioCompressor;
+    QScopedPointer<ParallelGzipStream> gzipStream;
 
     if (db->compressionAlgorithm() == Database::CompressionNone) {
         outputDevice = &hashedStream;
     } else {
-        ioCompressor.reset(new QtIOCompressor(&hashedStream));
-        ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
-        if (!ioCompressor->open(QIODevice::WriteOnly)) {
-            raiseError(ioCompressor->errorString());
+        gzipStream.reset(new ParallelGzipStream(&hashedStream));
+        if (!gzipStream->open(QIODevice::WriteOnly)) {
+            raiseError(gzipStream->errorString());
             return false;
         }
-        outputDevice = ioCompressor.data();
+        outputDevice = gzipStream.data();
     }
 
     Q_ASSERT(outputDevice);
@@ -134,12 +133,14 @@ bool Kdbx3Writer::writeDatabase(QIODevice* device, Database* db)
     }
 
     KdbxXmlWriter xmlWriter(formatVersion());
+    xmlWriter.setEntryCache(db->xmlEntryCache());
     xmlWriter.writeDatabase(outputDevice, db, &randomStream, headerHash);
 
     // Explicitly close/reset streams so they are flushed and we can detect
     // errors. QIODevice::close() resets errorString() etc.
-    if (ioCompressor) {
-        ioCompressor->close();
+    if (gzipStream && !gzipStream->reset()) {
+        raiseError(gzipStream->errorString());
+        return false;
     }
     if (!hashedStream.reset()) {
         raiseError(hashedStream.errorString());
@@ -18,14 +18,17 @@
 #include "Kdbx4Reader.h"
 
 #include <QBuffer>
+#include <QThread>
 
 #include "core/AsyncTask.h"
 #include "core/Endian.h"
 #include "core/Group.h"
 #include "crypto/CryptoHash.h"
+#include "format/KdbxSnapshotCache.h"
 #include "format/KdbxXmlReader.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/HmacBlockStream.h"
+#include "streams/PipelinedStream.h"
 #include "streams/QtIOCompressor"
 #include "streams/SymmetricCipherStream.h"
 
@@ -77,18 +80,44 @@ bool Kdbx4Reader::readDatabaseImpl(QIODevice* device,
                       "If this reoccurs, then your database file may be corrupt.") + " " + tr("(HMAC mismatch)"));
         return false;
     }
+
+    // the credentials and the header are verified at this point, a snapshot
+    // of the same file replaces reading the payload
+    const QString snapshotFilePath = m_snapshotCache ? m_snapshotFilePath : QString();
+    if (!snapshotFilePath.isEmpty()
+        && m_snapshotCache->restore(snapshotFilePath, headerSha256, db->transformedDatabaseKey(), db)) {
+        return true;
+    }
+
     HmacBlockStream hmacStream(device, hmacKey);
+    if (m_pipelined) {
+        // verify several HMAC blocks in parallel
+        hmacStream.setReadAhead(qBound(2, QThread::idealThreadCount(), 8));
+    }
     if (!hmacStream.open(QIODevice::ReadOnly)) {
         raiseError(hmacStream.errorString());
         return false;
     }
 
+    // In pipelined mode, HMAC verification, decryption and decompression each
+    // run on their own worker thread while XML parsing stays on this thread.
+    QIODevice* hmacDevice = &hmacStream;
+    QScopedPointer<PipelinedStream> hmacPipe;
+    if (m_pipelined) {
+        hmacPipe.reset(new PipelinedStream(&hmacStream));
+        if (!hmacPipe->open(QIODevice::ReadOnly)) {
+            raiseError(hmacPipe->errorString());
+            return false;
+        }
+        hmacDevice = hmacPipe.data();
+    }
+
     SymmetricCipher::Algorithm cipher = SymmetricCipher::cipherToAlgorithm(db->cipher());
     if (cipher == SymmetricCipher::InvalidAlgorithm) {
         raiseError(tr("Unknown cipher"));
         return false;
     }
-    SymmetricCipherStream cipherStream(&hmacStream, cipher, SymmetricCipher::algorithmMode(cipher), SymmetricCipher::Decrypt);
+    SymmetricCipherStream cipherStream(hmacDevice, cipher, SymmetricCipher::algorithmMode(cipher), SymmetricCipher::Decrypt);
     if (!cipherStream.init(finalKey, m_encryptionIV)) {
         raiseError(cipherStream.errorString());
         return false;
@@ -99,19 +128,40 @@ bool Kdbx4Reader::readDatabaseImpl(QIODevice* device,
     }
     // clang-format on
 
+    QIODevice* cipherDevice = &cipherStream;
+    QScopedPointer<PipelinedStream> cipherPipe;
+    if (m_pipelined) {
+        cipherPipe.reset(new PipelinedStream(&cipherStream));
+        if (!cipherPipe->open(QIODevice::ReadOnly)) {
+            raiseError(cipherPipe->errorString());
+            return false;
+        }
+        cipherDevice = cipherPipe.data();
+    }
+
     QIODevice* xmlDevice = nullptr;
     QScopedPointer<QtIOCompressor> ioCompressor;
+    QScopedPointer<PipelinedStream> compressorPipe;
 
     if (db->compressionAlgorithm() == Database::CompressionNone) {
-        xmlDevice = &cipherStream;
+        xmlDevice = cipherDevice;
     } else {
-        ioCompressor.reset(new QtIOCompressor(&cipherStream));
+        ioCompressor.reset(new QtIOCompressor(cipherDevice));
         ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
         if (!ioCompressor->open(QIODevice::ReadOnly)) {
             raiseError(ioCompressor->errorString());
             return false;
         }
         xmlDevice = ioCompressor.data();
+
+        if (m_pipelined) {
+            compressorPipe.reset(new PipelinedStream(ioCompressor.data()));
+            if (!compressorPipe->open(QIODevice::ReadOnly)) {
+                raiseError(compressorPipe->errorString());
+                return false;
+            }
+            xmlDevice = compressorPipe.data();
+        }
     }
 
     while (readInnerHeaderField(xmlDevice) && !hasError()) {
@@ -129,7 +179,8 @@ bool Kdbx4Reader::readDatabaseImpl(QIODevice* device,
 
     Q_ASSERT(xmlDevice);
 
-    KdbxXmlReader xmlReader(KeePass2::FILE_VERSION_4, binaryPool());
+    // hand the pool over so attachments are its only remaining owners after parsing
+    KdbxXmlReader xmlReader(KeePass2::FILE_VERSION_4, std::move(m_binaryPool));
     xmlReader.readDatabase(xmlDevice, db, &randomStream);
 
     if (xmlReader.hasError()) {
@@ -137,6 +188,10 @@ bool Kdbx4Reader::readDatabaseImpl(QIODevice* device,
         return false;
     }
 
+    if (!snapshotFilePath.isEmpty()) {
+        m_snapshotCache->store(snapshotFilePath, headerSha256, db->transformedDatabaseKey(), db);
+    }
+
     return true;
 }
 
@@ -248,6 +303,10 @@ bool Kdbx4Reader::readInnerHeaderField(QIODevice* device)
         return false;
     }
 
+    if (fieldID == KeePass2::InnerHeaderFieldID::Binary) {
+        return readInnerHeaderBinary(device, fieldLen);
+    }
+
     QByteArray fieldData;
     if (fieldLen != 0) {
         fieldData = device->read(fieldLen);
@@ -269,16 +328,43 @@ bool Kdbx4Reader::readInnerHeaderField(QIODevice* device)
         setProtectedStreamKey(fieldData);
         break;
 
-    case KeePass2::InnerHeaderFieldID::Binary: {
-        if (fieldLen < 1) {
-            raiseError(tr("Invalid inner header binary size"));
-            return false;
-        }
-        auto data = fieldData.mid(1);
-        m_binaryPool.insert(QString::number(m_binaryPool.size()), data);
+    case KeePass2::InnerHeaderFieldID::Binary:
         break;
     }
+
+    return true;
+}
+
+/**
+ * Helper method for reading a KDBX4 inner header binary. The leading flags
+ * byte is skipped separately so the payload is read without an extra copy.
+ *
+ * @param device input device
+ * @param fieldLen length of the field including the flags byte
+ * @return true if there are more inner header fields
+ */
+bool Kdbx4Reader::readInnerHeaderBinary(QIODevice* device, quint32 fieldLen)
+{
+    if (fieldLen < 1) {
+        raiseError(tr("Invalid inner header binary size"));
+        return false;
+    }
+
+    // flags byte, currently only used for the memory protection hint
+    if (device->read(1).size() != 1) {
+        raiseError(tr("Invalid header data length"));
+        return false;
+    }
+
+    QByteArray data;
+    if (fieldLen > 1) {
+        data = device->read(fieldLen - 1);
+        if (static_cast<quint32>(data.size()) != fieldLen - 1) {
+            raiseError(tr("Invalid header data length"));
+            return false;
+        }
     }
+    m_binaryPool.insert(m_binaryPool.size(), data);
 
     return true;
 }
@@ -414,11 +500,3 @@ QVariantMap Kdbx4Reader::readVariantMap(QIODevice* device)
 
     return vm;
 }
-
-/**
- * @return mapping from attachment keys to binary data
- */
-QHash<QString, QByteArray> Kdbx4Reader::binaryPool() const
-{
-    return m_binaryPool;
-}
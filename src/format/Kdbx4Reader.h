@@ -34,16 +34,16 @@ public:
                           const QByteArray& headerData,
                           QSharedPointer<const CompositeKey> key,
                           Database* db) override;
-    QHash<QString, QByteArray> binaryPool() const;
 
 protected:
     bool readHeaderField(StoreDataStream& headerStream, Database* db) override;
 
 private:
     bool readInnerHeaderField(QIODevice* device);
+    bool readInnerHeaderBinary(QIODevice* device, quint32 fieldLen);
     QVariantMap readVariantMap(QIODevice* device);
 
-    QHash<QString, QByteArray> m_binaryPool;
+    QHash<int, QByteArray> m_binaryPool;
 };
 
 #endif // KEEPASSX_KDBX4READER_H
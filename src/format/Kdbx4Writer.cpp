@@ -28,7 +28,7 @@
 #include "format/KdbxXmlWriter.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/HmacBlockStream.h"
-#include "streams/QtIOCompressor"
+#include "streams/ParallelGzipStream.h"
 #include "streams/SymmetricCipherStream.h"
 
 bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
@@ -137,18 +137,17 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
     }
 
     QIODevice* outputDevice = nullptr;
-    QScopedPointer<QtIOCompressor> ioCompressor;
+    QScopedPointer<ParallelGzipStream> gzipStream;
 
     if (db->compressionAlgorithm() == Database::CompressionNone) {
         outputDevice = cipherStream.data();
     } else {
-        ioCompressor.reset(new QtIOCompressor(cipherStream.data()));
-        ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
-        if (!ioCompressor->open(QIODevice::WriteOnly)) {
-            raiseError(ioCompressor->errorString());
+        gzipStream.reset(new ParallelGzipStream(cipherStream.data()));
+        if (!gzipStream->open(QIODevice::WriteOnly)) {
+            raiseError(gzipStream->errorString());
             return false;
         }
-        outputDevice = ioCompressor.data();
+        outputDevice = gzipStream.data();
     }
 
     Q_ASSERT(outputDevice);
@@ -161,7 +160,7 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
         writeInnerHeaderField(outputDevice, KeePass2::InnerHeaderFieldID::InnerRandomStreamKey, protectedStreamKey));
 
     // Write attachments to the inner header
-    writeAttachments(outputDevice, db);
+    CHECK_RETURN_FALSE(writeAttachments(outputDevice, db));
 
     CHECK_RETURN_FALSE(writeInnerHeaderField(outputDevice, KeePass2::InnerHeaderFieldID::End, QByteArray()));
 
@@ -172,12 +171,14 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
     }
 
     KdbxXmlWriter xmlWriter(formatVersion());
+    xmlWriter.setEntryCache(db->xmlEntryCache());
     xmlWriter.writeDatabase(outputDevice, db, &randomStream, headerHash);
 
     // Explicitly close/reset streams so they are flushed and we can detect
     // errors. QIODevice::close() resets errorString() etc.
-    if (ioCompressor) {
-        ioCompressor->close();
+    if (gzipStream && !gzipStream->reset()) {
+        raiseError(gzipStream->errorString());
+        return false;
     }
     if (!cipherStream->reset()) {
         raiseError(cipherStream->errorString());
@@ -216,25 +217,41 @@ bool Kdbx4Writer::writeInnerHeaderField(QIODevice* device, KeePass2::InnerHeader
     return true;
 }
 
-void Kdbx4Writer::writeAttachments(QIODevice* device, Database* db)
+bool Kdbx4Writer::writeAttachments(QIODevice* device, Database* db)
 {
-    const QList<Entry*> allEntries = db->rootGroup()->entriesRecursive(true);
+    const QList<Entry*> allEntries = db->rootGroup()->entriesRecursive();
     QSet<QByteArray> writtenAttachments;
 
-    for (Entry* entry : allEntries) {
-        const QList<QString> attachmentKeys = entry->attachments()->keys();
-        for (const QString& key : attachmentKeys) {
-            QByteArray data("\x01");
-            data.append(entry->attachments()->value(key));
-
-            if (writtenAttachments.contains(data)) {
+    auto writeBinaries = [&](const QMap<QString, AttachmentStore::Blob>& attachments) {
+        for (const AttachmentStore::Blob& blob : attachments) {
+            const QByteArray digest = blob.digest();
+            if (writtenAttachments.contains(digest)) {
                 continue;
             }
 
+            QByteArray blobData;
+            if (!blob.data(blobData)) {
+                raiseError(tr("Failed to read attachment data."));
+                return false;
+            }
+
+            QByteArray data("\x01");
+            data.append(blobData);
+
             writeInnerHeaderField(device, KeePass2::InnerHeaderFieldID::Binary, data);
-            writtenAttachments.insert(data);
+            writtenAttachments.insert(digest);
+        }
+        return true;
+    };
+
+    for (Entry* entry : allEntries) {
+        CHECK_RETURN_FALSE(writeBinaries(EntrySnapshot(entry).attachments()));
+        for (const EntrySnapshot& historyItem : entry->historySnapshots()) {
+            CHECK_RETURN_FALSE(writeBinaries(historyItem.attachments()));
         }
     }
+
+    return true;
 }
 
 /**
@@ -113,6 +113,36 @@ KeePass2::ProtectedStreamAlgo KdbxReader::protectedStreamAlgo() const
     return m_irsAlgo;
 }
 
+/**
+ * Enable pipelined payload decoding. Readers that support it run
+ * each layer of the payload stream stack on its own worker thread.
+ *
+ * @param pipelined true to decode the payload in parallel stages
+ */
+void KdbxReader::setPipelined(bool pipelined)
+{
+    m_pipelined = pipelined;
+}
+
+bool KdbxReader::isPipelined() const
+{
+    return m_pipelined;
+}
+
+/**
+ * Restore the database from a snapshot instead of parsing the payload if
+ * the cache has one for the file, and store a snapshot after parsing it.
+ * Readers that do not support snapshots ignore the cache.
+ *
+ * @param cache snapshot cache or nullptr to disable snapshots
+ * @param filePath path of the database file the snapshot belongs to
+ */
+void KdbxReader::setSnapshotCache(KdbxSnapshotCache* cache, const QString& filePath)
+{
+    m_snapshotCache = cache;
+    m_snapshotFilePath = filePath;
+}
+
 /**
  * @param data stream cipher UUID as bytes
  */
@@ -26,6 +26,7 @@
 #include <QPointer>
 
 class Database;
+class KdbxSnapshotCache;
 class QIODevice;
 
 /**
@@ -47,6 +48,10 @@ public:
 
     KeePass2::ProtectedStreamAlgo protectedStreamAlgo() const;
 
+    void setPipelined(bool pipelined);
+    bool isPipelined() const;
+    void setSnapshotCache(KdbxSnapshotCache* cache, const QString& filePath);
+
 protected:
     /**
      * Concrete reader implementation for reading database from device.
@@ -90,6 +95,9 @@ protected:
     QByteArray m_streamStartBytes;
     QByteArray m_protectedStreamKey;
     KeePass2::ProtectedStreamAlgo m_irsAlgo = KeePass2::ProtectedStreamAlgo::InvalidProtectedStreamAlgo;
+    bool m_pipelined = false;
+    KdbxSnapshotCache* m_snapshotCache = nullptr;
+    QString m_snapshotFilePath;
 
 private:
     QPair<quint32, quint32> m_kdbxSignature;
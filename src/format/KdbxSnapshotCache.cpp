@@ -0,0 +1,648 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KdbxSnapshotCache.h"
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QImage>
+#include <QScopedPointer>
+
+#include "core/Database.h"
+#include "core/Group.h"
+#include "core/Metadata.h"
+#include "crypto/CryptoHash.h"
+#include "crypto/Random.h"
+#include "crypto/SymmetricCipher.h"
+
+namespace
+{
+    const quint32 SnapshotMagic = 0x4B585353;
+    const quint32 SnapshotVersion = 1;
+
+    void writeTimes(QDataStream& stream, const TimeInfo& timeInfo)
+    {
+        stream << timeInfo.lastModificationTime() << timeInfo.creationTime() << timeInfo.lastAccessTime()
+               << timeInfo.expiryTime() << timeInfo.expires() << qint32(timeInfo.usageCount())
+               << timeInfo.locationChanged();
+    }
+
+    TimeInfo readTimes(QDataStream& stream)
+    {
+        QDateTime lastModificationTime, creationTime, lastAccessTime, expiryTime, locationChanged;
+        bool expires;
+        qint32 usageCount;
+        stream >> lastModificationTime >> creationTime >> lastAccessTime >> expiryTime >> expires >> usageCount
+            >> locationChanged;
+
+        TimeInfo timeInfo;
+        timeInfo.setLastModificationTime(lastModificationTime);
+        timeInfo.setCreationTime(creationTime);
+        timeInfo.setLastAccessTime(lastAccessTime);
+        timeInfo.setExpiryTime(expiryTime);
+        timeInfo.setExpires(expires);
+        timeInfo.setUsageCount(usageCount);
+        timeInfo.setLocationChanged(locationChanged);
+        return timeInfo;
+    }
+
+    void writeCustomData(QDataStream& stream, const CustomData* customData)
+    {
+        const QList<QString> keys = customData->keys();
+        stream << qint32(keys.size());
+        for (const QString& key : keys) {
+            stream << key << customData->value(key);
+        }
+    }
+
+    void readCustomData(QDataStream& stream, CustomData* customData)
+    {
+        qint32 count;
+        stream >> count;
+        for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QString key, value;
+            stream >> key >> value;
+            customData->set(key, value);
+        }
+    }
+
+    QUuid uuidOf(const Group* group)
+    {
+        return group ? group->uuid() : QUuid();
+    }
+
+    /**
+     * Serializes the object graph of a database in the same order the
+     * KDBX XML writer does.
+     */
+    class SnapshotWriter
+    {
+    public:
+        explicit SnapshotWriter(QDataStream& stream)
+            : m_stream(stream)
+        {
+        }
+
+        void writeDatabase(const Database* db)
+        {
+            m_stream << SnapshotMagic << SnapshotVersion;
+
+            writeMetadata(db->metadata());
+            writeBinaries(db->rootGroup());
+            writeGroup(db->rootGroup());
+
+            const QList<DeletedObject>& deletedObjects = db->deletedObjects();
+            m_stream << qint32(deletedObjects.size());
+            for (const DeletedObject& delObj : deletedObjects) {
+                m_stream << delObj.uuid << delObj.deletionTime;
+            }
+        }
+
+    private:
+        void writeMetadata(const Metadata* meta)
+        {
+            m_stream << meta->generator() << meta->name() << meta->nameChanged() << meta->description()
+                     << meta->descriptionChanged() << meta->defaultUserName() << meta->defaultUserNameChanged()
+                     << qint32(meta->maintenanceHistoryDays()) << meta->color() << meta->databaseKeyChanged()
+                     << qint32(meta->databaseKeyChangeRec()) << qint32(meta->databaseKeyChangeForce());
+
+            m_stream << meta->protectTitle() << meta->protectUsername() << meta->protectPassword()
+                     << meta->protectUrl() << meta->protectNotes();
+
+            const QList<QUuid> customIcons = meta->customIconsOrder();
+            m_stream << qint32(customIcons.size());
+            for (const QUuid& uuid : customIcons) {
+                m_stream << uuid << meta->customIcon(uuid);
+            }
+
+            m_stream << meta->recycleBinEnabled() << uuidOf(meta->recycleBin()) << meta->recycleBinChanged()
+                     << uuidOf(meta->entryTemplatesGroup()) << meta->entryTemplatesGroupChanged()
+                     << uuidOf(meta->lastSelectedGroup()) << uuidOf(meta->lastTopVisibleGroup())
+                     << qint32(meta->historyMaxItems()) << qint32(meta->historyMaxSize());
+
+            writeCustomData(m_stream, meta->customData());
+            m_stream << meta->settingsChanged();
+        }
+
+        void writeBinaries(const Group* rootGroup)
+        {
+            QList<AttachmentStore::Blob> binaries;
+
+            auto addBinaries = [&](const QMap<QString, AttachmentStore::Blob>& attachments) {
+                for (const AttachmentStore::Blob& blob : attachments) {
+                    if (!m_binaryIds.contains(blob.digest())) {
+                        m_binaryIds.insert(blob.digest(), binaries.size());
+                        binaries.append(blob);
+                    }
+                }
+            };
+
+            const QList<Entry*> allEntries = rootGroup->entriesRecursive();
+            for (const Entry* entry : allEntries) {
+                addBinaries(EntrySnapshot(entry).attachments());
+                for (const EntrySnapshot& historyItem : entry->historySnapshots()) {
+                    addBinaries(historyItem.attachments());
+                }
+            }
+
+            m_stream << qint32(binaries.size());
+            for (const AttachmentStore::Blob& blob : asConst(binaries)) {
+                QByteArray data;
+                if (!blob.data(data)) {
+                    m_stream.setStatus(QDataStream::WriteFailed);
+                    return;
+                }
+                m_stream << data;
+            }
+        }
+
+        void writeGroup(const Group* group)
+        {
+            m_stream << group->uuid() << group->name() << group->notes() << qint32(group->iconNumber())
+                     << group->iconUuid();
+            writeTimes(m_stream, group->timeInfo());
+            m_stream << group->isExpanded() << group->defaultAutoTypeSequence() << qint8(group->autoTypeEnabled())
+                     << qint8(group->searchingEnabled());
+
+            const Entry* lastTopVisibleEntry = group->lastTopVisibleEntry();
+            m_stream << (lastTopVisibleEntry ? lastTopVisibleEntry->uuid() : QUuid());
+            writeCustomData(m_stream, group->customData());
+
+            const QList<Entry*>& entries = group->entries();
+            m_stream << qint32(entries.size());
+            for (const Entry* entry : entries) {
+                writeEntry(entry, true);
+            }
+
+            const QList<Group*>& children = group->children();
+            m_stream << qint32(children.size());
+            for (const Group* child : children) {
+                writeGroup(child);
+            }
+        }
+
+        void writeEntry(const Entry* entry, bool withHistory)
+        {
+            m_stream << entry->uuid() << qint32(entry->iconNumber()) << entry->iconUuid() << entry->foregroundColor()
+                     << entry->backgroundColor() << entry->overrideUrl() << entry->tags();
+            writeTimes(m_stream, entry->timeInfo());
+
+            const EntryAttributes* attributes = entry->attributes();
+            const QList<QString> attributeKeys = attributes->keys();
+            m_stream << qint32(attributeKeys.size());
+            for (const QString& key : attributeKeys) {
+                m_stream << key << attributes->value(key) << attributes->isProtected(key);
+            }
+
+            const EntryAttachments* attachments = entry->attachments();
+            const QList<QString> attachmentKeys = attachments->keys();
+            m_stream << qint32(attachmentKeys.size());
+            for (const QString& key : attachmentKeys) {
+                m_stream << key << qint32(m_binaryIds.value(attachments->digest(key)));
+            }
+
+            m_stream << entry->autoTypeEnabled() << qint32(entry->autoTypeObfuscation())
+                     << entry->defaultAutoTypeSequence();
+            const QList<AutoTypeAssociations::Association> associations = entry->autoTypeAssociations()->getAll();
+            m_stream << qint32(associations.size());
+            for (const AutoTypeAssociations::Association& assoc : associations) {
+                m_stream << assoc.window << assoc.sequence;
+            }
+
+            writeCustomData(m_stream, entry->customData());
+
+            if (withHistory) {
+                const QList<EntrySnapshot>& historyItems = entry->historySnapshots();
+                m_stream << qint32(historyItems.size());
+                for (const EntrySnapshot& historyItem : historyItems) {
+                    QScopedPointer<Entry> historyEntry(historyItem.toEntry());
+                    writeEntry(historyEntry.data(), false);
+                }
+            }
+        }
+
+        QDataStream& m_stream;
+        QHash<QByteArray, int> m_binaryIds;
+    };
+
+    /**
+     * Rebuilds a database from a snapshot written by SnapshotWriter.
+     */
+    class SnapshotReader
+    {
+    public:
+        explicit SnapshotReader(QDataStream& stream)
+            : m_stream(stream)
+        {
+        }
+
+        bool readDatabase(Database* db)
+        {
+            quint32 magic;
+            quint32 version;
+            m_stream >> magic >> version;
+            if (m_stream.status() != QDataStream::Ok || magic != SnapshotMagic || version != SnapshotVersion) {
+                return false;
+            }
+
+            Metadata* meta = db->metadata();
+            meta->setUpdateDatetime(false);
+            readMetadata(meta);
+            readBinaries();
+
+            QScopedPointer<Group> rootGroup(readGroup());
+
+            QList<DeletedObject> deletedObjects;
+            qint32 count;
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                DeletedObject delObj{{}, {}};
+                m_stream >> delObj.uuid >> delObj.deletionTime;
+                deletedObjects.append(delObj);
+            }
+
+            if (m_stream.status() != QDataStream::Ok) {
+                meta->setUpdateDatetime(true);
+                return false;
+            }
+
+            for (auto it = m_lastTopVisibleEntries.constBegin(); it != m_lastTopVisibleEntries.constEnd(); ++it) {
+                it.key()->setLastTopVisibleEntry(m_entries.value(it.value()));
+            }
+            meta->setRecycleBin(m_groups.value(m_recycleBin));
+            meta->setEntryTemplatesGroup(m_groups.value(m_entryTemplatesGroup));
+            meta->setLastSelectedGroup(m_groups.value(m_lastSelectedGroup));
+            meta->setLastTopVisibleGroup(m_groups.value(m_lastTopVisibleGroup));
+
+            Group* oldRoot = db->rootGroup();
+            db->setRootGroup(rootGroup.take());
+            delete oldRoot;
+            db->setDeletedObjects(deletedObjects);
+
+            meta->setUpdateDatetime(true);
+            for (Group* group : asConst(m_groups)) {
+                group->setUpdateTimeinfo(true);
+            }
+            for (Entry* entry : asConst(m_entries)) {
+                entry->setUpdateTimeinfo(true);
+            }
+
+            return true;
+        }
+
+    private:
+        void readMetadata(Metadata* meta)
+        {
+            QString generator, name, description, defaultUserName, color;
+            QDateTime nameChanged, descriptionChanged, defaultUserNameChanged, databaseKeyChanged;
+            qint32 maintenanceHistoryDays, databaseKeyChangeRec, databaseKeyChangeForce;
+            m_stream >> generator >> name >> nameChanged >> description >> descriptionChanged >> defaultUserName
+                >> defaultUserNameChanged >> maintenanceHistoryDays >> color >> databaseKeyChanged
+                >> databaseKeyChangeRec >> databaseKeyChangeForce;
+
+            meta->setGenerator(generator);
+            meta->setName(name);
+            meta->setNameChanged(nameChanged);
+            meta->setDescription(description);
+            meta->setDescriptionChanged(descriptionChanged);
+            meta->setDefaultUserName(defaultUserName);
+            meta->setDefaultUserNameChanged(defaultUserNameChanged);
+            meta->setMaintenanceHistoryDays(maintenanceHistoryDays);
+            meta->setColor(color);
+            meta->setDatabaseKeyChanged(databaseKeyChanged);
+            meta->setMasterKeyChangeRec(databaseKeyChangeRec);
+            meta->setMasterKeyChangeForce(databaseKeyChangeForce);
+
+            bool protectTitle, protectUsername, protectPassword, protectUrl, protectNotes;
+            m_stream >> protectTitle >> protectUsername >> protectPassword >> protectUrl >> protectNotes;
+            meta->setProtectTitle(protectTitle);
+            meta->setProtectUsername(protectUsername);
+            meta->setProtectPassword(protectPassword);
+            meta->setProtectUrl(protectUrl);
+            meta->setProtectNotes(protectNotes);
+
+            qint32 count;
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                QUuid uuid;
+                QImage icon;
+                m_stream >> uuid >> icon;
+                meta->addCustomIcon(uuid, icon);
+            }
+
+            bool recycleBinEnabled;
+            QDateTime recycleBinChanged, entryTemplatesGroupChanged;
+            qint32 historyMaxItems, historyMaxSize;
+            m_stream >> recycleBinEnabled >> m_recycleBin >> recycleBinChanged >> m_entryTemplatesGroup
+                >> entryTemplatesGroupChanged >> m_lastSelectedGroup >> m_lastTopVisibleGroup >> historyMaxItems
+                >> historyMaxSize;
+            meta->setRecycleBinEnabled(recycleBinEnabled);
+            meta->setRecycleBinChanged(recycleBinChanged);
+            meta->setEntryTemplatesGroupChanged(entryTemplatesGroupChanged);
+            meta->setHistoryMaxItems(historyMaxItems);
+            meta->setHistoryMaxSize(historyMaxSize);
+
+            readCustomData(m_stream, meta->customData());
+
+            QDateTime settingsChanged;
+            m_stream >> settingsChanged;
+            meta->setSettingsChanged(settingsChanged);
+        }
+
+        void readBinaries()
+        {
+            qint32 count;
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                QByteArray data;
+                m_stream >> data;
+                m_binaries.append(AttachmentStore::instance()->store(data));
+            }
+        }
+
+        Group* readGroup()
+        {
+            auto group = new Group();
+            group->setUpdateTimeinfo(false);
+
+            QUuid uuid, iconUuid, lastTopVisibleEntry;
+            QString name, notes, defaultAutoTypeSequence;
+            qint32 iconNumber;
+            bool expanded;
+            qint8 autoTypeEnabled, searchingEnabled;
+            m_stream >> uuid >> name >> notes >> iconNumber >> iconUuid;
+            const TimeInfo timeInfo = readTimes(m_stream);
+            m_stream >> expanded >> defaultAutoTypeSequence >> autoTypeEnabled >> searchingEnabled
+                >> lastTopVisibleEntry;
+
+            group->setUuid(uuid);
+            group->setName(name);
+            group->setNotes(notes);
+            group->setIcon(iconNumber);
+            if (!iconUuid.isNull()) {
+                group->setIcon(iconUuid);
+            }
+            group->setTimeInfo(timeInfo);
+            group->setExpanded(expanded);
+            group->setDefaultAutoTypeSequence(defaultAutoTypeSequence);
+            group->setAutoTypeEnabled(static_cast<Group::TriState>(autoTypeEnabled));
+            group->setSearchingEnabled(static_cast<Group::TriState>(searchingEnabled));
+            if (!lastTopVisibleEntry.isNull()) {
+                m_lastTopVisibleEntries.insert(group, lastTopVisibleEntry);
+            }
+            readCustomData(m_stream, group->customData());
+            m_groups.insert(uuid, group);
+
+            qint32 count;
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                Entry* entry = readEntry(true);
+                entry->setGroup(group);
+                m_entries.insert(entry->uuid(), entry);
+            }
+
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                readGroup()->setParent(group);
+            }
+
+            return group;
+        }
+
+        Entry* readEntry(bool withHistory)
+        {
+            auto entry = new Entry();
+            entry->setUpdateTimeinfo(false);
+
+            QUuid uuid, iconUuid;
+            qint32 iconNumber;
+            QString foregroundColor, backgroundColor, overrideUrl, tags;
+            m_stream >> uuid >> iconNumber >> iconUuid >> foregroundColor >> backgroundColor >> overrideUrl >> tags;
+            entry->setUuid(uuid);
+            entry->setIcon(iconNumber);
+            if (!iconUuid.isNull()) {
+                entry->setIcon(iconUuid);
+            }
+            entry->setForegroundColor(foregroundColor);
+            entry->setBackgroundColor(backgroundColor);
+            entry->setOverrideUrl(overrideUrl);
+            entry->setTags(tags);
+            entry->setTimeInfo(readTimes(m_stream));
+
+            qint32 count;
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                QString key, value;
+                bool protect;
+                m_stream >> key >> value >> protect;
+                entry->attributes()->set(key, value, protect);
+            }
+
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                QString key;
+                qint32 binaryId;
+                m_stream >> key >> binaryId;
+                if (binaryId < 0 || binaryId >= m_binaries.size()) {
+                    m_stream.setStatus(QDataStream::ReadCorruptData);
+                    break;
+                }
+                entry->attachments()->set(key, m_binaries.at(binaryId));
+            }
+
+            bool autoTypeEnabled;
+            qint32 autoTypeObfuscation;
+            QString defaultAutoTypeSequence;
+            m_stream >> autoTypeEnabled >> autoTypeObfuscation >> defaultAutoTypeSequence;
+            entry->setAutoTypeEnabled(autoTypeEnabled);
+            entry->setAutoTypeObfuscation(autoTypeObfuscation);
+            entry->setDefaultAutoTypeSequence(defaultAutoTypeSequence);
+
+            m_stream >> count;
+            for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                AutoTypeAssociations::Association assoc;
+                m_stream >> assoc.window >> assoc.sequence;
+                entry->autoTypeAssociations()->add(assoc);
+            }
+
+            readCustomData(m_stream, entry->customData());
+
+            if (withHistory) {
+                m_stream >> count;
+                for (qint32 i = 0; i < count && m_stream.status() == QDataStream::Ok; ++i) {
+                    QScopedPointer<Entry> historyItem(readEntry(false));
+                    entry->addHistoryItem(EntrySnapshot(historyItem.data()));
+                }
+            }
+
+            return entry;
+        }
+
+        QDataStream& m_stream;
+        QList<AttachmentStore::Blob> m_binaries;
+        QHash<QUuid, Group*> m_groups;
+        QHash<QUuid, Entry*> m_entries;
+        QHash<Group*, QUuid> m_lastTopVisibleEntries;
+        QUuid m_recycleBin;
+        QUuid m_entryTemplatesGroup;
+        QUuid m_lastSelectedGroup;
+        QUuid m_lastTopVisibleGroup;
+    };
+} // namespace
+
+KdbxSnapshotCache* KdbxSnapshotCache::instance()
+{
+    static KdbxSnapshotCache cache;
+    return &cache;
+}
+
+/**
+ * Restore a database from its snapshot.
+ *
+ * @param filePath path of the database file
+ * @param headerHash SHA-256 hash of the authenticated KDBX header
+ * @param transformedKey transformed database key
+ * @param db database to read into
+ * @return true if a matching snapshot was found and restored
+ */
+bool KdbxSnapshotCache::restore(const QString& filePath,
+                                const QByteArray& headerHash,
+                                const QByteArray& transformedKey,
+                                Database* db) const
+{
+    QFileInfo fileInfo(filePath);
+
+    Snapshot snapshot;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_snapshots.constFind(fileInfo.canonicalFilePath());
+        if (it == m_snapshots.constEnd()) {
+            return false;
+        }
+        snapshot = it.value();
+    }
+
+    if (snapshot.headerHash != headerHash || snapshot.lastModified != fileInfo.lastModified()
+        || snapshot.size != fileInfo.size()) {
+        return false;
+    }
+
+    CryptoHash hmac(CryptoHash::Sha256, true);
+    hmac.setKey(deriveKey(transformedKey, headerHash, 'M'));
+    hmac.addData(snapshot.iv);
+    hmac.addData(snapshot.data);
+    if (hmac.result() != snapshot.mac) {
+        return false;
+    }
+
+    QByteArray data = snapshot.data;
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Decrypt);
+    if (!cipher.init(deriveKey(transformedKey, headerHash, 'E'), snapshot.iv) || !cipher.processInPlace(data)) {
+        return false;
+    }
+
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+    if (!SnapshotReader(stream).readDatabase(db)) {
+        qWarning("KdbxSnapshotCache::restore: Invalid snapshot of %s", qPrintable(filePath));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Store a snapshot of a database that has just been read from a file.
+ * Replaces an older snapshot of the same file.
+ *
+ * @param filePath path of the database file
+ * @param headerHash SHA-256 hash of the KDBX header of the file
+ * @param transformedKey transformed database key
+ * @param db database read from the file
+ */
+void KdbxSnapshotCache::store(const QString& filePath,
+                              const QByteArray& headerHash,
+                              const QByteArray& transformedKey,
+                              const Database* db)
+{
+    QFileInfo fileInfo(filePath);
+    const QString canonicalFilePath = fileInfo.canonicalFilePath();
+    if (canonicalFilePath.isEmpty()) {
+        return;
+    }
+
+    Snapshot snapshot;
+    snapshot.headerHash = headerHash;
+    snapshot.lastModified = fileInfo.lastModified();
+    snapshot.size = fileInfo.size();
+    snapshot.iv = randomGen()->randomArray(SymmetricCipher::algorithmIvSize(SymmetricCipher::ChaCha20));
+
+    {
+        QDataStream stream(&snapshot.data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+        SnapshotWriter(stream).writeDatabase(db);
+        if (stream.status() != QDataStream::Ok) {
+            qWarning("KdbxSnapshotCache::store: Failed to serialize snapshot of %s", qPrintable(filePath));
+            return;
+        }
+    }
+
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+    if (!cipher.init(deriveKey(transformedKey, headerHash, 'E'), snapshot.iv)
+        || !cipher.processInPlace(snapshot.data)) {
+        qWarning("KdbxSnapshotCache::store: Failed to encrypt snapshot: %s", qPrintable(cipher.errorString()));
+        return;
+    }
+
+    CryptoHash hmac(CryptoHash::Sha256, true);
+    hmac.setKey(deriveKey(transformedKey, headerHash, 'M'));
+    hmac.addData(snapshot.iv);
+    hmac.addData(snapshot.data);
+    snapshot.mac = hmac.result();
+
+    QMutexLocker locker(&m_mutex);
+    m_snapshots.insert(canonicalFilePath, snapshot);
+}
+
+void KdbxSnapshotCache::remove(const QString& filePath)
+{
+    const QString canonicalFilePath = QFileInfo(filePath).canonicalFilePath();
+
+    QMutexLocker locker(&m_mutex);
+    m_snapshots.remove(canonicalFilePath);
+}
+
+void KdbxSnapshotCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_snapshots.clear();
+}
+
+int KdbxSnapshotCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_snapshots.size();
+}
+
+/**
+ * Derive a key for encrypting ('E') or authenticating ('M') the snapshot of
+ * the file with the given header.
+ */
+QByteArray KdbxSnapshotCache::deriveKey(const QByteArray& transformedKey, const QByteArray& headerHash, char purpose)
+{
+    return CryptoHash::hmac(headerHash + purpose, transformedKey, CryptoHash::Sha256);
+}
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_KDBXSNAPSHOTCACHE_H
+#define KEEPASSX_KDBXSNAPSHOTCACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+
+class Database;
+
+/**
+ * In-memory cache of unlocked databases, so a database can be unlocked again
+ * without decrypting, decompressing and parsing its payload.
+ *
+ * After a database file has been read, its object graph is serialized into a
+ * compact binary snapshot that is encrypted and authenticated with keys
+ * derived from the transformed database key. The snapshot is only restored
+ * if the header of the file, which changes on every save, and the
+ * modification time and size of the file are still the same. The key
+ * derivation still runs on every unlock to verify the credentials.
+ */
+class KdbxSnapshotCache
+{
+public:
+    static KdbxSnapshotCache* instance();
+
+    bool restore(const QString& filePath,
+                 const QByteArray& headerHash,
+                 const QByteArray& transformedKey,
+                 Database* db) const;
+    void store(const QString& filePath,
+               const QByteArray& headerHash,
+               const QByteArray& transformedKey,
+               const Database* db);
+    void remove(const QString& filePath);
+    void clear();
+    int count() const;
+
+private:
+    struct Snapshot
+    {
+        QByteArray headerHash;
+        QDateTime lastModified;
+        qint64 size = 0;
+        QByteArray iv;
+        QByteArray data;
+        QByteArray mac;
+    };
+
+    KdbxSnapshotCache() = default;
+
+    static QByteArray deriveKey(const QByteArray& transformedKey, const QByteArray& headerHash, char purpose);
+
+    mutable QMutex m_mutex;
+    QHash<QString, Snapshot> m_snapshots;
+};
+
+#endif // KEEPASSX_KDBXSNAPSHOTCACHE_H
@@ -0,0 +1,124 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KdbxXmlEntryCache.h"
+
+#include "core/Entry.h"
+
+KdbxXmlEntryCache::KdbxXmlEntryCache(QObject* parent)
+    : QObject(parent)
+{
+}
+
+/**
+ * Look up the cached fragment of an entry.
+ *
+ * @param entry top-level entry
+ * @param fragment receives the cached fragment
+ * @return true if a fragment was found
+ */
+bool KdbxXmlEntryCache::fragment(const Entry* entry, Fragment& fragment) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_fragments.constFind(resolve(entry));
+    if (it == m_fragments.constEnd()) {
+        return false;
+    }
+    fragment = it.value();
+    return true;
+}
+
+void KdbxXmlEntryCache::insert(const Entry* entry, const Fragment& fragment)
+{
+    QMutexLocker locker(&m_mutex);
+    const QObject* key = resolve(entry);
+
+    // may be called from the saving thread, the connections are made only once
+    connect(key, SIGNAL(entryModified()), this, SLOT(invalidate()), Qt::UniqueConnection);
+    connect(key, SIGNAL(destroyed(QObject*)), this, SLOT(remove(QObject*)), Qt::UniqueConnection);
+
+    m_fragments.insert(key, fragment);
+}
+
+/**
+ * Use the cached fragment of an entry for a copy of it.
+ *
+ * @param alias copy of the entry with identical data
+ * @param entry entry the fragment is cached for
+ */
+void KdbxXmlEntryCache::addAlias(const Entry* alias, const Entry* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    m_aliases.insert(alias, entry);
+    m_aliasOf.insert(entry, alias);
+}
+
+void KdbxXmlEntryCache::clearAliases()
+{
+    QMutexLocker locker(&m_mutex);
+    m_aliases.clear();
+    m_aliasOf.clear();
+}
+
+/**
+ * Set the settings the cached fragments depend on, such as the format version
+ * and the memory protection flags. The cache is cleared if they changed.
+ */
+void KdbxXmlEntryCache::setContext(const QByteArray& context)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_context != context) {
+        m_fragments.clear();
+        m_context = context;
+    }
+}
+
+void KdbxXmlEntryCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_fragments.clear();
+    m_aliases.clear();
+    m_aliasOf.clear();
+}
+
+int KdbxXmlEntryCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_fragments.size();
+}
+
+void KdbxXmlEntryCache::invalidate()
+{
+    remove(sender());
+}
+
+void KdbxXmlEntryCache::remove(QObject* entry)
+{
+    QMutexLocker locker(&m_mutex);
+    m_fragments.remove(entry);
+    // a copy made before the modification must not fill the cache
+    m_aliases.remove(m_aliasOf.take(entry));
+}
+
+const QObject* KdbxXmlEntryCache::resolve(const Entry* entry) const
+{
+    auto it = m_aliases.constFind(entry);
+    if (it != m_aliases.constEnd()) {
+        return it.value();
+    }
+    return entry;
+}
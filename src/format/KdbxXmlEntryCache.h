@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_KDBXXMLENTRYCACHE_H
+#define KEEPASSX_KDBXXMLENTRYCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+
+#include "core/TimeInfo.h"
+
+class Entry;
+
+/**
+ * Serialized XML of entries, kept between saves of a database.
+ *
+ * Each fragment holds the complete <Entry> element of a top-level entry
+ * including its history. Protected values are not stored, the fragment only
+ * records where they have to be inserted. A fragment is dropped as soon as
+ * its entry is modified or deleted.
+ *
+ * Entries of a database snapshot can be registered as aliases of the live
+ * entries they were copied from, so saving the snapshot uses and fills the
+ * cache of the live database. An alias is dropped together with the fragment
+ * when the live entry is modified.
+ */
+class KdbxXmlEntryCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Position of a protected value that is encrypted while writing.
+     * The value belongs to the entry itself or one of its history items.
+     */
+    struct Placeholder
+    {
+        int offset;
+        int historyIndex;
+        QString key;
+    };
+
+    struct Fragment
+    {
+        QByteArray xml;
+        QList<Placeholder> placeholders;
+        QList<QPair<QByteArray, int>> binaryRefs;
+        TimeInfo timeInfo;
+        int depth = 0;
+    };
+
+    explicit KdbxXmlEntryCache(QObject* parent = nullptr);
+
+    bool fragment(const Entry* entry, Fragment& fragment) const;
+    void insert(const Entry* entry, const Fragment& fragment);
+    void addAlias(const Entry* alias, const Entry* entry);
+    void clearAliases();
+    void setContext(const QByteArray& context);
+    void clear();
+    int size() const;
+
+private slots:
+    void invalidate();
+    void remove(QObject* entry);
+
+private:
+    const QObject* resolve(const Entry* entry) const;
+
+    mutable QMutex m_mutex;
+    QHash<const QObject*, Fragment> m_fragments;
+    QHash<const QObject*, const Entry*> m_aliases;
+    QHash<const QObject*, const QObject*> m_aliasOf;
+    QByteArray m_context;
+};
+
+#endif // KEEPASSX_KDBXXMLENTRYCACHE_H
@@ -28,10 +28,98 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QtEndian>
 #include <utility>
 
 #define UUID_LENGTH 16
 
+namespace
+{
+    int base64Value(QChar c)
+    {
+        const ushort ch = c.unicode();
+        if (ch >= 'A' && ch <= 'Z') {
+            return ch - 'A';
+        }
+        if (ch >= 'a' && ch <= 'z') {
+            return ch - 'a' + 26;
+        }
+        if (ch >= '0' && ch <= '9') {
+            return ch - '0' + 52;
+        }
+        if (ch == '+') {
+            return 62;
+        }
+        if (ch == '/') {
+            return 63;
+        }
+        return -1;
+    }
+
+    /**
+     * Strict check for padded base64, equivalent to Tools::isBase64().
+     */
+    bool isBase64(const QStringRef& text)
+    {
+        const int size = text.size();
+        if (size % 4 != 0) {
+            return false;
+        }
+
+        int padding = 0;
+        if (size > 0 && text.at(size - 1) == '=') {
+            padding = (text.at(size - 2) == '=') ? 2 : 1;
+        }
+        for (int i = 0; i < size - padding; ++i) {
+            if (base64Value(text.at(i)) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Decode base64 text, skipping invalid characters like QByteArray::fromBase64().
+     *
+     * @param text base64 text
+     * @param out output buffer
+     * @param maxSize size of the output buffer, further bytes are only counted
+     * @return number of decoded bytes
+     */
+    int decodeBase64(const QStringRef& text, char* out, int maxSize)
+    {
+        uint buffer = 0;
+        int bits = 0;
+        int size = 0;
+
+        for (const QChar c : text) {
+            const int value = base64Value(c);
+            if (value < 0) {
+                continue;
+            }
+            buffer = (buffer << 6) | static_cast<uint>(value);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                if (size < maxSize) {
+                    out[size] = static_cast<char>(buffer >> bits);
+                }
+                ++size;
+                buffer &= (1u << bits) - 1;
+            }
+        }
+
+        return size;
+    }
+
+    QByteArray decodeBase64(const QStringRef& text)
+    {
+        QByteArray data((text.size() * 3) / 4, Qt::Uninitialized);
+        data.resize(decodeBase64(text, data.data(), data.size()));
+        return data;
+    }
+} // namespace
+
 /**
  * @param version KDBX version
  */
@@ -44,7 +132,7 @@ KdbxXmlReader::KdbxXmlReader(quint32 version)
  * @param version KDBX version
  * @param binaryPool binary pool
  */
-KdbxXmlReader::KdbxXmlReader(quint32 version, QHash<QString, QByteArray> binaryPool)
+KdbxXmlReader::KdbxXmlReader(quint32 version, QHash<int, QByteArray> binaryPool)
     : m_kdbxVersion(version)
     , m_binaryPool(std::move(binaryPool))
 {
@@ -100,6 +188,9 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
 
     m_tmpParent.reset(new Group());
 
+    // every pool item is usually referenced at least once
+    m_binaryMap.reserve(m_binaryPool.size());
+
     bool rootGroupParsed = false;
 
     if (m_xml.hasError()) {
@@ -113,6 +204,7 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
 
     if (!rootGroupParsed) {
         raiseError(tr("No root group"));
+        addHistoryItems();
         return;
     }
 
@@ -124,24 +216,35 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
         qWarning("KdbxXmlReader::readDatabase: found %d invalid entry reference(s)", m_tmpParent->children().size());
     }
 
-    const QSet<QString> poolKeys = asConst(m_binaryPool).keys().toSet();
-    const QSet<QString> entryKeys = asConst(m_binaryMap).keys().toSet();
-    const QSet<QString> unmappedKeys = entryKeys - poolKeys;
-    const QSet<QString> unusedKeys = poolKeys - entryKeys;
+    const QSet<int> poolKeys = asConst(m_binaryPool).keys().toSet();
+    const QSet<int> entryKeys = asConst(m_binaryMap).keys().toSet();
+    const QSet<int> unmappedKeys = entryKeys - poolKeys;
+    const QSet<int> unusedKeys = poolKeys - entryKeys;
 
     if (!unmappedKeys.isEmpty()) {
         qWarning("Unmapped keys left.");
     }
 
-    for (const QString& key : unusedKeys) {
-        qWarning("KdbxXmlReader::readDatabase: found unused key \"%s\"", qPrintable(key));
+    for (int key : unusedKeys) {
+        qWarning("KdbxXmlReader::readDatabase: found unused key \"%d\"", key);
     }
 
-    QHash<QString, QPair<Entry*, QString>>::const_iterator i;
+    // Store every pool item once and share it between all entries referencing it,
+    // then release the pool once everything is bound
+    QHash<int, AttachmentStore::Blob> blobs;
+    blobs.reserve(m_binaryPool.size());
+    QMultiHash<int, QPair<Entry*, QString>>::const_iterator i;
     for (i = m_binaryMap.constBegin(); i != m_binaryMap.constEnd(); ++i) {
+        auto blob = blobs.find(i.key());
+        if (blob == blobs.end()) {
+            blob = blobs.insert(i.key(), AttachmentStore::instance()->store(m_binaryPool.value(i.key())));
+        }
         const QPair<Entry*, QString>& target = i.value();
-        target.first->attachments()->set(target.second, m_binaryPool[i.key()]);
+        target.first->attachments()->set(target.second, blob.value());
     }
+    m_binaryPool.clear();
+    m_binaryMap.clear();
+    addHistoryItems();
 
     m_meta->setUpdateDatetime(true);
 
@@ -153,12 +256,20 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
     QHash<QUuid, Entry*>::const_iterator iEntry;
     for (iEntry = m_entries.constBegin(); iEntry != m_entries.constEnd(); ++iEntry) {
         iEntry.value()->setUpdateTimeinfo(true);
+    }
+}
 
-        const QList<Entry*> historyItems = iEntry.value()->historyItems();
-        for (Entry* histEntry : historyItems) {
-            histEntry->setUpdateTimeinfo(true);
-        }
+/**
+ * Add the parsed history items to their entries. This has to wait until the
+ * attachments are bound, as the entries only keep snapshots of them.
+ */
+void KdbxXmlReader::addHistoryItems()
+{
+    for (const auto& historyItem : asConst(m_historyItems)) {
+        historyItem.first->addHistoryItem(EntrySnapshot(historyItem.second));
+        delete historyItem.second;
     }
+    m_historyItems.clear();
 }
 
 bool KdbxXmlReader::strictMode() const
@@ -201,6 +312,65 @@ void KdbxXmlReader::raiseError(const QString& errorMessage)
     m_errorStr = errorMessage;
 }
 
+/**
+ * Map an element name to its id without allocating memory.
+ */
+KdbxXmlReader::Element KdbxXmlReader::element(const QStringRef& name)
+{
+    static const QList<QPair<QString, Element>> names = {
+        {QStringLiteral("AutoType"), Element::AutoType},
+        {QStringLiteral("Association"), Element::Association},
+        {QStringLiteral("BackgroundColor"), Element::BackgroundColor},
+        {QStringLiteral("Binary"), Element::Binary},
+        {QStringLiteral("CreationTime"), Element::CreationTime},
+        {QStringLiteral("CustomData"), Element::CustomData},
+        {QStringLiteral("CustomIconUUID"), Element::CustomIconUUID},
+        {QStringLiteral("DataTransferObfuscation"), Element::DataTransferObfuscation},
+        {QStringLiteral("DefaultAutoTypeSequence"), Element::DefaultAutoTypeSequence},
+        {QStringLiteral("DefaultSequence"), Element::DefaultSequence},
+        {QStringLiteral("DeletionTime"), Element::DeletionTime},
+        {QStringLiteral("Enabled"), Element::Enabled},
+        {QStringLiteral("EnableAutoType"), Element::EnableAutoType},
+        {QStringLiteral("EnableSearching"), Element::EnableSearching},
+        {QStringLiteral("Entry"), Element::Entry},
+        {QStringLiteral("Expires"), Element::Expires},
+        {QStringLiteral("ExpiryTime"), Element::ExpiryTime},
+        {QStringLiteral("ForegroundColor"), Element::ForegroundColor},
+        {QStringLiteral("Group"), Element::Group},
+        {QStringLiteral("History"), Element::History},
+        {QStringLiteral("IconID"), Element::IconID},
+        {QStringLiteral("IsExpanded"), Element::IsExpanded},
+        {QStringLiteral("Item"), Element::Item},
+        {QStringLiteral("Key"), Element::Key},
+        {QStringLiteral("KeystrokeSequence"), Element::KeystrokeSequence},
+        {QStringLiteral("LastAccessTime"), Element::LastAccessTime},
+        {QStringLiteral("LastModificationTime"), Element::LastModificationTime},
+        {QStringLiteral("LastTopVisibleEntry"), Element::LastTopVisibleEntry},
+        {QStringLiteral("LocationChanged"), Element::LocationChanged},
+        {QStringLiteral("Name"), Element::Name},
+        {QStringLiteral("Notes"), Element::Notes},
+        {QStringLiteral("OverrideURL"), Element::OverrideURL},
+        {QStringLiteral("String"), Element::String},
+        {QStringLiteral("Tags"), Element::Tags},
+        {QStringLiteral("Times"), Element::Times},
+        {QStringLiteral("UsageCount"), Element::UsageCount},
+        {QStringLiteral("UUID"), Element::UUID},
+        {QStringLiteral("Value"), Element::Value},
+        {QStringLiteral("Window"), Element::Window},
+    };
+
+    // keys refer to the static names above
+    static const QHash<QStringRef, Element> elements = [] {
+        QHash<QStringRef, Element> elements;
+        for (const auto& name : names) {
+            elements.insert(QStringRef(&name.first), name.second);
+        }
+        return elements;
+    }();
+
+    return elements.value(name, Element::Unknown);
+}
+
 QByteArray KdbxXmlReader::headerHash() const
 {
     return m_headerHash;
@@ -389,11 +559,18 @@ void KdbxXmlReader::parseBinaries()
         }
 
         QXmlStreamAttributes attr = m_xml.attributes();
-        QString id = attr.value("ID").toString();
+        bool ok;
+        int id = attr.value("ID").toInt(&ok);
+        if (!ok) {
+            qWarning("KdbxXmlReader::parseBinaries: invalid binary item id \"%s\"",
+                     qPrintable(attr.value("ID").toString()));
+            skipCurrentElement();
+            continue;
+        }
         QByteArray data = isTrueValue(attr.value("Compressed")) ? readCompressedBinary() : readBinary();
 
         if (m_binaryPool.contains(id)) {
-            qWarning("KdbxXmlReader::parseBinaries: overwriting binary item \"%s\"", qPrintable(id));
+            qWarning("KdbxXmlReader::parseBinaries: overwriting binary item \"%d\"", id);
         }
 
         m_binaryPool.insert(id, data);
@@ -405,7 +582,7 @@ void KdbxXmlReader::parseCustomData(CustomData* customData)
     Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "CustomData");
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Item") {
+        if (element(m_xml.name()) == Element::Item) {
             parseCustomDataItem(customData);
             continue;
         }
@@ -423,13 +600,16 @@ void KdbxXmlReader::parseCustomDataItem(CustomData* customData)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (element(m_xml.name())) {
+        case Element::Key:
             key = readString();
             keySet = true;
-        } else if (m_xml.name() == "Value") {
+            break;
+        case Element::Value:
             value = readString();
             valueSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
         }
     }
@@ -485,7 +665,8 @@ Group* KdbxXmlReader::parseGroup()
     QList<Group*> children;
     QList<Entry*> entries;
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (element(m_xml.name())) {
+        case Element::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
@@ -496,17 +677,15 @@ Group* KdbxXmlReader::parseGroup()
             } else {
                 group->setUuid(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Name") {
+        case Element::Name:
             group->setName(readString());
-            continue;
-        }
-        if (m_xml.name() == "Notes") {
+            break;
+        case Element::Notes:
             group->setNotes(readString());
-            continue;
-        }
-        if (m_xml.name() == "IconID") {
+            break;
+        case Element::IconID: {
             int iconId = readNumber();
             if (iconId < 0) {
                 if (m_strictMode) {
@@ -519,79 +698,75 @@ Group* KdbxXmlReader::parseGroup()
             }
 
             group->setIcon(iconId);
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomIconUUID") {
+        case Element::CustomIconUUID: {
             QUuid uuid = readUuid();
             if (!uuid.isNull()) {
                 group->setIcon(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Times") {
+        case Element::Times:
             group->setTimeInfo(parseTimes());
-            continue;
-        }
-        if (m_xml.name() == "IsExpanded") {
+            break;
+        case Element::IsExpanded:
             group->setExpanded(readBool());
-            continue;
-        }
-        if (m_xml.name() == "DefaultAutoTypeSequence") {
+            break;
+        case Element::DefaultAutoTypeSequence:
             group->setDefaultAutoTypeSequence(readString());
-            continue;
-        }
-        if (m_xml.name() == "EnableAutoType") {
-            QString str = readString();
+            break;
+        case Element::EnableAutoType: {
+            const QStringRef str = readElementTextRef();
 
-            if (str.compare("null", Qt::CaseInsensitive) == 0) {
+            if (str.compare(QLatin1String("null"), Qt::CaseInsensitive) == 0) {
                 group->setAutoTypeEnabled(Group::Inherit);
-            } else if (str.compare("true", Qt::CaseInsensitive) == 0) {
+            } else if (str.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0) {
                 group->setAutoTypeEnabled(Group::Enable);
-            } else if (str.compare("false", Qt::CaseInsensitive) == 0) {
+            } else if (str.compare(QLatin1String("false"), Qt::CaseInsensitive) == 0) {
                 group->setAutoTypeEnabled(Group::Disable);
             } else {
                 raiseError(tr("Invalid EnableAutoType value"));
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "EnableSearching") {
-            QString str = readString();
+        case Element::EnableSearching: {
+            const QStringRef str = readElementTextRef();
 
-            if (str.compare("null", Qt::CaseInsensitive) == 0) {
+            if (str.compare(QLatin1String("null"), Qt::CaseInsensitive) == 0) {
                 group->setSearchingEnabled(Group::Inherit);
-            } else if (str.compare("true", Qt::CaseInsensitive) == 0) {
+            } else if (str.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0) {
                 group->setSearchingEnabled(Group::Enable);
-            } else if (str.compare("false", Qt::CaseInsensitive) == 0) {
+            } else if (str.compare(QLatin1String("false"), Qt::CaseInsensitive) == 0) {
                 group->setSearchingEnabled(Group::Disable);
             } else {
                 raiseError(tr("Invalid EnableSearching value"));
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "LastTopVisibleEntry") {
+        case Element::LastTopVisibleEntry:
             group->setLastTopVisibleEntry(getEntry(readUuid()));
-            continue;
-        }
-        if (m_xml.name() == "Group") {
+            break;
+        case Element::Group: {
             Group* newGroup = parseGroup();
             if (newGroup) {
                 children.append(newGroup);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Entry") {
+        case Element::Entry: {
             Entry* newEntry = parseEntry(false);
             if (newEntry) {
                 entries.append(newEntry);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomData") {
+        case Element::CustomData:
             parseCustomData(group->customData());
-            continue;
+            break;
+        default:
+            skipCurrentElement();
         }
-
-        skipCurrentElement();
     }
 
     if (group->uuid().isNull() && !m_strictMode) {
@@ -639,23 +814,25 @@ void KdbxXmlReader::parseDeletedObject()
     DeletedObject delObj{{}, {}};
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (element(m_xml.name())) {
+        case Element::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
                     raiseError(tr("Null DeleteObject uuid"));
                     return;
                 }
-                continue;
+                break;
             }
             delObj.uuid = uuid;
-            continue;
+            break;
         }
-        if (m_xml.name() == "DeletionTime") {
+        case Element::DeletionTime:
             delObj.deletionTime = readDateTime();
-            continue;
+            break;
+        default:
+            skipCurrentElement();
         }
-        skipCurrentElement();
     }
 
     if (!delObj.uuid.isNull() && !delObj.deletionTime.isNull()) {
@@ -675,10 +852,11 @@ Entry* KdbxXmlReader::parseEntry(bool history)
     auto entry = new Entry();
     entry->setUpdateTimeinfo(false);
     QList<Entry*> historyItems;
-    QList<StringPair> binaryRefs;
+    QList<BinaryRef> binaryRefs;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (element(m_xml.name())) {
+        case Element::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
@@ -689,9 +867,9 @@ Entry* KdbxXmlReader::parseEntry(bool history)
             } else {
                 entry->setUuid(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "IconID") {
+        case Element::IconID: {
             int iconId = readNumber();
             if (iconId < 0) {
                 if (m_strictMode) {
@@ -700,63 +878,56 @@ Entry* KdbxXmlReader::parseEntry(bool history)
                 iconId = 0;
             }
             entry->setIcon(iconId);
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomIconUUID") {
+        case Element::CustomIconUUID: {
             QUuid uuid = readUuid();
             if (!uuid.isNull()) {
                 entry->setIcon(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "ForegroundColor") {
+        case Element::ForegroundColor:
             entry->setForegroundColor(readColor());
-            continue;
-        }
-        if (m_xml.name() == "BackgroundColor") {
+            break;
+        case Element::BackgroundColor:
             entry->setBackgroundColor(readColor());
-            continue;
-        }
-        if (m_xml.name() == "OverrideURL") {
+            break;
+        case Element::OverrideURL:
             entry->setOverrideUrl(readString());
-            continue;
-        }
-        if (m_xml.name() == "Tags") {
+            break;
+        case Element::Tags:
             entry->setTags(readString());
-            continue;
-        }
-        if (m_xml.name() == "Times") {
+            break;
+        case Element::Times:
             entry->setTimeInfo(parseTimes());
-            continue;
-        }
-        if (m_xml.name() == "String") {
+            break;
+        case Element::String:
             parseEntryString(entry);
-            continue;
-        }
-        if (m_xml.name() == "Binary") {
-            QPair<QString, QString> ref = parseEntryBinary(entry);
-            if (!ref.first.isEmpty() && !ref.second.isEmpty()) {
+            break;
+        case Element::Binary: {
+            BinaryRef ref = parseEntryBinary(entry);
+            if (ref.first >= 0 && !ref.second.isEmpty()) {
                 binaryRefs.append(ref);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "AutoType") {
+        case Element::AutoType:
             parseAutoType(entry);
-            continue;
-        }
-        if (m_xml.name() == "History") {
+            break;
+        case Element::History:
             if (history) {
                 raiseError(tr("History element in history entry"));
             } else {
                 historyItems = parseEntryHistory();
             }
-            continue;
-        }
-        if (m_xml.name() == "CustomData") {
+            break;
+        case Element::CustomData:
             parseCustomData(entry->customData());
-            continue;
+            break;
+        default:
+            skipCurrentElement();
         }
-        skipCurrentElement();
     }
 
     if (entry->uuid().isNull() && !m_strictMode) {
@@ -787,10 +958,10 @@ Entry* KdbxXmlReader::parseEntry(bool history)
                 historyItem->setUuid(entry->uuid());
             }
         }
-        entry->addHistoryItem(historyItem);
+        m_historyItems.append(qMakePair(entry, historyItem));
     }
 
-    for (const StringPair& ref : asConst(binaryRefs)) {
+    for (const BinaryRef& ref : asConst(binaryRefs)) {
         m_binaryMap.insertMulti(ref.first, qMakePair(entry, ref.second));
     }
 
@@ -808,23 +979,22 @@ void KdbxXmlReader::parseEntryString(Entry* entry)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (element(m_xml.name())) {
+        case Element::Key:
             key = readString();
             keySet = true;
-            continue;
-        }
-
-        if (m_xml.name() == "Value") {
-            QXmlStreamAttributes attr = m_xml.attributes();
+            break;
+        case Element::Value: {
             bool isProtected;
             bool protectInMemory;
             value = readString(isProtected, protectInMemory);
             protect = isProtected || protectInMemory;
             valueSet = true;
-            continue;
+            break;
+        }
+        default:
+            skipCurrentElement();
         }
-
-        skipCurrentElement();
     }
 
     if (keySet && valueSet) {
@@ -840,11 +1010,11 @@ void KdbxXmlReader::parseEntryString(Entry* entry)
     raiseError(tr("Entry string key or value missing"));
 }
 
-QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
+KdbxXmlReader::BinaryRef KdbxXmlReader::parseEntryBinary(Entry* entry)
 {
     Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Binary");
 
-    QPair<QString, QString> poolRef;
+    BinaryRef poolRef(-1, QString());
 
     QString key;
     QByteArray value;
@@ -852,16 +1022,23 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (element(m_xml.name())) {
+        case Element::Key:
             key = readString();
             keySet = true;
-            continue;
-        }
-        if (m_xml.name() == "Value") {
-            QXmlStreamAttributes attr = m_xml.attributes();
-
-            if (attr.hasAttribute("Ref")) {
-                poolRef = qMakePair(attr.value("Ref").toString(), key);
+            break;
+        case Element::Value: {
+            const QXmlStreamAttributes attr = m_xml.attributes();
+
+            if (attr.hasAttribute(QLatin1String("Ref"))) {
+                bool ok;
+                int ref = attr.value(QLatin1String("Ref")).toInt(&ok);
+                if (ok) {
+                    poolRef = qMakePair(ref, key);
+                } else {
+                    qWarning("KdbxXmlReader::parseEntryBinary: invalid binary reference \"%s\"",
+                             qPrintable(attr.value(QLatin1String("Ref")).toString()));
+                }
                 m_xml.skipCurrentElement();
             } else {
                 // format compatibility
@@ -869,9 +1046,11 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
             }
 
             valueSet = true;
-            continue;
+            break;
+        }
+        default:
+            skipCurrentElement();
         }
-        skipCurrentElement();
     }
 
     if (keySet && valueSet) {
@@ -894,15 +1073,20 @@ void KdbxXmlReader::parseAutoType(Entry* entry)
     Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "AutoType");
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Enabled") {
+        switch (element(m_xml.name())) {
+        case Element::Enabled:
             entry->setAutoTypeEnabled(readBool());
-        } else if (m_xml.name() == "DataTransferObfuscation") {
+            break;
+        case Element::DataTransferObfuscation:
             entry->setAutoTypeObfuscation(readNumber());
-        } else if (m_xml.name() == "DefaultSequence") {
+            break;
+        case Element::DefaultSequence:
             entry->setDefaultAutoTypeSequence(readString());
-        } else if (m_xml.name() == "Association") {
+            break;
+        case Element::Association:
             parseAutoTypeAssoc(entry);
-        } else {
+            break;
+        default:
             skipCurrentElement();
         }
     }
@@ -917,13 +1101,16 @@ void KdbxXmlReader::parseAutoTypeAssoc(Entry* entry)
     bool sequenceSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Window") {
+        switch (element(m_xml.name())) {
+        case Element::Window:
             assoc.window = readString();
             windowSet = true;
-        } else if (m_xml.name() == "KeystrokeSequence") {
+            break;
+        case Element::KeystrokeSequence:
             assoc.sequence = readString();
             sequenceSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
         }
     }
@@ -942,7 +1129,7 @@ QList<Entry*> KdbxXmlReader::parseEntryHistory()
     QList<Entry*> historyItems;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Entry") {
+        if (element(m_xml.name()) == Element::Entry) {
             historyItems.append(parseEntry(true));
         } else {
             skipCurrentElement();
@@ -958,21 +1145,29 @@ TimeInfo KdbxXmlReader::parseTimes()
 
     TimeInfo timeInfo;
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "LastModificationTime") {
+        switch (element(m_xml.name())) {
+        case Element::LastModificationTime:
             timeInfo.setLastModificationTime(readDateTime());
-        } else if (m_xml.name() == "CreationTime") {
+            break;
+        case Element::CreationTime:
             timeInfo.setCreationTime(readDateTime());
-        } else if (m_xml.name() == "LastAccessTime") {
+            break;
+        case Element::LastAccessTime:
             timeInfo.setLastAccessTime(readDateTime());
-        } else if (m_xml.name() == "ExpiryTime") {
+            break;
+        case Element::ExpiryTime:
             timeInfo.setExpiryTime(readDateTime());
-        } else if (m_xml.name() == "Expires") {
+            break;
+        case Element::Expires:
             timeInfo.setExpires(readBool());
-        } else if (m_xml.name() == "UsageCount") {
+            break;
+        case Element::UsageCount:
             timeInfo.setUsageCount(readNumber());
-        } else if (m_xml.name() == "LocationChanged") {
+            break;
+        case Element::LocationChanged:
             timeInfo.setLocationChanged(readDateTime());
-        } else {
+            break;
+        default:
             skipCurrentElement();
         }
     }
@@ -990,35 +1185,36 @@ QString KdbxXmlReader::readString()
 
 QString KdbxXmlReader::readString(bool& isProtected, bool& protectInMemory)
 {
-    QXmlStreamAttributes attr = m_xml.attributes();
-    isProtected = isTrueValue(attr.value("Protected"));
-    protectInMemory = isTrueValue(attr.value("ProtectInMemory"));
-    QString value = m_xml.readElementText();
+    const QXmlStreamAttributes attr = m_xml.attributes();
+    isProtected = isTrueValue(attr.value(QLatin1String("Protected")));
+    protectInMemory = isTrueValue(attr.value(QLatin1String("ProtectInMemory")));
 
-    if (isProtected && !value.isEmpty()) {
-        QByteArray ciphertext = QByteArray::fromBase64(value.toLatin1());
-        bool ok;
-        QByteArray plaintext = m_randomStream->process(ciphertext, &ok);
-        if (!ok) {
-            value.clear();
-            raiseError(m_randomStream->errorString());
-            return value;
-        }
+    if (!isProtected) {
+        return m_xml.readElementText();
+    }
 
-        value = QString::fromUtf8(plaintext);
+    const QStringRef text = readElementTextRef();
+    if (text.isEmpty()) {
+        return {};
     }
 
-    return value;
+    QByteArray plaintext = decodeBase64(text);
+    if (!m_randomStream->processInPlace(plaintext)) {
+        raiseError(m_randomStream->errorString());
+        return {};
+    }
+
+    return QString::fromUtf8(plaintext);
 }
 
 bool KdbxXmlReader::readBool()
 {
-    QString str = readString();
+    const QStringRef str = readElementTextRef();
 
-    if (str.compare("true", Qt::CaseInsensitive) == 0) {
+    if (str.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0) {
         return true;
     }
-    if (str.compare("false", Qt::CaseInsensitive) == 0) {
+    if (str.compare(QLatin1String("false"), Qt::CaseInsensitive) == 0) {
         return false;
     }
     if (str.length() == 0) {
@@ -1030,14 +1226,18 @@ bool KdbxXmlReader::readBool()
 
 QDateTime KdbxXmlReader::readDateTime()
 {
-    QString str = readString();
-    if (Tools::isBase64(str.toLatin1())) {
-        QByteArray secsBytes = QByteArray::fromBase64(str.toUtf8()).leftJustified(8, '\0', true).left(8);
-        qint64 secs = Endian::bytesToSizedInt<quint64>(secsBytes, KeePass2::BYTEORDER);
-        return QDateTime(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC).addSecs(secs);
+    static const QDateTime epoch(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC);
+
+    const QStringRef str = readElementTextRef();
+    if (isBase64(str)) {
+        // seconds since year 1 in KeePass2::BYTEORDER, missing bytes are zero
+        char secsBytes[8] = {};
+        decodeBase64(str, secsBytes, sizeof(secsBytes));
+        qint64 secs = qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(secsBytes));
+        return epoch.addSecs(secs);
     }
 
-    QDateTime dt = Clock::parse(str, Qt::ISODate);
+    QDateTime dt = Clock::parse(str.toString(), Qt::ISODate);
     if (dt.isValid()) {
         return dt;
     }
@@ -1082,7 +1282,7 @@ QString KdbxXmlReader::readColor()
 int KdbxXmlReader::readNumber()
 {
     bool ok;
-    int result = readString().toInt(&ok);
+    int result = readElementTextRef().toInt(&ok);
     if (!ok) {
         raiseError(tr("Invalid number value"));
     }
@@ -1091,36 +1291,53 @@ int KdbxXmlReader::readNumber()
 
 QUuid KdbxXmlReader::readUuid()
 {
-    QByteArray uuidBin = readBinary();
-    if (uuidBin.isEmpty()) {
+    // protected values have to be decrypted in document order
+    if (isTrueValue(m_xml.attributes().value(QLatin1String("Protected")))) {
+        QByteArray uuidBin = readBinary();
+        if (uuidBin.isEmpty()) {
+            return QUuid();
+        }
+        if (uuidBin.length() != UUID_LENGTH) {
+            if (m_strictMode) {
+                raiseError(tr("Invalid uuid value"));
+            }
+            return QUuid();
+        }
+        return QUuid::fromRfc4122(uuidBin);
+    }
+
+    uchar uuidBin[UUID_LENGTH];
+    const int size = decodeBase64(readElementTextRef(), reinterpret_cast<char*>(uuidBin), UUID_LENGTH);
+    if (size == 0) {
         return QUuid();
     }
-    if (uuidBin.length() != UUID_LENGTH) {
+    if (size != UUID_LENGTH) {
         if (m_strictMode) {
             raiseError(tr("Invalid uuid value"));
         }
         return QUuid();
     }
-    return QUuid::fromRfc4122(uuidBin);
+    return QUuid(qFromBigEndian<quint32>(uuidBin),
+                 qFromBigEndian<quint16>(uuidBin + 4),
+                 qFromBigEndian<quint16>(uuidBin + 6),
+                 uuidBin[8],
+                 uuidBin[9],
+                 uuidBin[10],
+                 uuidBin[11],
+                 uuidBin[12],
+                 uuidBin[13],
+                 uuidBin[14],
+                 uuidBin[15]);
 }
 
 QByteArray KdbxXmlReader::readBinary()
 {
-    QXmlStreamAttributes attr = m_xml.attributes();
-    bool isProtected = isTrueValue(attr.value("Protected"));
-    QString value = m_xml.readElementText();
-    QByteArray data = QByteArray::fromBase64(value.toLatin1());
-
-    if (isProtected && !data.isEmpty()) {
-        bool ok;
-        QByteArray plaintext = m_randomStream->process(data, &ok);
-        if (!ok) {
-            data.clear();
-            raiseError(m_randomStream->errorString());
-            return data;
-        }
+    bool isProtected = isTrueValue(m_xml.attributes().value(QLatin1String("Protected")));
+    QByteArray data = decodeBase64(readElementTextRef());
 
-        data = plaintext;
+    if (isProtected && !data.isEmpty() && !m_randomStream->processInPlace(data)) {
+        data.clear();
+        raiseError(m_randomStream->errorString());
     }
 
     return data;
@@ -1145,6 +1362,38 @@ QByteArray KdbxXmlReader::readCompressedBinary()
     return result;
 }
 
+/**
+ * Read the text of the current element into a buffer that is reused for
+ * every element, so values that are decoded right away need no allocation.
+ *
+ * @return text of the element, valid until the next call
+ */
+QStringRef KdbxXmlReader::readElementTextRef()
+{
+    m_textBuffer.truncate(0);
+
+    while (!m_xml.atEnd()) {
+        switch (m_xml.readNext()) {
+        case QXmlStreamReader::Characters:
+        case QXmlStreamReader::EntityReference:
+            m_textBuffer.append(m_xml.text());
+            break;
+        case QXmlStreamReader::EndElement:
+            return QStringRef(&m_textBuffer);
+        case QXmlStreamReader::Comment:
+        case QXmlStreamReader::ProcessingInstruction:
+            break;
+        case QXmlStreamReader::StartElement:
+            m_xml.raiseError(tr("Expected character data."));
+            return {};
+        default:
+            return {};
+        }
+    }
+
+    return {};
+}
+
 Group* KdbxXmlReader::getGroup(const QUuid& uuid)
 {
     if (uuid.isNull()) {
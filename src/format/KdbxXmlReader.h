@@ -41,7 +41,7 @@ class KdbxXmlReader
 
 public:
     explicit KdbxXmlReader(quint32 version);
-    explicit KdbxXmlReader(quint32 version, QHash<QString, QByteArray> binaryPool);
+    explicit KdbxXmlReader(quint32 version, QHash<int, QByteArray> binaryPool);
     virtual ~KdbxXmlReader() = default;
 
     virtual QSharedPointer<Database> readDatabase(const QString& filename);
@@ -58,6 +58,56 @@ public:
 
 protected:
     typedef QPair<QString, QString> StringPair;
+    typedef QPair<int, QString> BinaryRef;
+
+    /**
+     * Elements that are dispatched on while parsing groups and entries.
+     */
+    enum class Element
+    {
+        Unknown,
+        AutoType,
+        Association,
+        BackgroundColor,
+        Binary,
+        CreationTime,
+        CustomData,
+        CustomIconUUID,
+        DataTransferObfuscation,
+        DefaultAutoTypeSequence,
+        DefaultSequence,
+        DeletionTime,
+        Enabled,
+        EnableAutoType,
+        EnableSearching,
+        Entry,
+        Expires,
+        ExpiryTime,
+        ForegroundColor,
+        Group,
+        History,
+        IconID,
+        IsExpanded,
+        Item,
+        Key,
+        KeystrokeSequence,
+        LastAccessTime,
+        LastModificationTime,
+        LastTopVisibleEntry,
+        LocationChanged,
+        Name,
+        Notes,
+        OverrideURL,
+        String,
+        Tags,
+        Times,
+        UsageCount,
+        UUID,
+        Value,
+        Window
+    };
+
+    static Element element(const QStringRef& name);
 
     virtual bool parseKeePassFile();
     virtual void parseMeta();
@@ -73,7 +123,7 @@ protected:
     virtual void parseDeletedObject();
     virtual Entry* parseEntry(bool history);
     virtual void parseEntryString(Entry* entry);
-    virtual QPair<QString, QString> parseEntryBinary(Entry* entry);
+    virtual BinaryRef parseEntryBinary(Entry* entry);
     virtual void parseAutoType(Entry* entry);
     virtual void parseAutoTypeAssoc(Entry* entry);
     virtual QList<Entry*> parseEntryHistory();
@@ -88,6 +138,7 @@ protected:
     virtual QUuid readUuid();
     virtual QByteArray readBinary();
     virtual QByteArray readCompressedBinary();
+    QStringRef readElementTextRef();
 
     virtual void skipCurrentElement();
 
@@ -97,6 +148,8 @@ protected:
     virtual bool isTrueValue(const QStringRef& value);
     virtual void raiseError(const QString& errorMessage);
 
+    void addHistoryItems();
+
     const quint32 m_kdbxVersion;
 
     bool m_strictMode = false;
@@ -105,13 +158,15 @@ protected:
     QPointer<Metadata> m_meta;
     KeePass2RandomStream* m_randomStream = nullptr;
     QXmlStreamReader m_xml;
+    QString m_textBuffer;
 
     QScopedPointer<Group> m_tmpParent;
     QHash<QUuid, Group*> m_groups;
     QHash<QUuid, Entry*> m_entries;
 
-    QHash<QString, QByteArray> m_binaryPool;
-    QHash<QString, QPair<Entry*, QString>> m_binaryMap;
+    QHash<int, QByteArray> m_binaryPool;
+    QMultiHash<int, QPair<Entry*, QString>> m_binaryMap;
+    QList<QPair<Entry*, Entry*>> m_historyItems;
     QByteArray m_headerHash;
 
     bool m_error = false;
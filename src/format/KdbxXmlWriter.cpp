@@ -19,12 +19,73 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QtEndian>
+#include <cstring>
 
-#include "core/Endian.h"
 #include "core/Metadata.h"
 #include "format/KeePass2RandomStream.h"
+#include "streams/BufferedWriteStream.h"
 #include "streams/QtIOCompressor"
 
+namespace
+{
+    const char Base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    int base64Size(int size)
+    {
+        return (size + 2) / 3 * 4;
+    }
+
+    /**
+     * Encode data as padded base64 into a buffer of base64Size(size) characters.
+     */
+    template <typename T> void encodeBase64(const char* data, int size, T* out)
+    {
+        const auto* in = reinterpret_cast<const uchar*>(data);
+        int i = 0;
+        for (; i + 2 < size; i += 3) {
+            const uint triple = (uint(in[i]) << 16) | (uint(in[i + 1]) << 8) | in[i + 2];
+            *out++ = static_cast<T>(Base64Alphabet[(triple >> 18) & 0x3F]);
+            *out++ = static_cast<T>(Base64Alphabet[(triple >> 12) & 0x3F]);
+            *out++ = static_cast<T>(Base64Alphabet[(triple >> 6) & 0x3F]);
+            *out++ = static_cast<T>(Base64Alphabet[triple & 0x3F]);
+        }
+
+        if (i < size) {
+            const bool two = (i + 1 < size);
+            const uint triple = (uint(in[i]) << 16) | (two ? uint(in[i + 1]) << 8 : 0);
+            *out++ = static_cast<T>(Base64Alphabet[(triple >> 18) & 0x3F]);
+            *out++ = static_cast<T>(Base64Alphabet[(triple >> 12) & 0x3F]);
+            *out++ = static_cast<T>(two ? Base64Alphabet[(triple >> 6) & 0x3F] : '=');
+            *out++ = static_cast<T>('=');
+        }
+    }
+
+    /**
+     * Length of the character at the given position if it is valid in XML 1.0,
+     * 2 for a surrogate pair and 0 if it has to be stripped.
+     */
+    int xml10CharLength(const QString& str, int i)
+    {
+        const QChar ch = str.at(i);
+        const ushort uc = ch.unicode();
+
+        if (ch.isHighSurrogate() && i + 1 < str.size() && str.at(i + 1).isLowSurrogate()) {
+            // valid surrogate pair
+            return 2;
+        }
+        if ((uc < 0x20 && uc != 0x09 && uc != 0x0A && uc != 0x0D) // control characters
+            || (uc >= 0x7F && uc <= 0x84) // control characters, valid but discouraged by XML
+            || (uc >= 0x86 && uc <= 0x9F) // control characters, valid but discouraged by XML
+            || (uc > 0xFFFD) // noncharacter
+            || ch.isSurrogate()) // single surrogate
+        {
+            return 0;
+        }
+        return 1;
+    }
+} // namespace
+
 /**
  * @param version KDBX version
  */
@@ -49,7 +110,27 @@ void KdbxXmlWriter::writeDatabase(QIODevice* device,
 
     generateIdMap();
 
-    m_xml.setDevice(device);
+    // cached fragments never contain protected values, so they are only used
+    // when those are encrypted with the inner random stream
+    m_useEntryCache = m_entryCache && m_randomStream && !m_innerStreamProtectionDisabled;
+    if (m_useEntryCache) {
+        const QString context = QString("%1:%2%3%4%5%6")
+                                    .arg(m_kdbxVersion)
+                                    .arg(m_meta->protectTitle())
+                                    .arg(m_meta->protectUsername())
+                                    .arg(m_meta->protectPassword())
+                                    .arg(m_meta->protectUrl())
+                                    .arg(m_meta->protectNotes());
+        m_entryCache->setContext(context.toLatin1());
+    }
+
+    // the XML writer and the entry cache produce many small writes, collect
+    // them so the cipher and compression streams get large blocks
+    BufferedWriteStream output(device);
+    output.open(QIODevice::WriteOnly);
+
+    m_device = &output;
+    m_xml.setDevice(&output);
     m_xml.writeStartDocument("1.0", true);
     m_xml.writeStartElement("KeePassFile");
 
@@ -59,9 +140,12 @@ void KdbxXmlWriter::writeDatabase(QIODevice* device,
     m_xml.writeEndElement();
     m_xml.writeEndDocument();
 
-    if (m_xml.hasError()) {
+    if (m_xml.hasError() || !output.reset()) {
         raiseError(device->errorString());
     }
+
+    m_xml.setDevice(nullptr);
+    m_device = nullptr;
 }
 
 void KdbxXmlWriter::writeDatabase(const QString& filename, Database* db)
@@ -71,6 +155,17 @@ void KdbxXmlWriter::writeDatabase(const QString& filename, Database* db)
     writeDatabase(&file, db);
 }
 
+/**
+ * Use a cache of serialized entries, so entries that have not been modified
+ * since the last write are not serialized again.
+ *
+ * @param cache entry cache kept between writes of the same database
+ */
+void KdbxXmlWriter::setEntryCache(KdbxXmlEntryCache* cache)
+{
+    m_entryCache = cache;
+}
+
 bool KdbxXmlWriter::hasError()
 {
     return m_error;
@@ -83,17 +178,24 @@ QString KdbxXmlWriter::errorString()
 
 void KdbxXmlWriter::generateIdMap()
 {
-    const QList<Entry*> allEntries = m_db->rootGroup()->entriesRecursive(true);
+    const QList<Entry*> allEntries = m_db->rootGroup()->entriesRecursive();
     int nextId = 0;
 
-    for (Entry* entry : allEntries) {
-        const QList<QString> attachmentKeys = entry->attachments()->keys();
-        for (const QString& key : attachmentKeys) {
-            QByteArray data = entry->attachments()->value(key);
-            if (!m_idMap.contains(data)) {
-                m_idMap.insert(data, nextId++);
+    auto addBinaries = [&](const QMap<QString, AttachmentStore::Blob>& attachments) {
+        for (const AttachmentStore::Blob& blob : attachments) {
+            const QByteArray digest = blob.digest();
+            if (!m_idMap.contains(digest)) {
+                m_idMap.insert(digest, nextId++);
+                m_binaries.append(blob);
             }
         }
+    };
+
+    for (Entry* entry : allEntries) {
+        addBinaries(EntrySnapshot(entry).attachments());
+        for (const EntrySnapshot& historyItem : entry->historySnapshots()) {
+            addBinaries(historyItem.attachments());
+        }
     }
 }
 
@@ -183,11 +285,16 @@ void KdbxXmlWriter::writeBinaries()
 {
     m_xml.writeStartElement("Binaries");
 
-    QHash<QByteArray, int>::const_iterator i;
-    for (i = m_idMap.constBegin(); i != m_idMap.constEnd(); ++i) {
+    for (int id = 0; id < m_binaries.size(); ++id) {
+        QByteArray binary;
+        if (!m_binaries.at(id).data(binary)) {
+            raiseError(tr("Failed to read attachment data."));
+            break;
+        }
+
         m_xml.writeStartElement("Binary");
 
-        m_xml.writeAttribute("ID", QString::number(i.value()));
+        m_xml.writeAttribute("ID", QString::number(id));
 
         QByteArray data;
         if (m_db->compressionAlgorithm() == Database::CompressionGZip) {
@@ -200,19 +307,19 @@ void KdbxXmlWriter::writeBinaries()
             compressor.setStreamFormat(QtIOCompressor::GzipFormat);
             compressor.open(QIODevice::WriteOnly);
 
-            qint64 bytesWritten = compressor.write(i.key());
-            Q_ASSERT(bytesWritten == i.key().size());
+            qint64 bytesWritten = compressor.write(binary);
+            Q_ASSERT(bytesWritten == binary.size());
             Q_UNUSED(bytesWritten);
             compressor.close();
 
             buffer.seek(0);
             data = buffer.readAll();
         } else {
-            data = i.key();
+            data = binary;
         }
 
         if (!data.isEmpty()) {
-            m_xml.writeCharacters(QString::fromLatin1(data.toBase64()));
+            m_xml.writeCharacters(base64Text(data.constData(), data.size()));
         }
         m_xml.writeEndElement();
     }
@@ -287,13 +394,19 @@ void KdbxXmlWriter::writeGroup(const Group* group)
 
     const QList<Entry*>& entryList = group->entries();
     for (const Entry* entry : entryList) {
-        writeEntry(entry);
+        if (m_useEntryCache) {
+            writeCachedEntry(entry);
+        } else {
+            writeEntry(entry);
+        }
     }
 
+    ++m_groupDepth;
     const QList<Group*>& children = group->children();
     for (const Group* child : children) {
         writeGroup(child);
     }
+    --m_groupDepth;
 
     m_xml.writeEndElement();
 }
@@ -368,25 +481,36 @@ void KdbxXmlWriter::writeEntry(const Entry* entry)
         writeString("Key", key);
 
         m_xml.writeStartElement("Value");
-        QString value;
 
         if (protect) {
             if (!m_innerStreamProtectionDisabled && m_randomStream) {
                 m_xml.writeAttribute("Protected", "True");
-                bool ok;
-                QByteArray rawData = m_randomStream->process(entry->attributes()->value(key).toUtf8(), &ok);
-                if (!ok) {
+                if (m_fragment) {
+                    // encrypted when the fragment is written to keep the order of the random stream
+                    if (!entry->attributes()->value(key).isEmpty()) {
+                        m_xml.writeCharacters(QString());
+                        m_fragment->placeholders.append(
+                            {static_cast<int>(m_xml.device()->pos()), m_historyIndex, key});
+                    }
+                    m_xml.writeEndElement();
+                    m_xml.writeEndElement();
+                    continue;
+                }
+                QByteArray rawData = entry->attributes()->value(key).toUtf8();
+                if (!m_randomStream->processInPlace(rawData)) {
                     raiseError(m_randomStream->errorString());
                 }
-                value = QString::fromLatin1(rawData.toBase64());
-            } else {
-                m_xml.writeAttribute("ProtectInMemory", "True");
-                value = entry->attributes()->value(key);
+                if (!rawData.isEmpty()) {
+                    m_xml.writeCharacters(base64Text(rawData.constData(), rawData.size()));
+                }
+                m_xml.writeEndElement();
+                m_xml.writeEndElement();
+                continue;
             }
-        } else {
-            value = entry->attributes()->value(key);
+            m_xml.writeAttribute("ProtectInMemory", "True");
         }
 
+        const QString value = entry->attributes()->value(key);
         if (!value.isEmpty()) {
             m_xml.writeCharacters(stripInvalidXml10Chars(value));
         }
@@ -401,8 +525,14 @@ void KdbxXmlWriter::writeEntry(const Entry* entry)
 
         writeString("Key", key);
 
+        const QByteArray digest = entry->attachments()->digest(key);
+        const int ref = m_idMap.value(digest);
+        if (m_fragment) {
+            m_fragment->binaryRefs.append(qMakePair(digest, ref));
+        }
+
         m_xml.writeStartElement("Value");
-        m_xml.writeAttribute("Ref", QString::number(m_idMap[entry->attachments()->value(key)]));
+        m_xml.writeAttribute("Ref", QString::number(ref));
         m_xml.writeEndElement();
 
         m_xml.writeEndElement();
@@ -448,14 +578,120 @@ void KdbxXmlWriter::writeAutoTypeAssoc(const AutoTypeAssociations::Association&
     m_xml.writeEndElement();
 }
 
+/**
+ * Write an entry from the entry cache, serializing it only if it is not
+ * cached or the cached fragment is out of date.
+ */
+void KdbxXmlWriter::writeCachedEntry(const Entry* entry)
+{
+    KdbxXmlEntryCache::Fragment fragment;
+    if (!m_entryCache->fragment(entry, fragment) || !isFragmentValid(entry, fragment)) {
+        fragment = recordEntry(entry);
+        m_entryCache->insert(entry, fragment);
+    } else {
+        // leave the XML writer in the same state as after writing the entry itself
+        QBuffer discard;
+        discard.open(QIODevice::WriteOnly);
+        m_xml.setDevice(&discard);
+        m_xml.writeStartElement("Entry");
+        m_xml.writeStartElement("History");
+        m_xml.writeEndElement();
+        m_xml.writeEndElement();
+        m_xml.setDevice(m_device);
+    }
+
+    writeFragment(entry, fragment);
+}
+
+/**
+ * Serialize an entry into a fragment for the entry cache.
+ * Protected values are left out and recorded as placeholders.
+ */
+KdbxXmlEntryCache::Fragment KdbxXmlWriter::recordEntry(const Entry* entry)
+{
+    KdbxXmlEntryCache::Fragment fragment;
+    fragment.timeInfo = entry->timeInfo();
+    fragment.depth = m_groupDepth;
+
+    QBuffer buffer(&fragment.xml);
+    buffer.open(QIODevice::WriteOnly);
+
+    m_fragment = &fragment;
+    m_xml.setDevice(&buffer);
+    writeEntry(entry);
+    m_xml.setDevice(m_device);
+    m_fragment = nullptr;
+
+    buffer.close();
+    return fragment;
+}
+
+bool KdbxXmlWriter::isFragmentValid(const Entry* entry, const KdbxXmlEntryCache::Fragment& fragment) const
+{
+    // the location change time is updated without signaling a modification
+    if (fragment.depth != m_groupDepth || fragment.timeInfo != entry->timeInfo()) {
+        return false;
+    }
+
+    for (const auto& binaryRef : fragment.binaryRefs) {
+        if (m_idMap.value(binaryRef.first, -1) != binaryRef.second) {
+            return false;
+        }
+    }
+
+    for (const auto& placeholder : fragment.placeholders) {
+        if (placeholder.historyIndex >= entry->historySnapshots().size()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void KdbxXmlWriter::writeFragment(const Entry* entry, const KdbxXmlEntryCache::Fragment& fragment)
+{
+    int pos = 0;
+    for (const auto& placeholder : fragment.placeholders) {
+        writeRaw(fragment.xml.constData() + pos, placeholder.offset - pos);
+        pos = placeholder.offset;
+
+        QString value;
+        if (placeholder.historyIndex >= 0) {
+            value = entry->historySnapshots().at(placeholder.historyIndex).attributeValue(placeholder.key);
+        } else {
+            value = entry->attributes()->value(placeholder.key);
+        }
+
+        QByteArray rawData = value.toUtf8();
+        if (!m_randomStream->processInPlace(rawData)) {
+            raiseError(m_randomStream->errorString());
+        }
+        m_base64Buffer.resize(base64Size(rawData.size()));
+        encodeBase64(rawData.constData(), rawData.size(), m_base64Buffer.data());
+        writeRaw(m_base64Buffer.constData(), m_base64Buffer.size());
+    }
+    writeRaw(fragment.xml.constData() + pos, fragment.xml.size() - pos);
+}
+
+void KdbxXmlWriter::writeRaw(const char* data, int size)
+{
+    if (size > 0 && m_device->write(data, size) != size) {
+        raiseError(m_device->errorString());
+    }
+}
+
 void KdbxXmlWriter::writeEntryHistory(const Entry* entry)
 {
     m_xml.writeStartElement("History");
 
-    const QList<Entry*>& historyItems = entry->historyItems();
-    for (const Entry* item : historyItems) {
-        writeEntry(item);
+    // history items are only turned into entries while they are written
+    const QList<EntrySnapshot>& historyItems = entry->historySnapshots();
+    for (int i = 0; i < historyItems.size(); ++i) {
+        m_historyIndex = i;
+        QScopedPointer<Entry> historyItem(historyItems.at(i).toEntry());
+        writeEntry(historyItem.data());
     }
+    m_historyIndex = -1;
 
     m_xml.writeEndElement();
 }
@@ -477,9 +713,9 @@ void KdbxXmlWriter::writeNumber(const QString& qualifiedName, int number)
 void KdbxXmlWriter::writeBool(const QString& qualifiedName, bool b)
 {
     if (b) {
-        writeString(qualifiedName, "True");
+        m_xml.writeTextElement(qualifiedName, QStringLiteral("True"));
     } else {
-        writeString(qualifiedName, "False");
+        m_xml.writeTextElement(qualifiedName, QStringLiteral("False"));
     }
 }
 
@@ -488,25 +724,31 @@ void KdbxXmlWriter::writeDateTime(const QString& qualifiedName, const QDateTime&
     Q_ASSERT(dateTime.isValid());
     Q_ASSERT(dateTime.timeSpec() == Qt::UTC);
 
-    QString dateTimeStr;
     if (m_kdbxVersion < KeePass2::FILE_VERSION_4) {
-        dateTimeStr = dateTime.toString(Qt::ISODate);
+        QString dateTimeStr = dateTime.toString(Qt::ISODate);
 
         // Qt < 4.8 doesn't append a 'Z' at the end
         if (!dateTimeStr.isEmpty() && dateTimeStr[dateTimeStr.size() - 1] != 'Z') {
             dateTimeStr.append('Z');
         }
+        writeString(qualifiedName, dateTimeStr);
     } else {
-        qint64 secs = QDateTime(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC).secsTo(dateTime);
-        QByteArray secsBytes = Endian::sizedIntToBytes(secs, KeePass2::BYTEORDER);
-        dateTimeStr = QString::fromLatin1(secsBytes.toBase64());
+        static const QDateTime epoch(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC);
+        char secsBytes[sizeof(qint64)];
+        qToLittleEndian<qint64>(epoch.secsTo(dateTime), secsBytes);
+        m_xml.writeTextElement(qualifiedName, base64Text(secsBytes, sizeof(secsBytes)));
     }
-    writeString(qualifiedName, dateTimeStr);
 }
 
 void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const QUuid& uuid)
 {
-    writeString(qualifiedName, uuid.toRfc4122().toBase64());
+    // RFC 4122 byte order, same as QUuid::toRfc4122()
+    char uuidBytes[16];
+    qToBigEndian<quint32>(uuid.data1, uuidBytes);
+    qToBigEndian<quint16>(uuid.data2, uuidBytes + 4);
+    qToBigEndian<quint16>(uuid.data3, uuidBytes + 6);
+    memcpy(uuidBytes + 8, uuid.data4, sizeof(uuid.data4));
+    m_xml.writeTextElement(qualifiedName, base64Text(uuidBytes, sizeof(uuidBytes)));
 }
 
 void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const Group* group)
@@ -529,7 +771,11 @@ void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const Entry* entry)
 
 void KdbxXmlWriter::writeBinary(const QString& qualifiedName, const QByteArray& ba)
 {
-    writeString(qualifiedName, QString::fromLatin1(ba.toBase64()));
+    if (ba.isEmpty()) {
+        m_xml.writeEmptyElement(qualifiedName);
+    } else {
+        m_xml.writeTextElement(qualifiedName, base64Text(ba.constData(), ba.size()));
+    }
 }
 
 void KdbxXmlWriter::writeTriState(const QString& qualifiedName, Group::TriState triState)
@@ -557,28 +803,46 @@ QString KdbxXmlWriter::colorPartToString(int value)
     return str;
 }
 
-QString KdbxXmlWriter::stripInvalidXml10Chars(QString str)
+/**
+ * Encode data as base64 into a buffer that is reused between calls.
+ * The result is only valid until the next call.
+ */
+const QString& KdbxXmlWriter::base64Text(const char* data, int size)
 {
-    for (int i = str.size() - 1; i >= 0; i--) {
-        const QChar ch = str.at(i);
-        const ushort uc = ch.unicode();
+    m_textBuffer.resize(base64Size(size));
+    encodeBase64(data, size, reinterpret_cast<ushort*>(m_textBuffer.data()));
+    return m_textBuffer;
+}
 
-        if (ch.isLowSurrogate() && i != 0 && str.at(i - 1).isHighSurrogate()) {
-            // keep valid surrogate pair
-            i--;
-        } else if ((uc < 0x20 && uc != 0x09 && uc != 0x0A && uc != 0x0D) // control characters
-                   || (uc >= 0x7F && uc <= 0x84) // control characters, valid but discouraged by XML
-                   || (uc >= 0x86 && uc <= 0x9F) // control characters, valid but discouraged by XML
-                   || (uc > 0xFFFD) // noncharacter
-                   || ch.isLowSurrogate() // single low surrogate
-                   || ch.isHighSurrogate()) // single high surrogate
-        {
-            qWarning("Stripping invalid XML 1.0 codepoint %x", uc);
-            str.remove(i, 1);
+QString KdbxXmlWriter::stripInvalidXml10Chars(const QString& str)
+{
+    const int size = str.size();
+    int i = 0;
+    int length;
+    while (i < size && (length = xml10CharLength(str, i)) > 0) {
+        i += length;
+    }
+
+    // nearly all strings are valid and are returned without a copy
+    if (i == size) {
+        return str;
+    }
+
+    QString stripped;
+    stripped.reserve(size - 1);
+    stripped.append(str.constData(), i);
+    while (i < size) {
+        length = xml10CharLength(str, i);
+        if (length == 0) {
+            qWarning("Stripping invalid XML 1.0 codepoint %x", str.at(i).unicode());
+            ++i;
+        } else {
+            stripped.append(str.constData() + i, length);
+            i += length;
         }
     }
 
-    return str;
+    return stripped;
 }
 
 void KdbxXmlWriter::raiseError(const QString& errorMessage)
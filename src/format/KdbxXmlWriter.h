@@ -18,6 +18,7 @@
 #ifndef KEEPASSX_KDBXXMLWRITER_H
 #define KEEPASSX_KDBXXMLWRITER_H
 
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QImage>
 #include <QXmlStreamWriter>
@@ -26,12 +27,15 @@
 #include "core/Entry.h"
 #include "core/Group.h"
 #include "core/TimeInfo.h"
+#include "format/KdbxXmlEntryCache.h"
 
 class KeePass2RandomStream;
 class Metadata;
 
 class KdbxXmlWriter
 {
+    Q_DECLARE_TR_FUNCTIONS(KdbxXmlWriter)
+
 public:
     explicit KdbxXmlWriter(quint32 version);
 
@@ -40,6 +44,7 @@ public:
                        KeePass2RandomStream* randomStream = nullptr,
                        const QByteArray& headerHash = QByteArray());
     void writeDatabase(const QString& filename, Database* db);
+    void setEntryCache(KdbxXmlEntryCache* cache);
     void disableInnerStreamProtection(bool disable);
     bool innerStreamProtectionDisabled() const;
     bool hasError();
@@ -61,6 +66,11 @@ private:
     void writeDeletedObjects();
     void writeDeletedObject(const DeletedObject& delObj);
     void writeEntry(const Entry* entry);
+    void writeCachedEntry(const Entry* entry);
+    KdbxXmlEntryCache::Fragment recordEntry(const Entry* entry);
+    bool isFragmentValid(const Entry* entry, const KdbxXmlEntryCache::Fragment& fragment) const;
+    void writeFragment(const Entry* entry, const KdbxXmlEntryCache::Fragment& fragment);
+    void writeRaw(const char* data, int size);
     void writeAutoType(const Entry* entry);
     void writeAutoTypeAssoc(const AutoTypeAssociations::Association& assoc);
     void writeEntryHistory(const Entry* entry);
@@ -75,7 +85,8 @@ private:
     void writeBinary(const QString& qualifiedName, const QByteArray& ba);
     void writeTriState(const QString& qualifiedName, Group::TriState triState);
     QString colorPartToString(int value);
-    QString stripInvalidXml10Chars(QString str);
+    const QString& base64Text(const char* data, int size);
+    QString stripInvalidXml10Chars(const QString& str);
 
     void raiseError(const QString& errorMessage);
 
@@ -84,12 +95,23 @@ private:
     bool m_innerStreamProtectionDisabled = false;
 
     QXmlStreamWriter m_xml;
+    QIODevice* m_device = nullptr;
     QPointer<const Database> m_db;
     QPointer<const Metadata> m_meta;
     KeePass2RandomStream* m_randomStream = nullptr;
     QHash<QByteArray, int> m_idMap;
+    QList<AttachmentStore::Blob> m_binaries;
     QByteArray m_headerHash;
 
+    KdbxXmlEntryCache* m_entryCache = nullptr;
+    bool m_useEntryCache = false;
+    KdbxXmlEntryCache::Fragment* m_fragment = nullptr;
+    int m_groupDepth = 0;
+    int m_historyIndex = -1;
+
+    QString m_textBuffer;
+    QByteArray m_base64Buffer;
+
     bool m_error = false;
 
     QString m_errorStr = "";
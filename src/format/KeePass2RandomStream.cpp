@@ -20,6 +20,20 @@
 #include "crypto/CryptoHash.h"
 #include "format/KeePass2.h"
 
+namespace
+{
+    // number of cipher blocks of keystream generated at once
+    const int BufferBlocks = 64;
+
+    void xorKeystream(char* data, const char* keystream, int size)
+    {
+        // plain loop on raw pointers, which the compiler vectorizes
+        for (int i = 0; i < size; ++i) {
+            data[i] ^= keystream[i];
+        }
+    }
+} // namespace
+
 KeePass2RandomStream::KeePass2RandomStream(KeePass2::ProtectedStreamAlgo algo)
     : m_cipher(mapAlgo(algo), SymmetricCipher::Stream, SymmetricCipher::Encrypt)
     , m_offset(0)
@@ -44,59 +58,44 @@ bool KeePass2RandomStream::init(const QByteArray& key)
 
 QByteArray KeePass2RandomStream::randomBytes(int size, bool* ok)
 {
-    QByteArray result;
-
-    int bytesRemaining = size;
-
-    while (bytesRemaining > 0) {
-        if (m_buffer.size() == m_offset) {
-            if (!loadBlock()) {
-                *ok = false;
-                return QByteArray();
-            }
-        }
-
-        int bytesToCopy = qMin(bytesRemaining, m_buffer.size() - m_offset);
-        result.append(m_buffer.mid(m_offset, bytesToCopy));
-        m_offset += bytesToCopy;
-        bytesRemaining -= bytesToCopy;
+    QByteArray result(size, '\0');
+    *ok = processInPlace(result);
+    if (!*ok) {
+        return QByteArray();
     }
-
-    *ok = true;
     return result;
 }
 
 QByteArray KeePass2RandomStream::process(const QByteArray& data, bool* ok)
 {
-    bool randomBytesOk;
-
-    QByteArray randomData = randomBytes(data.size(), &randomBytesOk);
-    if (!randomBytesOk) {
-        *ok = false;
+    QByteArray result = data;
+    *ok = processInPlace(result);
+    if (!*ok) {
         return QByteArray();
     }
-
-    QByteArray result;
-    result.resize(data.size());
-
-    for (int i = 0; i < data.size(); i++) {
-        result[i] = data[i] ^ randomData[i];
-    }
-
-    *ok = true;
     return result;
 }
 
+/**
+ * XOR data with the next bytes of the keystream. The keystream is generated
+ * in large chunks, so values consume it in the same order no matter how
+ * they are split into calls.
+ */
 bool KeePass2RandomStream::processInPlace(QByteArray& data)
 {
-    bool ok;
-    QByteArray randomData = randomBytes(data.size(), &ok);
-    if (!ok) {
-        return false;
-    }
+    const int size = data.size();
+    char* out = data.data();
+    int processed = 0;
+
+    while (processed < size) {
+        if (m_buffer.size() == m_offset && !loadBlock()) {
+            return false;
+        }
 
-    for (int i = 0; i < data.size(); i++) {
-        data[i] = data[i] ^ randomData[i];
+        int bytesToProcess = qMin(size - processed, m_buffer.size() - m_offset);
+        xorKeystream(out + processed, m_buffer.constData() + m_offset, bytesToProcess);
+        m_offset += bytesToProcess;
+        processed += bytesToProcess;
     }
 
     return true;
@@ -111,7 +110,7 @@ bool KeePass2RandomStream::loadBlock()
 {
     Q_ASSERT(m_offset == m_buffer.size());
 
-    m_buffer.fill('\0', m_cipher.blockSize());
+    m_buffer.fill('\0', m_cipher.blockSize() * BufferBlocks);
     if (!m_cipher.processInPlace(m_buffer)) {
         return false;
     }
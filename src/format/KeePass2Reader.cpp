@@ -95,6 +95,8 @@ bool KeePass2Reader::readDatabase(QIODevice* device, QSharedPointer<const Compos
     } else {
         m_reader.reset(new Kdbx4Reader());
     }
+    m_reader->setPipelined(m_pipelined);
+    m_reader->setSnapshotCache(m_snapshotCache, m_snapshotFilePath);
 
     return m_reader->readDatabase(device, std::move(key), db);
 }
@@ -117,6 +119,31 @@ quint32 KeePass2Reader::version() const
     return m_version;
 }
 
+/**
+ * Decode the database payload in parallel pipeline stages.
+ * This is only supported by KDBX 4 files and ignored otherwise.
+ *
+ * @param pipelined true to enable the pipelined load mode
+ */
+void KeePass2Reader::setPipelined(bool pipelined)
+{
+    m_pipelined = pipelined;
+}
+
+/**
+ * Use a cache of decrypted database snapshots to unlock files that have
+ * not changed since they were last read without parsing them again.
+ * This is only supported by KDBX 4 files and ignored otherwise.
+ *
+ * @param cache snapshot cache or nullptr to disable it
+ * @param filePath path of the database file that is read
+ */
+void KeePass2Reader::setSnapshotCache(KdbxSnapshotCache* cache, const QString& filePath)
+{
+    m_snapshotCache = cache;
+    m_snapshotFilePath = filePath;
+}
+
 /**
  * @return KDBX reader used for reading the input file
  */
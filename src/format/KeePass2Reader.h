@@ -44,6 +44,9 @@ public:
     QSharedPointer<KdbxReader> reader() const;
     quint32 version() const;
 
+    void setPipelined(bool pipelined);
+    void setSnapshotCache(KdbxSnapshotCache* cache, const QString& filePath);
+
 private:
     void raiseError(const QString& errorMessage);
 
@@ -52,6 +55,9 @@ private:
 
     QSharedPointer<KdbxReader> m_reader;
     quint32 m_version = 0;
+    bool m_pipelined = false;
+    KdbxSnapshotCache* m_snapshotCache = nullptr;
+    QString m_snapshotFilePath;
 };
 
 #endif // KEEPASSX_KEEPASS2READER_H
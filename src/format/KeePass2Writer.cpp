@@ -66,8 +66,8 @@ bool KeePass2Writer::implicitUpgradeNeeded(Database const* db) const
                 return true;
             }
 
-            for (const auto& historyItem : entry->historyItems()) {
-                if (historyItem->customData() && !historyItem->customData()->isEmpty()) {
+            for (const auto& historyItem : entry->historySnapshots()) {
+                if (historyItem.hasCustomData()) {
                     return true;
                 }
             }
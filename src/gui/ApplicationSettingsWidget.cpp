@@ -26,6 +26,7 @@
 #include "core/Config.h"
 #include "core/Global.h"
 #include "core/Translator.h"
+#include "format/KdbxSnapshotCache.h"
 #include "gui/Icons.h"
 #include "gui/MainWindow.h"
 #include "gui/osutils/OSUtils.h"
@@ -286,6 +287,9 @@ void ApplicationSettingsWidget::loadSettings()
     m_secUi->hideNotesCheckBox->setChecked(config()->get(Config::Security_HideNotes).toBool());
     m_secUi->NoConfirmMoveEntryToRecycleBinCheckBox->setChecked(
         config()->get(Config::Security_NoConfirmMoveEntryToRecycleBin).toBool());
+    m_secUi->precomputeTransformedKeyCheckBox->setChecked(
+        config()->get(Config::Security_PrecomputeTransformedKey).toBool());
+    m_secUi->unlockCacheCheckBox->setChecked(config()->get(Config::Security_UnlockCache).toBool());
 
     m_secUi->touchIDResetCheckBox->setChecked(config()->get(Config::Security_ResetTouchId).toBool());
     m_secUi->touchIDResetSpinBox->setValue(config()->get(Config::Security_ResetTouchIdTimeout).toInt());
@@ -387,6 +391,11 @@ void ApplicationSettingsWidget::saveSettings()
     config()->set(Config::Security_HideNotes, m_secUi->hideNotesCheckBox->isChecked());
     config()->set(Config::Security_NoConfirmMoveEntryToRecycleBin,
                   m_secUi->NoConfirmMoveEntryToRecycleBinCheckBox->isChecked());
+    config()->set(Config::Security_PrecomputeTransformedKey, m_secUi->precomputeTransformedKeyCheckBox->isChecked());
+    config()->set(Config::Security_UnlockCache, m_secUi->unlockCacheCheckBox->isChecked());
+    if (!m_secUi->unlockCacheCheckBox->isChecked()) {
+        KdbxSnapshotCache::instance()->clear();
+    }
 
     config()->set(Config::Security_ResetTouchId, m_secUi->touchIDResetCheckBox->isChecked());
     config()->set(Config::Security_ResetTouchIdTimeout, m_secUi->touchIDResetSpinBox->value());
@@ -201,6 +201,7 @@ void DatabaseOpenWidget::openDatabase()
     QCoreApplication::processEvents();
 
     m_db.reset(new Database());
+    m_db->setUnlockCacheEnabled(config()->get(Config::Security_UnlockCache).toBool());
     QString error;
 
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
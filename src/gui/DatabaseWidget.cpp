@@ -22,6 +22,7 @@
 #include <QApplication>
 #include <QCheckBox>
 #include <QDesktopServices>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QHBoxLayout>
 #include <QHeaderView>
@@ -36,6 +37,7 @@
 #include "autotype/AutoType.h"
 #include "core/Config.h"
 #include "core/Database.h"
+#include "core/EntrySearchIndex.h"
 #include "core/EntrySearcher.h"
 #include "core/FileWatcher.h"
 #include "core/Group.h"
@@ -43,6 +45,7 @@
 #include "core/Metadata.h"
 #include "core/Resources.h"
 #include "core/Tools.h"
+#include "format/KdbxSnapshotCache.h"
 #include "format/KeePass2Reader.h"
 #include "gui/Clipboard.h"
 #include "gui/CloneDialog.h"
@@ -78,6 +81,14 @@
 #include "sshagent/SSHAgent.h"
 #endif
 
+namespace
+{
+    // a search runs in slices of this many milliseconds so the UI stays responsive
+    const int SearchSliceTime = 10;
+    // entries searched between checks of the slice time, enough for the searcher to use several threads
+    const int SearchBatchSize = 1024;
+} // namespace
+
 DatabaseWidget::DatabaseWidget(QSharedPointer<Database> db, QWidget* parent)
     : QStackedWidget(parent)
     , m_db(std::move(db))
@@ -208,11 +219,14 @@ DatabaseWidget::DatabaseWidget(QSharedPointer<Database> db, QWidget* parent)
     // clang-format on
 
     connectDatabaseSignals();
+    m_db->setKeyPrecomputationEnabled(config()->get(Config::Security_PrecomputeTransformedKey).toBool());
 
     m_blockAutoSave = false;
 
     m_EntrySearcher = new EntrySearcher(false);
     m_searchLimitGroup = config()->get(Config::SearchLimitGroup).toBool();
+    m_searchTimer.setInterval(0);
+    connect(&m_searchTimer, SIGNAL(timeout()), SLOT(continueSearch()));
 
 #ifdef WITH_XC_KEESHARE
     // We need to reregister the database to allow exports
@@ -386,8 +400,17 @@ void DatabaseWidget::replaceDatabase(QSharedPointer<Database> db)
     auto oldDb = m_db;
     m_db = std::move(db);
     connectDatabaseSignals();
+    m_db->setKeyPrecomputationEnabled(config()->get(Config::Security_PrecomputeTransformedKey).toBool());
     m_groupView->changeDatabase(m_db);
 
+    // Build the search index once the new view is shown instead of on the first search
+    QPointer<Database> indexedDb = m_db.data();
+    QTimer::singleShot(0, this, [indexedDb] {
+        if (indexedDb && indexedDb->isInitialized()) {
+            indexedDb->searchIndex()->build(indexedDb->rootGroup());
+        }
+    });
+
     // Restore the new parent group pointer, if not found default to the root group
     // this prevents data loss when merging a database while creating a new entry
     if (!newParentUuid.isNull()) {
@@ -1064,6 +1087,7 @@ void DatabaseWidget::connectDatabaseSignals()
     connect(m_db.data(), SIGNAL(databaseModified()), SIGNAL(databaseModified()));
     connect(m_db.data(), SIGNAL(databaseModified()), SLOT(onDatabaseModified()));
     connect(m_db.data(), SIGNAL(databaseSaved()), SIGNAL(databaseSaved()));
+    connect(m_db.data(), SIGNAL(backgroundSaveFinished(bool, QString)), SLOT(onBackgroundSaveFinished(bool, QString)));
     connect(m_db.data(), SIGNAL(databaseFileChanged()), this, SLOT(reloadDatabaseFile()));
 }
 
@@ -1354,17 +1378,21 @@ void DatabaseWidget::search(const QString& searchtext)
 
     Group* searchGroup = m_searchLimitGroup ? currentGroup() : m_db->rootGroup();
 
-    QList<Entry*> searchResult = m_EntrySearcher->search(searchtext, searchGroup);
+    // Supersedes a search that is still running. Entries are remembered by uuid
+    // so the ones deleted before their turn are skipped.
+    const QList<Entry*> candidates = m_EntrySearcher->prepare(searchtext, searchGroup);
+    m_searchCandidates.clear();
+    m_searchCandidates.reserve(candidates.size());
+    for (const Entry* entry : candidates) {
+        m_searchCandidates.append(entry->uuid());
+    }
+    m_searchPosition = 0;
+    m_searchResultCount = 0;
 
-    m_entryView->displaySearch(searchResult);
+    // The first results are shown right away, the rest follows while the event loop is idle
+    m_entryView->displaySearch(searchNextSlice());
     m_lastSearchText = searchtext;
-
-    // Display a label detailing our search results
-    if (!searchResult.isEmpty()) {
-        m_searchingLabel->setText(tr("Search Results (%1)").arg(searchResult.size()));
-    } else {
-        m_searchingLabel->setText(tr("No Results"));
-    }
+    updateSearchProgress();
 
     m_searchingLabel->setVisible(true);
 #ifdef WITH_XC_KEESHARE
@@ -1374,6 +1402,57 @@ void DatabaseWidget::search(const QString& searchtext)
     emit searchModeActivated();
 }
 
+void DatabaseWidget::continueSearch()
+{
+    m_entryView->appendSearchResults(searchNextSlice());
+    updateSearchProgress();
+}
+
+/**
+ * Search the next pending entries until the time of a slice is used up.
+ */
+QList<Entry*> DatabaseWidget::searchNextSlice()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<Entry*> results;
+    do {
+        QList<Entry*> batch;
+        int end = qMin(m_searchPosition + SearchBatchSize, m_searchCandidates.size());
+        for (; m_searchPosition < end; ++m_searchPosition) {
+            Entry* entry = m_db->rootGroup()->findEntryByUuid(m_searchCandidates.at(m_searchPosition));
+            if (entry) {
+                batch.append(entry);
+            }
+        }
+        results.append(m_EntrySearcher->repeatEntries(batch));
+    } while (m_searchPosition < m_searchCandidates.size() && !timer.hasExpired(SearchSliceTime));
+
+    m_searchResultCount += results.size();
+    return results;
+}
+
+void DatabaseWidget::updateSearchProgress()
+{
+    bool finished = m_searchPosition >= m_searchCandidates.size();
+    if (finished) {
+        m_searchTimer.stop();
+        m_searchCandidates.clear();
+    } else {
+        m_searchTimer.start();
+    }
+
+    // Display a label detailing our search results
+    if (m_searchResultCount > 0) {
+        m_searchingLabel->setText(tr("Search Results (%1)").arg(m_searchResultCount));
+    } else if (finished) {
+        m_searchingLabel->setText(tr("No Results"));
+    } else {
+        m_searchingLabel->setText(tr("Searching..."));
+    }
+}
+
 void DatabaseWidget::setSearchCaseSensitive(bool state)
 {
     m_EntrySearcher->setCaseSensitive(state);
@@ -1415,13 +1494,59 @@ void DatabaseWidget::onGroupChanged()
 void DatabaseWidget::onDatabaseModified()
 {
     if (!m_blockAutoSave && config()->get(Config::AutoSaveAfterEveryChange).toBool() && !m_db->isReadOnly()) {
-        save();
+        autoSave();
     } else {
         // Only block once, then reset
         m_blockAutoSave = false;
     }
 }
 
+/**
+ * Save the database after a change without interrupting the user.
+ * The database is written in the background if it already has a file.
+ */
+void DatabaseWidget::autoSave()
+{
+    if (isLocked() || m_db->filePath().isEmpty()) {
+        save();
+        return;
+    }
+
+    // A running save picks up further changes once it is finished
+    if (m_db->isSaving()) {
+        return;
+    }
+
+    ++m_saveAttempts;
+
+    QString errorMessage;
+    m_db->setDeletedObjectsMaxAge(config()->get(Config::DeletedObjectsMaxAge).toInt());
+    if (!m_db->saveInBackground(&errorMessage,
+                                config()->get(Config::UseAtomicSaves).toBool(),
+                                config()->get(Config::BackupBeforeSave).toBool())) {
+        onBackgroundSaveFinished(false, errorMessage);
+    }
+}
+
+void DatabaseWidget::onBackgroundSaveFinished(bool success, const QString& error)
+{
+    if (success) {
+        m_saveAttempts = 0;
+        return;
+    }
+
+    // The database does not retry by itself, the next change or a manual save does
+    if (askToDisableSafeSaves()) {
+        autoSave();
+        return;
+    }
+
+    showMessage(tr("Writing the database failed: %1").arg(error),
+                MessageWidget::Error,
+                true,
+                MessageWidget::LongAutoHideTimeout);
+}
+
 QString DatabaseWidget::getCurrentSearch()
 {
     return m_lastSearchText;
@@ -1429,6 +1554,9 @@ QString DatabaseWidget::getCurrentSearch()
 
 void DatabaseWidget::endSearch()
 {
+    m_searchTimer.stop();
+    m_searchCandidates.clear();
+
     if (isSearchActive()) {
         // Show the normal entry view of the current group
         emit listModeAboutToActivate();
@@ -1485,6 +1613,9 @@ void DatabaseWidget::closeEvent(QCloseEvent* event)
         return;
     }
 
+    // Unlike locking, closing the database releases the snapshot kept for unlocking it again
+    KdbxSnapshotCache::instance()->remove(m_db->filePath());
+
     event->accept();
 }
 
@@ -1846,6 +1977,25 @@ bool DatabaseWidget::save()
         return true;
     }
 
+    if (askToDisableSafeSaves()) {
+        return save();
+    }
+
+    showMessage(tr("Writing the database failed: %1").arg(errorMessage),
+                MessageWidget::Error,
+                true,
+                MessageWidget::LongAutoHideTimeout);
+
+    return false;
+}
+
+/**
+ * Ask to disable safe saves once saving has failed three times in a row.
+ *
+ * @return true if safe saves were disabled and saving should be tried again
+ */
+bool DatabaseWidget::askToDisableSafeSaves()
+{
     if (m_saveAttempts > 2 && config()->get(Config::UseAtomicSaves).toBool()) {
         // Saving failed 3 times, issue a warning and attempt to resolve
         auto result = MessageBox::question(this,
@@ -1857,15 +2007,9 @@ bool DatabaseWidget::save()
                                            MessageBox::Disable);
         if (result == MessageBox::Disable) {
             config()->set(Config::UseAtomicSaves, false);
-            return save();
+            return true;
         }
     }
-
-    showMessage(tr("Writing the database failed: %1").arg(errorMessage),
-                MessageWidget::Error,
-                true,
-                MessageWidget::LongAutoHideTimeout);
-
     return false;
 }
 
@@ -1915,6 +2059,7 @@ bool DatabaseWidget::performSave(QString& errorMessage, const QString& fileName)
     m_groupView->setDisabled(true);
     QApplication::processEvents();
 
+    m_db->setDeletedObjectsMaxAge(config()->get(Config::DeletedObjectsMaxAge).toInt());
     bool ok;
     if (fileName.isEmpty()) {
         ok = m_db->save(&errorMessage,
@@ -240,11 +240,13 @@ private slots:
     void onEntryChanged(Entry* entry);
     void onGroupChanged();
     void onDatabaseModified();
+    void onBackgroundSaveFinished(bool success, const QString& error);
     void connectDatabaseSignals();
     void loadDatabase(bool accepted);
     void unlockDatabase(bool accepted);
     void mergeDatabase(bool accepted);
     void emitCurrentModeChanged();
+    void continueSearch();
     // Database autoreload slots
     void reloadDatabaseFile();
     void restoreGroupEntryFocus(const QUuid& groupUuid, const QUuid& EntryUuid);
@@ -257,7 +259,11 @@ private:
     bool confirmDeleteEntries(QList<Entry*> entries, bool permanent);
     void performIconDownloads(const QList<Entry*>& entries, bool force = false);
     bool performSave(QString& errorMessage, const QString& fileName = {});
+    void autoSave();
+    bool askToDisableSafeSaves();
     Entry* currentSelectedEntry();
+    QList<Entry*> searchNextSlice();
+    void updateSearchProgress();
 
     QSharedPointer<Database> m_db;
 
@@ -293,6 +299,10 @@ private:
     EntrySearcher* m_EntrySearcher;
     QString m_lastSearchText;
     bool m_searchLimitGroup;
+    QTimer m_searchTimer;
+    QList<QUuid> m_searchCandidates;
+    int m_searchPosition = 0;
+    int m_searchResultCount = 0;
 
     // Autoreload
     bool m_blockAutoSave;
@@ -87,29 +87,27 @@ void EntryModel::setEntries(const QList<Entry*>& entries)
     m_entries = entries;
     m_orgEntries = entries;
 
-    QSet<Database*> databases;
-
-    for (Entry* entry : asConst(m_entries)) {
-        databases.insert(entry->group()->database());
-    }
-
-    for (Database* db : asConst(databases)) {
-        Q_ASSERT(db);
-        const QList<Group*> groupList = db->rootGroup()->groupsRecursive(true);
-        for (const Group* group : groupList) {
-            m_allGroups.append(group);
-        }
+    connectDatabases(entries);
 
-        if (db->metadata()->recycleBin()) {
-            m_allGroups.removeOne(db->metadata()->recycleBin());
-        }
-    }
+    endResetModel();
+}
 
-    for (const Group* group : asConst(m_allGroups)) {
-        makeConnections(group);
+/**
+ * Add entries to a list set with setEntries(), used to show search
+ * results as they are found.
+ */
+void EntryModel::appendEntries(const QList<Entry*>& entries)
+{
+    Q_ASSERT(!m_group);
+    if (entries.isEmpty()) {
+        return;
     }
 
-    endResetModel();
+    beginInsertRows(QModelIndex(), m_entries.size(), m_entries.size() + entries.size() - 1);
+    m_entries.append(entries);
+    m_orgEntries.append(entries);
+    connectDatabases(entries);
+    endInsertRows();
 }
 
 int EntryModel::rowCount(const QModelIndex& parent) const
@@ -564,6 +562,30 @@ void EntryModel::severConnections()
     }
 }
 
+void EntryModel::connectDatabases(const QList<Entry*>& entries)
+{
+    QSet<Database*> databases;
+
+    for (Entry* entry : entries) {
+        databases.insert(entry->group()->database());
+    }
+
+    for (Database* db : asConst(databases)) {
+        Q_ASSERT(db);
+        if (m_allGroups.contains(db->rootGroup())) {
+            continue;
+        }
+
+        const QList<Group*> groupList = db->rootGroup()->groupsRecursive(true);
+        for (const Group* group : groupList) {
+            if (group != db->metadata()->recycleBin()) {
+                m_allGroups.append(group);
+                makeConnections(group);
+            }
+        }
+    }
+}
+
 void EntryModel::makeConnections(const Group* group)
 {
     connect(group, SIGNAL(entryAboutToAdd(Entry*)), SLOT(entryAboutToAdd(Entry*)));
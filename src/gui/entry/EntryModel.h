@@ -65,6 +65,7 @@ public:
 
     void setGroup(Group* group);
     void setEntries(const QList<Entry*>& entries);
+    void appendEntries(const QList<Entry*>& entries);
 
 private slots:
     void entryAboutToAdd(Entry* entry);
@@ -81,6 +82,7 @@ private slots:
 
 private:
     void severConnections();
+    void connectDatabases(const QList<Entry*>& entries);
     void makeConnections(const Group* group);
 
     Group* m_group;
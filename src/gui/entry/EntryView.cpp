@@ -202,6 +202,15 @@ void EntryView::displaySearch(const QList<Entry*>& entries)
     m_inSearchMode = true;
 }
 
+void EntryView::appendSearchResults(const QList<Entry*>& entries)
+{
+    bool wasEmpty = m_model->rowCount() == 0;
+    m_model->appendEntries(entries);
+    if (wasEmpty && !entries.isEmpty()) {
+        setFirstEntryActive();
+    }
+}
+
 void EntryView::setFirstEntryActive()
 {
     if (m_model->rowCount() > 0) {
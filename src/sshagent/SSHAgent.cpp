@@ -453,7 +453,8 @@ void SSHAgent::databaseUnlocked(QSharedPointer<Database> db)
         return;
     }
 
-    for (Entry* e : db->rootGroup()->entriesRecursive()) {
+    const QList<Entry*> entries = db->rootGroup()->entriesRecursive();
+    for (Entry* e : entries) {
         if (db->metadata()->recycleBinEnabled() && e->group() == db->metadata()->recycleBin()) {
             continue;
         }
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BufferedWriteStream.h"
+
+const int BufferedWriteStream::DefaultBufferSize = 64 * 1024;
+
+BufferedWriteStream::BufferedWriteStream(QIODevice* baseDevice)
+    : BufferedWriteStream(baseDevice, DefaultBufferSize)
+{
+}
+
+BufferedWriteStream::BufferedWriteStream(QIODevice* baseDevice, int bufferSize)
+    : LayeredStream(baseDevice)
+    , m_bufferSize(bufferSize)
+    , m_error(false)
+{
+    Q_ASSERT(bufferSize > 0);
+}
+
+BufferedWriteStream::~BufferedWriteStream()
+{
+    close();
+}
+
+bool BufferedWriteStream::open(QIODevice::OpenMode mode)
+{
+    if (mode & QIODevice::ReadOnly) {
+        qWarning("BufferedWriteStream::open: Only writing is supported.");
+        return false;
+    }
+
+    m_buffer.clear();
+    m_buffer.reserve(m_bufferSize);
+    m_error = false;
+
+    return LayeredStream::open(mode);
+}
+
+/**
+ * Write the buffered data to the base device.
+ *
+ * @return false if writing failed now or earlier
+ */
+bool BufferedWriteStream::reset()
+{
+    if (!isWritable()) {
+        return false;
+    }
+
+    return writeBuffer() && !m_error;
+}
+
+void BufferedWriteStream::close()
+{
+    if (isWritable()) {
+        writeBuffer();
+    }
+
+    LayeredStream::close();
+}
+
+qint64 BufferedWriteStream::readData(char* data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+qint64 BufferedWriteStream::writeData(const char* data, qint64 maxSize)
+{
+    Q_ASSERT(maxSize >= 0);
+
+    if (m_error) {
+        return -1;
+    }
+
+    if (m_buffer.size() + maxSize > m_bufferSize) {
+        if (!writeBuffer()) {
+            return -1;
+        }
+
+        if (maxSize >= m_bufferSize) {
+            if (m_baseDevice->write(data, maxSize) != maxSize) {
+                m_error = true;
+                setErrorString(m_baseDevice->errorString());
+                return -1;
+            }
+            return maxSize;
+        }
+    }
+
+    m_buffer.append(data, static_cast<int>(maxSize));
+    return maxSize;
+}
+
+bool BufferedWriteStream::writeBuffer()
+{
+    if (m_error) {
+        return false;
+    }
+
+    if (!m_buffer.isEmpty()) {
+        if (m_baseDevice->write(m_buffer) != m_buffer.size()) {
+            m_error = true;
+            setErrorString(m_baseDevice->errorString());
+            return false;
+        }
+        // keeps the reserved capacity
+        m_buffer.truncate(0);
+    }
+
+    return true;
+}
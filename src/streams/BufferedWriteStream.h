@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_BUFFEREDWRITESTREAM_H
+#define KEEPASSX_BUFFEREDWRITESTREAM_H
+
+#include "streams/LayeredStream.h"
+
+/**
+ * Write-only stream that collects small writes and passes them on to the
+ * base device in large contiguous blocks. Writes that are larger than the
+ * buffer bypass it. Calling reset() or close() writes the buffered data.
+ */
+class BufferedWriteStream : public LayeredStream
+{
+    Q_OBJECT
+
+public:
+    explicit BufferedWriteStream(QIODevice* baseDevice);
+    BufferedWriteStream(QIODevice* baseDevice, int bufferSize);
+    ~BufferedWriteStream() override;
+
+    bool open(QIODevice::OpenMode mode) override;
+    bool reset() override;
+    void close() override;
+
+    static const int DefaultBufferSize;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    bool writeBuffer();
+
+    const int m_bufferSize;
+    QByteArray m_buffer;
+    bool m_error;
+};
+
+#endif // KEEPASSX_BUFFEREDWRITESTREAM_H
@@ -17,9 +17,12 @@
 
 #include "HmacBlockStream.h"
 
+#include <QBuffer>
+#include <QtConcurrent>
 #include <utility>
 
 #include "core/Endian.h"
+#include "core/Global.h"
 #include "crypto/CryptoHash.h"
 
 const QSysInfo::Endian HmacBlockStream::ByteOrder = QSysInfo::LittleEndian;
@@ -28,6 +31,7 @@ HmacBlockStream::HmacBlockStream(QIODevice* baseDevice, QByteArray key)
     : LayeredStream(baseDevice)
     , m_blockSize(1024 * 1024)
     , m_key(std::move(key))
+    , m_readAhead(0)
 {
     init();
 }
@@ -36,6 +40,7 @@ HmacBlockStream::HmacBlockStream(QIODevice* baseDevice, QByteArray key, qint32 b
     : LayeredStream(baseDevice)
     , m_blockSize(blockSize)
     , m_key(std::move(key))
+    , m_readAhead(0)
 {
     init();
 }
@@ -52,6 +57,21 @@ void HmacBlockStream::init()
     m_blockIndex = 0;
     m_eof = false;
     m_error = false;
+    m_lastBlockPending = false;
+    clearPendingBlocks();
+}
+
+/**
+ * Enable read-ahead when reading. Up to the given number of blocks are fetched
+ * from the base device in advance and their HMACs are verified concurrently
+ * on the global thread pool. Data is still only returned once its block has
+ * been verified.
+ *
+ * @param blocks number of blocks to verify in parallel, 0 or 1 to disable
+ */
+void HmacBlockStream::setReadAhead(int blocks)
+{
+    m_readAhead = blocks;
 }
 
 bool HmacBlockStream::reset()
@@ -87,6 +107,7 @@ void HmacBlockStream::close()
         writeHashedBlock();
     }
 
+    clearPendingBlocks();
     LayeredStream::close();
 }
 
@@ -128,14 +149,96 @@ bool HmacBlockStream::readHashedBlock()
     if (m_eof) {
         return false;
     }
-    QByteArray hmac = m_baseDevice->read(32);
+
+    if (m_readAhead > 1) {
+        return readPendingBlock();
+    }
+
+    QByteArray hmac;
+    QByteArray blockSizeBytes;
+    if (!readBlockData(hmac, blockSizeBytes, m_buffer)) {
+        return false;
+    }
+
+    if (!verifyBlock(m_key, m_blockIndex, hmac, blockSizeBytes, m_buffer)) {
+        m_error = true;
+        setErrorString("Mismatch between hash and data.");
+        return false;
+    }
+
+    m_bufferPos = 0;
+    ++m_blockIndex;
+
+    if (m_buffer.isEmpty()) {
+        m_eof = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool HmacBlockStream::readPendingBlock()
+{
+    while (!m_lastBlockPending && m_pendingBlocks.size() < m_readAhead) {
+        QByteArray hmac;
+        QByteArray blockSizeBytes;
+        PendingBlock block;
+        if (!readBlockData(hmac, blockSizeBytes, block.data)) {
+            clearPendingBlocks();
+            return false;
+        }
+
+        const QByteArray key = m_key;
+        const quint64 blockIndex = m_blockIndex + static_cast<quint64>(m_pendingBlocks.size());
+        const QByteArray data = block.data;
+        block.verified = QtConcurrent::run(
+            [key, blockIndex, hmac, blockSizeBytes, data] { return verifyBlock(key, blockIndex, hmac, blockSizeBytes, data); });
+
+        m_lastBlockPending = block.data.isEmpty();
+        m_pendingBlocks.enqueue(block);
+    }
+
+    // Fail fast if any block further ahead has already been rejected
+    for (const PendingBlock& block : asConst(m_pendingBlocks)) {
+        if (block.verified.isFinished() && !block.verified.result()) {
+            clearPendingBlocks();
+            m_error = true;
+            setErrorString("Mismatch between hash and data.");
+            return false;
+        }
+    }
+
+    Q_ASSERT(!m_pendingBlocks.isEmpty());
+    PendingBlock block = m_pendingBlocks.dequeue();
+    if (!block.verified.result()) {
+        clearPendingBlocks();
+        m_error = true;
+        setErrorString("Mismatch between hash and data.");
+        return false;
+    }
+
+    m_buffer = block.data;
+    m_bufferPos = 0;
+    ++m_blockIndex;
+
+    if (m_buffer.isEmpty()) {
+        m_eof = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool HmacBlockStream::readBlockData(QByteArray& hmac, QByteArray& blockSizeBytes, QByteArray& data)
+{
+    hmac = m_baseDevice->read(32);
     if (hmac.size() != 32) {
         m_error = true;
         setErrorString("Invalid HMAC size.");
         return false;
     }
 
-    QByteArray blockSizeBytes = m_baseDevice->read(4);
+    blockSizeBytes = m_baseDevice->read(4);
     if (blockSizeBytes.size() != 4) {
         m_error = true;
         setErrorString("Invalid block size size.");
@@ -148,34 +251,61 @@ bool HmacBlockStream::readHashedBlock()
         return false;
     }
 
-    m_buffer = m_baseDevice->read(blockSize);
-    if (m_buffer.size() != blockSize) {
+    data = readBaseDevice(blockSize);
+    if (data.size() != blockSize) {
         m_error = true;
         setErrorString("Block too short.");
         return false;
     }
 
-    CryptoHash hasher(CryptoHash::Sha256, true);
-    hasher.setKey(getCurrentHmacKey());
-    hasher.addData(Endian::sizedIntToBytes<quint64>(m_blockIndex, ByteOrder));
-    hasher.addData(blockSizeBytes);
-    hasher.addData(m_buffer);
+    return true;
+}
 
-    if (hmac != hasher.result()) {
-        m_error = true;
-        setErrorString("Mismatch between hash and data.");
-        return false;
+/**
+ * Read from the base device. In-memory devices, such as databases received
+ * in a QBuffer, are not copied but referenced through a raw data view.
+ * The view stays valid as long as the underlying buffer is not modified.
+ */
+QByteArray HmacBlockStream::readBaseDevice(int size)
+{
+    auto* buffer = qobject_cast<QBuffer*>(m_baseDevice);
+    if (!buffer) {
+        return m_baseDevice->read(size);
     }
 
-    m_bufferPos = 0;
-    ++m_blockIndex;
+    const QByteArray& bufferData = buffer->data();
+    const qint64 pos = buffer->pos();
+    const int viewSize = static_cast<int>(qBound<qint64>(0, bufferData.size() - pos, size));
+    if (!buffer->seek(pos + viewSize)) {
+        return {};
+    }
+    return QByteArray::fromRawData(bufferData.constData() + pos, viewSize);
+}
 
-    if (blockSize == 0) {
-        m_eof = true;
-        return false;
+/**
+ * Wait for outstanding read-ahead verifications, which may still reference
+ * the base device data, and drop them.
+ */
+void HmacBlockStream::clearPendingBlocks()
+{
+    for (PendingBlock& block : m_pendingBlocks) {
+        block.verified.waitForFinished();
     }
+    m_pendingBlocks.clear();
+}
 
-    return true;
+bool HmacBlockStream::verifyBlock(const QByteArray& key,
+                                  quint64 blockIndex,
+                                  const QByteArray& hmac,
+                                  const QByteArray& blockSizeBytes,
+                                  const QByteArray& data)
+{
+    CryptoHash hasher(CryptoHash::Sha256, true);
+    hasher.setKey(getHmacKey(blockIndex, key));
+    hasher.addData(Endian::sizedIntToBytes<quint64>(blockIndex, ByteOrder));
+    hasher.addData(blockSizeBytes);
+    hasher.addData(data);
+    return hmac == hasher.result();
 }
 
 qint64 HmacBlockStream::writeData(const char* data, qint64 maxSize)
@@ -18,6 +18,8 @@
 #ifndef KEEPASSX_HMACBLOCKSTREAM_H
 #define KEEPASSX_HMACBLOCKSTREAM_H
 
+#include <QFuture>
+#include <QQueue>
 #include <QSysInfo>
 
 #include "streams/LayeredStream.h"
@@ -34,6 +36,8 @@ public:
     bool reset() override;
     void close() override;
 
+    void setReadAhead(int blocks);
+
     static QByteArray getHmacKey(quint64 blockIndex, const QByteArray& key);
 
     bool atEnd() const override;
@@ -43,11 +47,27 @@ protected:
     qint64 writeData(const char* data, qint64 maxSize) override;
 
 private:
+    struct PendingBlock
+    {
+        QByteArray data;
+        QFuture<bool> verified;
+    };
+
     void init();
     bool readHashedBlock();
+    bool readPendingBlock();
+    bool readBlockData(QByteArray& hmac, QByteArray& blockSizeBytes, QByteArray& data);
+    QByteArray readBaseDevice(int size);
+    void clearPendingBlocks();
     bool writeHashedBlock();
     QByteArray getCurrentHmacKey() const;
 
+    static bool verifyBlock(const QByteArray& key,
+                            quint64 blockIndex,
+                            const QByteArray& hmac,
+                            const QByteArray& blockSizeBytes,
+                            const QByteArray& data);
+
     static const QSysInfo::Endian ByteOrder;
     qint32 m_blockSize;
     QByteArray m_buffer;
@@ -56,6 +76,9 @@ private:
     quint64 m_blockIndex;
     bool m_eof;
     bool m_error;
+    int m_readAhead;
+    bool m_lastBlockPending;
+    QQueue<PendingBlock> m_pendingBlocks;
 };
 
 #endif // KEEPASSX_HMACBLOCKSTREAM_H
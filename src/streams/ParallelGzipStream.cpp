@@ -0,0 +1,292 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ParallelGzipStream.h"
+
+#include <QThread>
+#include <QtConcurrent>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "core/Endian.h"
+
+const int ParallelGzipStream::DefaultChunkSize = 128 * 1024;
+const int ParallelGzipStream::DefaultCompressionLevel = 6;
+
+namespace
+{
+    // size of the deflate window, which is carried over between chunks
+    const int WindowSize = 32 * 1024;
+
+    // magic, deflate method, no flags, no modification time, no extra flags, unknown OS
+    const char GzipHeader[] = {'\x1f', '\x8b', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\xff'};
+} // namespace
+
+ParallelGzipStream::ParallelGzipStream(QIODevice* baseDevice)
+    : ParallelGzipStream(baseDevice, DefaultChunkSize, DefaultCompressionLevel)
+{
+}
+
+ParallelGzipStream::ParallelGzipStream(QIODevice* baseDevice, int chunkSize, int compressionLevel)
+    : LayeredStream(baseDevice)
+    , m_chunkSize(chunkSize)
+    , m_compressionLevel(compressionLevel)
+    , m_maxPending(qMax(2, QThread::idealThreadCount() * 2))
+{
+    Q_ASSERT(chunkSize > 0);
+    init();
+}
+
+ParallelGzipStream::~ParallelGzipStream()
+{
+    close();
+}
+
+bool ParallelGzipStream::open(QIODevice::OpenMode mode)
+{
+    if (mode & QIODevice::ReadOnly) {
+        qWarning("ParallelGzipStream::open: Only writing is supported.");
+        return false;
+    }
+
+    init();
+    return LayeredStream::open(mode);
+}
+
+/**
+ * Complete the gzip member. Data written afterwards starts a new member.
+ *
+ * @return false if compressing or writing failed
+ */
+bool ParallelGzipStream::reset()
+{
+    bool ok = true;
+    if (isWritable() && m_started) {
+        ok = finish();
+    }
+
+    init();
+
+    return ok;
+}
+
+void ParallelGzipStream::close()
+{
+    if (isWritable() && m_started) {
+        finish();
+    }
+
+    LayeredStream::close();
+}
+
+void ParallelGzipStream::init()
+{
+    m_buffer.clear();
+    m_dictionary.clear();
+    m_pending.clear();
+    m_crc = 0;
+    m_size = 0;
+    m_started = false;
+    m_error = false;
+}
+
+qint64 ParallelGzipStream::readData(char* data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+qint64 ParallelGzipStream::writeData(const char* data, qint64 maxSize)
+{
+    Q_ASSERT(maxSize >= 0);
+
+    if (m_error) {
+        return -1;
+    }
+
+    if (!m_started && !writeHeader()) {
+        return -1;
+    }
+
+    qint64 offset = 0;
+    while (offset < maxSize) {
+        int bytesToCopy = static_cast<int>(qMin(maxSize - offset, static_cast<qint64>(m_chunkSize - m_buffer.size())));
+        m_buffer.append(data + offset, bytesToCopy);
+        offset += bytesToCopy;
+
+        if (m_buffer.size() == m_chunkSize && !submitChunk(false)) {
+            return -1;
+        }
+    }
+
+    return maxSize;
+}
+
+bool ParallelGzipStream::writeHeader()
+{
+    if (m_baseDevice->write(GzipHeader, sizeof(GzipHeader)) != sizeof(GzipHeader)) {
+        m_error = true;
+        setErrorString(m_baseDevice->errorString());
+        return false;
+    }
+
+    m_started = true;
+    return true;
+}
+
+/**
+ * Queue the buffered data for compression. If too many chunks are in
+ * flight, the oldest one is waited for and written first.
+ */
+bool ParallelGzipStream::submitChunk(bool last)
+{
+    QByteArray input;
+    input.swap(m_buffer);
+    m_buffer.reserve(m_chunkSize);
+
+    const QByteArray dictionary = m_dictionary;
+    if (input.size() >= WindowSize) {
+        m_dictionary = input.right(WindowSize);
+    } else {
+        m_dictionary = (m_dictionary + input).right(WindowSize);
+    }
+
+    m_pending.enqueue(QtConcurrent::run(&ParallelGzipStream::compressChunk, input, dictionary, m_compressionLevel, last));
+
+    while (m_pending.size() > m_maxPending) {
+        if (!writeChunk(m_pending.dequeue())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ParallelGzipStream::writeChunk(QFuture<Chunk> future)
+{
+    const Chunk chunk = future.result();
+    if (!chunk.ok) {
+        m_error = true;
+        setErrorString(tr("Failed to compress data."));
+        return false;
+    }
+
+    if (m_baseDevice->write(chunk.data) != chunk.data.size()) {
+        m_error = true;
+        setErrorString(m_baseDevice->errorString());
+        return false;
+    }
+
+    m_crc = static_cast<quint32>(crc32_combine(m_crc, chunk.crc, chunk.size));
+    m_size += static_cast<quint32>(chunk.size);
+    return true;
+}
+
+/**
+ * Compress the remaining data and write the gzip trailer.
+ */
+bool ParallelGzipStream::finish()
+{
+    bool ok = !m_error && submitChunk(true);
+
+    while (!m_pending.isEmpty()) {
+        QFuture<Chunk> future = m_pending.dequeue();
+        if (ok) {
+            ok = writeChunk(future);
+        } else {
+            future.waitForFinished();
+        }
+    }
+
+    if (ok) {
+        // the size is stored modulo 2^32 as required by RFC 1952
+        QByteArray trailer = Endian::sizedIntToBytes<quint32>(m_crc, QSysInfo::LittleEndian);
+        trailer.append(Endian::sizedIntToBytes<quint32>(m_size, QSysInfo::LittleEndian));
+        if (m_baseDevice->write(trailer) != trailer.size()) {
+            m_error = true;
+            setErrorString(m_baseDevice->errorString());
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * Deflate a single chunk into raw deflate blocks. All chunks but the last end
+ * with a sync flush, so they end on a byte boundary and can be concatenated.
+ *
+ * @param input uncompressed data
+ * @param dictionary up to 32 KiB of data preceding the chunk
+ * @param level zlib compression level
+ * @param last true if this is the last chunk of the gzip member
+ * @return compressed data and CRC-32 of the input
+ */
+ParallelGzipStream::Chunk
+ParallelGzipStream::compressChunk(const QByteArray& input, const QByteArray& dictionary, int level, bool last)
+{
+    Chunk chunk;
+    chunk.size = input.size();
+    chunk.crc = static_cast<quint32>(
+        crc32(0, reinterpret_cast<const Bytef*>(input.constData()), static_cast<uInt>(input.size())));
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return chunk;
+    }
+
+    if (!dictionary.isEmpty()
+        && deflateSetDictionary(
+               &stream, reinterpret_cast<const Bytef*>(dictionary.constData()), static_cast<uInt>(dictionary.size()))
+               != Z_OK) {
+        deflateEnd(&stream);
+        return chunk;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.constData()));
+    stream.avail_in = static_cast<uInt>(input.size());
+
+    // the bound covers the end of the stream, add some room for the sync marker
+    const int bufferSize = static_cast<int>(deflateBound(&stream, static_cast<uLong>(input.size()))) + 16;
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int written = 0;
+
+    while (true) {
+        chunk.data.resize(written + bufferSize);
+        stream.next_out = reinterpret_cast<Bytef*>(chunk.data.data() + written);
+        stream.avail_out = static_cast<uInt>(bufferSize);
+
+        int result = deflate(&stream, flush);
+        written = chunk.data.size() - static_cast<int>(stream.avail_out);
+
+        if (result == Z_STREAM_ERROR) {
+            break;
+        }
+        // a flush is complete once deflate leaves output space unused
+        if (last ? result == Z_STREAM_END : stream.avail_out > 0) {
+            chunk.ok = true;
+            break;
+        }
+    }
+
+    deflateEnd(&stream);
+    chunk.data.resize(written);
+    return chunk;
+}
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_PARALLELGZIPSTREAM_H
+#define KEEPASSX_PARALLELGZIPSTREAM_H
+
+#include <QFuture>
+#include <QQueue>
+
+#include "streams/LayeredStream.h"
+
+/**
+ * Write-only stream that gzip compresses its data on the global thread pool.
+ *
+ * The data is split into chunks that are deflated independently and
+ * concatenated into a single gzip member, the same way pigz does it. Every
+ * chunk is primed with the last 32 KiB of the data before it, so the result
+ * is about as small as that of a single deflate stream and can be read by any
+ * gzip decoder. Calling reset() or close() completes the gzip member.
+ */
+class ParallelGzipStream : public LayeredStream
+{
+    Q_OBJECT
+
+public:
+    explicit ParallelGzipStream(QIODevice* baseDevice);
+    ParallelGzipStream(QIODevice* baseDevice, int chunkSize, int compressionLevel);
+    ~ParallelGzipStream() override;
+
+    bool open(QIODevice::OpenMode mode) override;
+    bool reset() override;
+    void close() override;
+
+    static const int DefaultChunkSize;
+    static const int DefaultCompressionLevel;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    struct Chunk
+    {
+        QByteArray data;
+        quint32 crc = 0;
+        int size = 0;
+        bool ok = false;
+    };
+
+    void init();
+    bool writeHeader();
+    bool submitChunk(bool last);
+    bool writeChunk(QFuture<Chunk> future);
+    bool finish();
+
+    static Chunk compressChunk(const QByteArray& input, const QByteArray& dictionary, int level, bool last);
+
+    const int m_chunkSize;
+    const int m_compressionLevel;
+    const int m_maxPending;
+    QByteArray m_buffer;
+    QByteArray m_dictionary;
+    QQueue<QFuture<Chunk>> m_pending;
+    quint32 m_crc;
+    quint32 m_size;
+    bool m_started;
+    bool m_error;
+};
+
+#endif // KEEPASSX_PARALLELGZIPSTREAM_H
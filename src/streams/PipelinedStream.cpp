@@ -0,0 +1,235 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PipelinedStream.h"
+
+#include <QThread>
+
+const int PipelinedStream::DefaultChunkSize = 1024 * 1024;
+const int PipelinedStream::DefaultMaxChunks = 4;
+
+class PipelinedStream::Worker : public QThread
+{
+public:
+    explicit Worker(PipelinedStream* stream)
+        : m_stream(stream)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        m_stream->produce();
+    }
+
+private:
+    PipelinedStream* const m_stream;
+};
+
+PipelinedStream::PipelinedStream(QIODevice* baseDevice)
+    : PipelinedStream(baseDevice, DefaultChunkSize, DefaultMaxChunks)
+{
+}
+
+PipelinedStream::PipelinedStream(QIODevice* baseDevice, int chunkSize, int maxChunks)
+    : LayeredStream(baseDevice)
+    , m_chunkSize(chunkSize)
+    , m_maxChunks(maxChunks)
+    , m_finished(false)
+    , m_aborted(false)
+    , m_workerError(false)
+    , m_chunkPos(0)
+    , m_error(false)
+{
+    Q_ASSERT(chunkSize > 0);
+    Q_ASSERT(maxChunks > 0);
+}
+
+PipelinedStream::~PipelinedStream()
+{
+    close();
+}
+
+bool PipelinedStream::open(QIODevice::OpenMode mode)
+{
+    if (mode & QIODevice::WriteOnly) {
+        qWarning("PipelinedStream::open: Only reading is supported.");
+        return false;
+    }
+
+    if (!LayeredStream::open(mode)) {
+        return false;
+    }
+
+    m_queue.clear();
+    m_finished = false;
+    m_aborted = false;
+    m_workerError = false;
+    m_workerErrorString.clear();
+    m_chunk.clear();
+    m_chunkPos = 0;
+    m_error = false;
+
+    m_worker.reset(new Worker(this));
+    m_worker->start();
+
+    return true;
+}
+
+void PipelinedStream::close()
+{
+    stopWorker();
+    LayeredStream::close();
+}
+
+/**
+ * Blocks until the next chunk is queued, so the result is independent of
+ * how far the worker thread has progressed.
+ */
+bool PipelinedStream::atEnd() const
+{
+    if (m_chunkPos < m_chunk.size() || QIODevice::bytesAvailable() > 0) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.isEmpty() && !m_finished && !m_aborted) {
+        m_chunkAvailable.wait(&m_mutex);
+    }
+    return m_queue.isEmpty();
+}
+
+qint64 PipelinedStream::readData(char* data, qint64 maxSize)
+{
+    Q_ASSERT(maxSize >= 0);
+
+    if (m_error) {
+        return -1;
+    }
+
+    qint64 bytesRemaining = maxSize;
+    qint64 offset = 0;
+
+    while (bytesRemaining > 0) {
+        if (m_chunkPos == m_chunk.size() && !nextChunk()) {
+            if (m_error) {
+                return -1;
+            }
+            return maxSize - bytesRemaining;
+        }
+
+        qint64 bytesToCopy = qMin(bytesRemaining, static_cast<qint64>(m_chunk.size() - m_chunkPos));
+
+        memcpy(data + offset, m_chunk.constData() + m_chunkPos, static_cast<size_t>(bytesToCopy));
+
+        offset += bytesToCopy;
+        m_chunkPos += bytesToCopy;
+        bytesRemaining -= bytesToCopy;
+    }
+
+    return maxSize;
+}
+
+qint64 PipelinedStream::writeData(const char* data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+/**
+ * Worker thread loop: read chunks from the base device until it is
+ * exhausted, fails or the stream is closed.
+ */
+void PipelinedStream::produce()
+{
+    while (true) {
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.size() >= m_maxChunks && !m_aborted) {
+                m_slotAvailable.wait(&m_mutex);
+            }
+            if (m_aborted) {
+                return;
+            }
+        }
+
+        QByteArray chunk(m_chunkSize, Qt::Uninitialized);
+        qint64 readResult = m_baseDevice->read(chunk.data(), chunk.size());
+
+        QMutexLocker locker(&m_mutex);
+        if (readResult <= 0) {
+            if (readResult < 0) {
+                m_workerError = true;
+                m_workerErrorString = m_baseDevice->errorString();
+            }
+            m_finished = true;
+            m_chunkAvailable.wakeAll();
+            return;
+        }
+
+        chunk.resize(static_cast<int>(readResult));
+        m_queue.enqueue(chunk);
+        m_chunkAvailable.wakeAll();
+    }
+}
+
+/**
+ * Take the next chunk from the queue, waiting for the worker if necessary.
+ *
+ * @return false if the base device is exhausted or failed
+ */
+bool PipelinedStream::nextChunk()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.isEmpty() && !m_finished && !m_aborted) {
+        m_chunkAvailable.wait(&m_mutex);
+    }
+
+    if (!m_queue.isEmpty()) {
+        m_chunk = m_queue.dequeue();
+        m_chunkPos = 0;
+        m_slotAvailable.wakeOne();
+        return true;
+    }
+
+    m_chunk.clear();
+    m_chunkPos = 0;
+    if (m_workerError) {
+        m_error = true;
+        setErrorString(m_workerErrorString);
+    }
+    return false;
+}
+
+void PipelinedStream::stopWorker()
+{
+    if (!m_worker) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_aborted = true;
+        m_slotAvailable.wakeAll();
+        m_chunkAvailable.wakeAll();
+    }
+
+    m_worker->wait();
+    m_worker.reset();
+    m_queue.clear();
+}
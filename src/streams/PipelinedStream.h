@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_PIPELINEDSTREAM_H
+#define KEEPASSX_PIPELINEDSTREAM_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QScopedPointer>
+#include <QWaitCondition>
+
+#include "streams/LayeredStream.h"
+
+class QThread;
+
+/**
+ * Read-only stream that pulls its base device on a dedicated worker thread.
+ *
+ * The worker reads chunks of the base device into a bounded queue, which the
+ * consumer drains through the regular QIODevice interface. Chaining several
+ * pipelined streams lets every layer of a stream stack run on its own core.
+ * The base device must not be accessed by anyone else while this stream is open.
+ */
+class PipelinedStream : public LayeredStream
+{
+    Q_OBJECT
+
+public:
+    explicit PipelinedStream(QIODevice* baseDevice);
+    PipelinedStream(QIODevice* baseDevice, int chunkSize, int maxChunks);
+    ~PipelinedStream() override;
+
+    bool open(QIODevice::OpenMode mode) override;
+    void close() override;
+    bool atEnd() const override;
+
+    static const int DefaultChunkSize;
+    static const int DefaultMaxChunks;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    class Worker;
+
+    void produce();
+    bool nextChunk();
+    void stopWorker();
+
+    const int m_chunkSize;
+    const int m_maxChunks;
+    QScopedPointer<Worker> m_worker;
+
+    // shared between producer and consumer, guarded by m_mutex
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_chunkAvailable;
+    QWaitCondition m_slotAvailable;
+    QQueue<QByteArray> m_queue;
+    bool m_finished;
+    bool m_aborted;
+    bool m_workerError;
+    QString m_workerErrorString;
+
+    // consumer side only
+    QByteArray m_chunk;
+    int m_chunkPos;
+    bool m_error;
+};
+
+#endif // KEEPASSX_PIPELINEDSTREAM_H
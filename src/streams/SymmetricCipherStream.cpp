@@ -44,12 +44,14 @@ bool SymmetricCipherStream::init(const QByteArray& key, const QByteArray& iv)
         setErrorString(m_cipher->errorString());
     }
     m_streamCipher = m_cipher->blockSize() == 1;
+    // the buffer keeps its capacity, so blocks are processed without reallocating it
+    m_buffer.reserve(blockSize());
     return m_isInitialized;
 }
 
 void SymmetricCipherStream::resetInternalState()
 {
-    m_buffer.clear();
+    m_buffer.resize(0);
     m_bufferPos = 0;
     m_bufferFilling = false;
     m_error = false;
@@ -122,23 +124,22 @@ qint64 SymmetricCipherStream::readData(char* data, qint64 maxSize)
 
 bool SymmetricCipherStream::readBlock()
 {
-    QByteArray newData;
-
-    if (m_bufferFilling) {
-        newData.resize(blockSize() - m_buffer.size());
-    } else {
-        m_buffer.clear();
-        newData.resize(blockSize());
+    if (!m_bufferFilling) {
+        m_buffer.resize(0);
     }
 
-    int readResult = m_baseDevice->read(newData.data(), newData.size());
+    // read straight into the buffer instead of through a temporary array
+    const int bufferSize = m_buffer.size();
+    m_buffer.resize(blockSize());
+    int readResult = m_baseDevice->read(m_buffer.data() + bufferSize, blockSize() - bufferSize);
 
     if (readResult == -1) {
+        m_buffer.resize(bufferSize);
         m_error = true;
         setErrorString(m_baseDevice->errorString());
         return false;
     } else {
-        m_buffer.append(newData.left(readResult));
+        m_buffer.resize(bufferSize + readResult);
     }
 
     if (!m_streamCipher && m_buffer.size() != blockSize()) {
@@ -240,7 +241,7 @@ bool SymmetricCipherStream::writeBlock(bool lastBlock)
         setErrorString(m_baseDevice->errorString());
         return false;
     } else {
-        m_buffer.clear();
+        m_buffer.resize(0);
         return true;
     }
 }
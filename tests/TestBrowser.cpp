@@ -338,6 +338,44 @@ void TestBrowser::testSearchEntriesWithAdditionalURLs()
     QCOMPARE(additionalResult[0]->url(), QString("https://github.com/"));
 }
 
+void TestBrowser::testSearchEntriesUrlIndex()
+{
+    auto db = QSharedPointer<Database>::create();
+    auto* root = db->rootGroup();
+
+    QStringList urls = {"https://github.com/login", "https://example.com", "https://github.com/settings"};
+    auto entries = createEntries(urls, root);
+
+    auto result = m_browserService->searchEntries(db, "https://github.com", "https://github.com/session");
+    QCOMPARE(result, QList<Entry*>({entries[0], entries[2]}));
+
+    // Modified entries are found under their new domains
+    entries[1]->setUrl("https://github.com/gist");
+    entries[2]->setUrl("https://example.com");
+    entries[0]->attributes()->set(BrowserService::ADDITIONAL_URL, "https://example.com/login");
+    result = m_browserService->searchEntries(db, "https://github.com", "https://github.com/session");
+    QCOMPARE(result, QList<Entry*>({entries[0], entries[1]}));
+    result = m_browserService->searchEntries(db, "https://example.com", "https://example.com");
+    QCOMPARE(result, QList<Entry*>({entries[0], entries[2]}));
+
+    delete entries[0];
+    result = m_browserService->searchEntries(db, "https://github.com", "https://github.com/session");
+    QCOMPARE(result, QList<Entry*>({entries[1]}));
+
+    // Results keep the order of the groups
+    auto* group = new Group();
+    group->setParent(root);
+    entries[1]->setGroup(group);
+    QStringList moreUrls = {"https://github.com"};
+    auto moreEntries = createEntries(moreUrls, root);
+    result = m_browserService->searchEntries(db, "https://github.com", "https://github.com/session");
+    QCOMPARE(result, QList<Entry*>({moreEntries[0], entries[1]}));
+
+    group->setSearchingEnabled(Group::Disable);
+    result = m_browserService->searchEntries(db, "https://github.com", "https://github.com/session");
+    QCOMPARE(result, QList<Entry*>({moreEntries[0]}));
+}
+
 void TestBrowser::testInvalidEntries()
 {
     auto db = QSharedPointer<Database>::create();
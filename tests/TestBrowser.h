@@ -46,6 +46,7 @@ private slots:
     void testSearchEntriesByUUID();
     void testSearchEntriesWithPort();
     void testSearchEntriesWithAdditionalURLs();
+    void testSearchEntriesUrlIndex();
     void testInvalidEntries();
     void testSubdomainsAndPaths();
     void testSortEntries();
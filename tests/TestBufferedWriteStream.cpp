@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestBufferedWriteStream.h"
+#include "TestGlobal.h"
+
+#include <QBuffer>
+
+#include "FailDevice.h"
+#include "crypto/Crypto.h"
+#include "crypto/Random.h"
+#include "streams/BufferedWriteStream.h"
+
+QTEST_GUILESS_MAIN(TestBufferedWriteStream)
+
+void TestBufferedWriteStream::initTestCase()
+{
+    QVERIFY(Crypto::init());
+}
+
+void TestBufferedWriteStream::testWrite()
+{
+    QByteArray input = randomGen()->randomArray(1000);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    BufferedWriteStream writer(&buffer, 64);
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+
+    // small writes are collected
+    QCOMPARE(writer.write(input.left(40)), qint64(40));
+    QCOMPARE(writer.write(input.mid(40, 20)), qint64(20));
+    QCOMPARE(buffer.buffer().size(), 0);
+
+    // the buffer is written before it overflows
+    QCOMPARE(writer.write(input.mid(60, 10)), qint64(10));
+    QCOMPARE(buffer.buffer(), input.left(60));
+
+    // large writes bypass the buffer
+    QCOMPARE(writer.write(input.mid(70, 500)), qint64(500));
+    QCOMPARE(buffer.buffer(), input.left(570));
+
+    int pos = 570;
+    while (pos < input.size()) {
+        const int size = qMin(7, input.size() - pos);
+        QCOMPARE(writer.write(input.mid(pos, size)), qint64(size));
+        pos += size;
+    }
+    QVERIFY(writer.reset());
+    QCOMPARE(buffer.buffer(), input);
+}
+
+void TestBufferedWriteStream::testWriteFailure()
+{
+    QByteArray input = randomGen()->randomArray(120);
+
+    FailDevice failDevice(50);
+    QVERIFY(failDevice.open(QIODevice::WriteOnly));
+    BufferedWriteStream writer(&failDevice, 64);
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+    QCOMPARE(writer.write(input.left(60)), qint64(60));
+    QCOMPARE(writer.write(input.mid(60, 60)), qint64(60));
+    QVERIFY(!writer.reset());
+    QCOMPARE(writer.errorString(), QString("FAILDEVICE"));
+}
@@ -19,11 +19,16 @@
 #include "TestDatabase.h"
 #include "TestGlobal.h"
 
+#include <QFileInfo>
 #include <QSignalSpy>
+#include <QTemporaryDir>
 
 #include "config-keepassx-tests.h"
+#include "core/Group.h"
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
+#include "format/KdbxSnapshotCache.h"
+#include "format/KeePass2.h"
 #include "format/KeePass2Writer.h"
 #include "keys/PasswordKey.h"
 #include "util/TemporaryFile.h"
@@ -95,6 +100,246 @@ void TestDatabase::testSave()
     QVERIFY(!QFile::exists(backupFilePath));
 }
 
+void TestDatabase::testSaveInBackground()
+{
+    TemporaryFile tempFile;
+    QVERIFY(tempFile.copyFromFile(dbFileName));
+
+    auto db = QSharedPointer<Database>::create();
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("a"));
+
+    QString error;
+    QVERIFY(db->open(tempFile.fileName(), key, &error));
+
+    auto* entry = new Entry();
+    entry->setUuid(QUuid::createUuid());
+    entry->setTitle("saved");
+    entry->setPassword("password");
+    entry->setGroup(db->rootGroup());
+
+    QSignalSpy spyFinished(db.data(), SIGNAL(backgroundSaveFinished(bool, QString)));
+    QSignalSpy spySaved(db.data(), SIGNAL(databaseSaved()));
+    QVERIFY2(db->saveInBackground(&error), error.toLatin1());
+    QVERIFY(db->isSaving());
+    QVERIFY(!db->saveInBackground(&error));
+
+    // modifications while saving do not end up in the file
+    entry->setTitle("modified");
+
+    QVERIFY(spyFinished.wait());
+    QCOMPARE(spyFinished.first().at(0).toBool(), true);
+    QVERIFY(!db->isSaving());
+    QVERIFY(db->isModified());
+    QCOMPARE(spySaved.count(), 0);
+
+    auto savedDb = QSharedPointer<Database>::create();
+    QVERIFY(savedDb->open(tempFile.fileName(), key, &error));
+    Entry* savedEntry = savedDb->rootGroup()->findEntryByUuid(entry->uuid());
+    QVERIFY(savedEntry);
+    QCOMPARE(savedEntry->title(), QString("saved"));
+    QCOMPARE(savedEntry->password(), QString("password"));
+
+    // a regular save waits for a running background save
+    QVERIFY2(db->saveInBackground(&error), error.toLatin1());
+    QVERIFY2(db->save(&error), error.toLatin1());
+    QVERIFY(!db->isModified());
+    QCOMPARE(spyFinished.count(), 2);
+
+    savedDb = QSharedPointer<Database>::create();
+    QVERIFY(savedDb->open(tempFile.fileName(), key, &error));
+    QCOMPARE(savedDb->rootGroup()->findEntryByUuid(entry->uuid())->title(), QString("modified"));
+}
+
+void TestDatabase::testSaveInBackgroundFailure()
+{
+    TemporaryFile tempFile;
+    QVERIFY(tempFile.copyFromFile(dbFileName));
+
+    auto db = QSharedPointer<Database>::create();
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("a"));
+
+    QString error;
+    QVERIFY(db->open(tempFile.fileName(), key, &error));
+
+    QSignalSpy spyModified(db.data(), SIGNAL(databaseModified()));
+    db->metadata()->setName("unsaved");
+    QVERIFY(spyModified.wait());
+
+    // a directory cannot be replaced by the database file
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    db->setFilePath(tempDir.path());
+
+    QSignalSpy spyFinished(db.data(), SIGNAL(backgroundSaveFinished(bool, QString)));
+    QVERIFY2(db->saveInBackground(&error), error.toLatin1());
+    QVERIFY(spyFinished.wait());
+    QCOMPARE(spyFinished.first().at(0).toBool(), false);
+    QVERIFY(!spyFinished.first().at(1).toString().isEmpty());
+    QVERIFY(db->isModified());
+
+    // the failed save does not trigger another autosave
+    QTest::qWait(500);
+    QCOMPARE(spyModified.count(), 1);
+    QCOMPARE(spyFinished.count(), 1);
+    QVERIFY(!db->isSaving());
+}
+
+void TestDatabase::testKeyPrecomputation()
+{
+    TemporaryFile tempFile;
+    QVERIFY(tempFile.copyFromFile(dbFileName));
+
+    auto db = QSharedPointer<Database>::create();
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("a"));
+
+    QString error;
+    QVERIFY(db->open(tempFile.fileName(), key, &error));
+    QVERIFY(!db->isKeyPrecomputationEnabled());
+    db->setKeyPrecomputationEnabled(true);
+    QVERIFY(db->isKeyPrecomputationEnabled());
+
+    // every save still uses a new seed
+    for (int i = 0; i < 2; ++i) {
+        const QByteArray seed = db->kdf()->seed();
+        const QByteArray transformedKey = db->transformedDatabaseKey().toHex();
+        db->metadata()->setName(QString("precomputed %1").arg(i));
+        QVERIFY2(db->save(&error), error.toLatin1());
+        QVERIFY(db->kdf()->seed() != seed);
+        QVERIFY(db->transformedDatabaseKey().toHex() != transformedKey);
+
+        QByteArray expectedKey;
+        QVERIFY(key->transform(*db->kdf(), expectedKey));
+        QCOMPARE(db->transformedDatabaseKey().toHex(), expectedKey.toHex());
+    }
+
+    // a key precomputed for the old key is not used after changing it
+    auto newKey = QSharedPointer<CompositeKey>::create();
+    newKey->addKey(QSharedPointer<PasswordKey>::create("b"));
+    QVERIFY(db->setKey(newKey));
+    QVERIFY2(db->save(&error), error.toLatin1());
+
+    auto savedDb = QSharedPointer<Database>::create();
+    QVERIFY(!savedDb->open(tempFile.fileName(), key, &error));
+    QVERIFY(savedDb->open(tempFile.fileName(), newKey, &error));
+    QCOMPARE(savedDb->metadata()->name(), QString("precomputed 1"));
+}
+
+void TestDatabase::testUnlockCache()
+{
+    TemporaryFile tempFile;
+    QVERIFY(tempFile.copyFromFile(dbFileName));
+
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("a"));
+
+    // snapshots are only supported by KDBX 4
+    QString error;
+    auto db = QSharedPointer<Database>::create();
+    QVERIFY(db->open(tempFile.fileName(), key, &error));
+    auto kdf = KeePass2::uuidToKdf(KeePass2::KDF_AES_KDBX4);
+    kdf->setRounds(1000);
+    QVERIFY(db->changeKdf(kdf));
+
+    auto* entry = new Entry();
+    entry->setUuid(QUuid::createUuid());
+    entry->setTitle("Snapshot");
+    entry->setPassword("first");
+    entry->attributes()->set("Secret", "value", true);
+    entry->attachments()->set("data.bin", QByteArray(4096, 'X'));
+    entry->setGroup(db->rootGroup());
+    entry->beginUpdate();
+    entry->setPassword("second");
+    entry->endUpdate();
+    db->addDeletedObject(QUuid::createUuid());
+    QVERIFY2(db->save(&error), error.toLatin1());
+
+    KdbxSnapshotCache* cache = KdbxSnapshotCache::instance();
+    cache->clear();
+
+    auto firstDb = QSharedPointer<Database>::create();
+    firstDb->setUnlockCacheEnabled(true);
+    QVERIFY(firstDb->open(tempFile.fileName(), key, &error));
+    QCOMPARE(cache->count(), 1);
+
+    // the credentials are still verified
+    auto wrongKey = QSharedPointer<CompositeKey>::create();
+    wrongKey->addKey(QSharedPointer<PasswordKey>::create("b"));
+    auto failedDb = QSharedPointer<Database>::create();
+    failedDb->setUnlockCacheEnabled(true);
+    QVERIFY(!failedDb->open(tempFile.fileName(), wrongKey, &error));
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    // make the payload unreadable while keeping the header, the size and the modification
+    // time, so the database can only be opened from its snapshot from now on
+    {
+        QFile file(tempFile.fileName());
+        const QDateTime lastModified = QFileInfo(file).lastModified();
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.seek(file.size() - 64));
+        QCOMPARE(file.write(QByteArray(64, '\xFF')), qint64(64));
+        QVERIFY(file.flush());
+        QVERIFY(file.setFileTime(lastModified, QFileDevice::FileModificationTime));
+        file.close();
+    }
+
+    auto uncachedDb = QSharedPointer<Database>::create();
+    QVERIFY(!uncachedDb->open(tempFile.fileName(), key, &error));
+#endif
+
+    auto cachedDb = QSharedPointer<Database>::create();
+    cachedDb->setUnlockCacheEnabled(true);
+    QVERIFY(cachedDb->open(tempFile.fileName(), key, &error));
+
+    QCOMPARE(cachedDb->metadata()->name(), firstDb->metadata()->name());
+    QCOMPARE(cachedDb->metadata()->protectPassword(), firstDb->metadata()->protectPassword());
+    QVERIFY(cachedDb->deletedObjects() == firstDb->deletedObjects());
+    QCOMPARE(cachedDb->rootGroup()->groupsRecursive(true).size(), firstDb->rootGroup()->groupsRecursive(true).size());
+
+    const QList<Entry*> entries = firstDb->rootGroup()->entriesRecursive(true);
+    const QList<Entry*> cachedEntries = cachedDb->rootGroup()->entriesRecursive(true);
+    QCOMPARE(cachedEntries.size(), entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        QCOMPARE(cachedEntries.at(i)->uuid(), entries.at(i)->uuid());
+        QCOMPARE(cachedEntries.at(i)->timeInfo(), entries.at(i)->timeInfo());
+        QCOMPARE(cachedEntries.at(i)->historyItems().size(), entries.at(i)->historyItems().size());
+        QVERIFY(*cachedEntries.at(i)->attributes() == *entries.at(i)->attributes());
+        QVERIFY(*cachedEntries.at(i)->attachments() == *entries.at(i)->attachments());
+    }
+
+    Entry* cachedEntry = cachedDb->rootGroup()->findEntryByUuid(entry->uuid());
+    QVERIFY(cachedEntry);
+    QCOMPARE(cachedEntry->password(), QString("second"));
+    QVERIFY(cachedEntry->attributes()->isProtected("Secret"));
+    QCOMPARE(cachedEntry->attachments()->value("data.bin"), QByteArray(4096, 'X'));
+    QCOMPARE(cachedEntry->historyItems().first()->password(), QString("first"));
+
+    // a snapshot is only used for the header it was made for
+    auto restoredDb = QSharedPointer<Database>::create();
+    QVERIFY(!cache->restore(
+        tempFile.fileName(), QByteArray(32, '\0'), cachedDb->transformedDatabaseKey(), restoredDb.data()));
+
+    // saving replaces the file, so its snapshot is dropped
+    cachedDb->metadata()->setName("changed");
+    QVERIFY2(cachedDb->save(&error), error.toLatin1());
+    QCOMPARE(cache->count(), 0);
+
+    // and so does saving in the background
+    auto reopenedDb = QSharedPointer<Database>::create();
+    reopenedDb->setUnlockCacheEnabled(true);
+    QVERIFY(reopenedDb->open(tempFile.fileName(), key, &error));
+    QCOMPARE(cache->count(), 1);
+
+    QSignalSpy spyFinished(reopenedDb.data(), SIGNAL(backgroundSaveFinished(bool, QString)));
+    reopenedDb->metadata()->setName("changed again");
+    QVERIFY2(reopenedDb->saveInBackground(&error), error.toLatin1());
+    QVERIFY(spyFinished.wait());
+    QCOMPARE(spyFinished.first().at(0).toBool(), true);
+    QCOMPARE(cache->count(), 0);
+}
+
 void TestDatabase::testSignals()
 {
     TemporaryFile tempFile;
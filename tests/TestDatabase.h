@@ -29,6 +29,10 @@ private slots:
     void initTestCase();
     void testOpen();
     void testSave();
+    void testSaveInBackground();
+    void testSaveInBackgroundFailure();
+    void testKeyPrecomputation();
+    void testUnlockCache();
     void testSignals();
     void testEmptyRecycleBinOnDisabled();
     void testEmptyRecycleBinOnNotCreated();
@@ -19,6 +19,7 @@
 #include "TestGlobal.h"
 
 #include "config-keepassx-tests.h"
+#include "core/Clock.h"
 #include "crypto/Crypto.h"
 #include "format/KdbxXmlReader.h"
 #include "format/KeePass2.h"
@@ -151,3 +152,79 @@ void TestDeletedObjects::testDatabaseChange()
 
     delete group;
 }
+
+void TestDeletedObjects::testDeletedObjectsIndex()
+{
+    Database db;
+    const QDateTime now = Clock::currentDateTimeUtc();
+
+    DeletedObject first{QUuid::createUuid(), now.addSecs(-60)};
+    DeletedObject second{QUuid::createUuid(), now.addSecs(-30)};
+    DeletedObject third{QUuid::createUuid(), now};
+    db.addDeletedObject(first);
+    db.addDeletedObject(second);
+    db.addDeletedObject(third);
+    QCOMPARE(db.deletedObjects().size(), 3);
+    QVERIFY(db.containsDeletedObject(second.uuid));
+
+    // an object deleted again keeps the earliest deletion time
+    db.addDeletedObject(DeletedObject{second.uuid, now});
+    QCOMPARE(db.deletedObjects().size(), 3);
+    QCOMPARE(db.deletedObjects().at(1).deletionTime, second.deletionTime);
+    db.addDeletedObject(DeletedObject{third.uuid, now.addSecs(-90)});
+    QCOMPARE(db.deletedObjects().size(), 3);
+    QCOMPARE(db.deletedObjects().at(2).deletionTime, now.addSecs(-90));
+
+    QVERIFY(db.removeDeletedObject(first.uuid));
+    QVERIFY(!db.removeDeletedObject(first.uuid));
+    QVERIFY(!db.containsDeletedObject(first.uuid));
+    QCOMPARE(db.deletedObjects().size(), 2);
+    QCOMPARE(db.deletedObjects().at(0).uuid, second.uuid);
+    QCOMPARE(db.deletedObjects().at(1).uuid, third.uuid);
+
+    QVERIFY(db.removeDeletedObject(third.uuid));
+    QVERIFY(db.containsDeletedObject(second.uuid));
+    db.addDeletedObject(first);
+    QCOMPARE(db.deletedObjects().size(), 2);
+    QCOMPARE(db.deletedObjects().at(1).uuid, first.uuid);
+
+    db.setDeletedObjects({third, second, third});
+    QCOMPARE(db.deletedObjects().size(), 2);
+    QCOMPARE(db.deletedObjects().at(0).uuid, third.uuid);
+    QVERIFY(!db.containsDeletedObject(first.uuid));
+
+    // removing several objects at once keeps the index of the remaining ones
+    db.setDeletedObjects({first, second, third});
+    QCOMPARE(db.removeDeletedObjects({first.uuid, third.uuid, QUuid::createUuid()}), 2);
+    QCOMPARE(db.deletedObjects().size(), 1);
+    QVERIFY(!db.containsDeletedObject(first.uuid));
+    QVERIFY(!db.containsDeletedObject(third.uuid));
+    QVERIFY(db.removeDeletedObject(second.uuid));
+    QCOMPARE(db.removeDeletedObjects({second.uuid}), 0);
+    QVERIFY(db.deletedObjects().isEmpty());
+}
+
+void TestDeletedObjects::testCompactDeletedObjects()
+{
+    Database db;
+    const QDateTime now = Clock::currentDateTimeUtc();
+
+    DeletedObject old{QUuid::createUuid(), now.addDays(-40)};
+    DeletedObject recent{QUuid::createUuid(), now.addDays(-5)};
+    db.addDeletedObject(old);
+    db.addDeletedObject(recent);
+
+    // deleted objects are kept forever by default
+    QCOMPARE(db.deletedObjectsMaxAge(), 0);
+    QCOMPARE(db.compactDeletedObjects(), 0);
+    QCOMPARE(db.deletedObjects().size(), 2);
+
+    db.setDeletedObjectsMaxAge(30);
+    QCOMPARE(db.compactDeletedObjects(), 1);
+    QCOMPARE(db.deletedObjects().size(), 1);
+    QCOMPARE(db.deletedObjects().at(0).uuid, recent.uuid);
+    QVERIFY(!db.containsDeletedObject(old.uuid));
+    QVERIFY(db.containsDeletedObject(recent.uuid));
+
+    QCOMPARE(db.compactDeletedObjects(), 0);
+}
@@ -20,9 +20,11 @@
 
 #include "TestEntry.h"
 #include "TestGlobal.h"
+#include "core/AttachmentStore.h"
 #include "core/Clock.h"
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
+#include "crypto/Random.h"
 
 QTEST_GUILESS_MAIN(TestEntry)
 
@@ -46,6 +48,46 @@ void TestEntry::testHistoryItemDeletion()
     QVERIFY(historyEntry.isNull());
 }
 
+void TestEntry::testHistorySnapshots()
+{
+    QScopedPointer<Entry> entry(new Entry());
+    entry->setTitle("first");
+    entry->attachments()->set("a", QByteArray("attachment"));
+
+    entry->beginUpdate();
+    entry->setTitle("second");
+    QVERIFY(entry->endUpdate());
+    entry->beginUpdate();
+    entry->setTitle("third");
+    QVERIFY(entry->endUpdate());
+
+    const QList<EntrySnapshot> history = entry->historySnapshots();
+    QCOMPARE(history.size(), 2);
+    QCOMPARE(history.at(0).attributeValue(EntryAttributes::TitleKey), QString("first"));
+    QCOMPARE(history.at(1).attributeValue(EntryAttributes::TitleKey), QString("second"));
+    QVERIFY(history.at(0).attachments() == history.at(1).attachments());
+    QCOMPARE(history.at(0).uuid(), entry->uuid());
+
+    // snapshots are shared by clones that keep the history
+    QScopedPointer<Entry> clone(entry->clone(Entry::CloneIncludeHistory));
+    QVERIFY(clone->equals(entry.data()));
+    QCOMPARE(clone->historySnapshots().size(), 2);
+
+    // changes to materialized history items are kept
+    const QList<Entry*> historyItems = entry->historyItems();
+    QCOMPARE(historyItems.size(), 2);
+    QCOMPARE(historyItems.at(1)->title(), QString("second"));
+    QCOMPARE(historyItems.at(0)->attachments()->value("a"), QByteArray("attachment"));
+    historyItems.at(0)->setTitle("changed");
+    QCOMPARE(entry->historySnapshots().at(0).attributeValue(EntryAttributes::TitleKey), QString("changed"));
+    QCOMPARE(entry->historyItems(), historyItems);
+    QVERIFY(!clone->equals(entry.data()));
+
+    entry->removeHistoryItems({historyItems.at(0)});
+    QCOMPARE(entry->historySnapshots().size(), 1);
+    QCOMPARE(entry->historyItems().at(0)->title(), QString("second"));
+}
+
 void TestEntry::testCopyDataFrom()
 {
     QScopedPointer<Entry> entry(new Entry());
@@ -81,6 +123,139 @@ void TestEntry::testCopyDataFrom()
     QCOMPARE(entry2->autoTypeAssociations()->get(1).window, QString("3"));
 }
 
+void TestEntry::testAttributeStorage()
+{
+    Entry entry;
+    EntryAttributes* attributes = entry.attributes();
+    attributes->set("b", "2");
+    attributes->set("Z", "1", true);
+    attributes->set("Secret", "3");
+    entry.setTitle("Title");
+    attributes->set(EntryAttributes::PasswordKey, "Password", true);
+
+    // the keys are sorted like in a QMap
+    QCOMPARE(attributes->keys(),
+             QList<QString>({"Notes", "Password", "Secret", "Title", "URL", "UserName", "Z", "b"}));
+    QCOMPARE(attributes->customKeys(), QList<QString>({"Secret", "Z", "b"}));
+    QVERIFY(attributes->hasKey("Title"));
+    QVERIFY(attributes->hasKey("b"));
+    QVERIFY(!attributes->hasKey("a"));
+    QCOMPARE(attributes->value("b"), QString("2"));
+    QCOMPARE(attributes->value("a"), QString());
+    QVERIFY(attributes->containsValue("Title"));
+    QVERIFY(attributes->containsValue("3"));
+    QVERIFY(!attributes->containsValue("4"));
+
+    QVERIFY(attributes->isProtected("Password"));
+    QVERIFY(attributes->isProtected("Z"));
+    QVERIFY(!attributes->isProtected("Title"));
+    QVERIFY(!attributes->isProtected("b"));
+    attributes->set("Secret", "3", true);
+    QVERIFY(attributes->isProtected("Secret"));
+    attributes->set(EntryAttributes::PasswordKey, "Password", false);
+    QVERIFY(!attributes->isProtected("Password"));
+
+    attributes->rename("Secret", "A");
+    QCOMPARE(attributes->customKeys(), QList<QString>({"A", "Z", "b"}));
+    QCOMPARE(attributes->value("A"), QString("3"));
+    QVERIFY(attributes->isProtected("A"));
+    QVERIFY(!attributes->hasKey("Secret"));
+
+    attributes->remove("Z");
+    QCOMPARE(attributes->customKeys(), QList<QString>({"A", "b"}));
+    QCOMPARE(attributes->attributesSize(), QString("TitleTitleUserNamePasswordPasswordURLNotesA3b2").size());
+
+    // copies share the data until one of them is modified
+    Entry copy;
+    copy.attributes()->copyDataFrom(attributes);
+    QVERIFY(*copy.attributes() == *attributes);
+    QVERIFY(!copy.attributes()->areCustomKeysDifferent(attributes));
+    copy.attributes()->set("b", "4");
+    QCOMPARE(attributes->value("b"), QString("2"));
+    QVERIFY(*copy.attributes() != *attributes);
+    QVERIFY(copy.attributes()->areCustomKeysDifferent(attributes));
+    copy.attributes()->copyCustomKeysFrom(attributes);
+    QVERIFY(*copy.attributes() == *attributes);
+}
+
+void TestEntry::testAttachmentSpill()
+{
+    auto store = AttachmentStore::instance();
+    store->setSpillThreshold(16);
+
+    const QByteArray small("123");
+    const QByteArray large = randomGen()->randomArray(4096);
+
+    QScopedPointer<Entry> entry(new Entry());
+    entry->attachments()->set("small", small);
+    entry->attachments()->set("large", large);
+
+    QCOMPARE(entry->attachments()->value("small"), small);
+    QCOMPARE(entry->attachments()->value("large"), large);
+    QCOMPARE(entry->attachments()->attachmentsSize(), 5 + small.size() + 5 + large.size());
+
+    // evict all decrypted data, values must be read back from the spill file
+    store->setCacheSize(0);
+    store->setCacheSize(AttachmentStore::DefaultCacheSize);
+    QCOMPARE(entry->attachments()->value("large"), large);
+
+    QScopedPointer<Entry> entry2(new Entry());
+    entry2->copyDataFrom(entry.data());
+    QVERIFY(*entry2->attachments() == *entry->attachments());
+    QCOMPARE(entry2->attachments()->value("large"), large);
+
+    QByteArray modified = large;
+    modified[0] = static_cast<char>(modified[0] ^ 0xFF);
+    entry2->attachments()->set("large", modified);
+    QVERIFY(*entry2->attachments() != *entry->attachments());
+    QCOMPARE(entry2->attachments()->value("large"), modified);
+    QCOMPARE(entry->attachments()->value("large"), large);
+
+    // the space of released attachments is reused
+    const qint64 spillFileSize = store->spillFileSize();
+    for (int i = 0; i < 10; ++i) {
+        const QByteArray data = randomGen()->randomArray(large.size());
+        entry2->attachments()->set("large", data);
+        QCOMPARE(entry2->attachments()->value("large"), data);
+        QVERIFY(store->spillFileSize() <= spillFileSize + large.size());
+    }
+    QCOMPARE(entry->attachments()->value("large"), large);
+
+    store->setSpillThreshold(AttachmentStore::DefaultSpillThreshold);
+}
+
+void TestEntry::testAttachmentDeduplication()
+{
+    auto store = AttachmentStore::instance();
+    const int count = store->count();
+    const QByteArray data = randomGen()->randomArray(1024);
+
+    QScopedPointer<Entry> entry1(new Entry());
+    entry1->attachments()->set("a", data);
+    entry1->attachments()->set("b", data);
+    QCOMPARE(store->count(), count + 1);
+    QCOMPARE(entry1->attachments()->digest("a"), entry1->attachments()->digest("b"));
+    QCOMPARE(entry1->attachments()->digests().size(), 1);
+
+    QScopedPointer<Entry> entry2(new Entry());
+    entry2->attachments()->set("c", QByteArray(data));
+    QScopedPointer<Entry> clone(entry1->clone(Entry::CloneNoFlags));
+    QCOMPARE(store->count(), count + 1);
+    QCOMPARE(entry2->attachments()->digest("c"), entry1->attachments()->digest("a"));
+
+    entry1->attachments()->set("b", QByteArray("other"));
+    QCOMPARE(store->count(), count + 2);
+    QVERIFY(entry1->attachments()->digest("a") != entry1->attachments()->digest("b"));
+
+    entry1.reset();
+    clone.reset();
+    QCOMPARE(store->count(), count + 1);
+    QCOMPARE(entry2->attachments()->value("c"), data);
+
+    entry2.reset();
+    QCOMPARE(store->count(), count);
+}
+
 void TestEntry::testClone()
 {
     QScopedPointer<Entry> entryOrg(new Entry());
@@ -441,6 +616,65 @@ void TestEntry::testResolveReferencePlaceholders()
              entry3->attributes()->value("AttributeNotes"));
 }
 
+void TestEntry::testResolveReferenceIndex()
+{
+    Database db;
+    auto* root = db.rootGroup();
+
+    auto* group = new Group();
+    group->setParent(root);
+    auto* entry1 = new Entry();
+    entry1->setGroup(group);
+    entry1->setUuid(QUuid::createUuid());
+    entry1->setTitle("Title");
+    entry1->setUsername("Username1");
+
+    auto* entry2 = new Entry();
+    entry2->setGroup(root);
+    entry2->setUuid(QUuid::createUuid());
+    entry2->setTitle("Title");
+    entry2->setUsername("Username2");
+
+    auto* tstEntry = new Entry();
+    tstEntry->setGroup(root);
+    tstEntry->setUuid(QUuid::createUuid());
+
+    // the entries of a group are searched before those of its subgroups
+    const QString reference("{REF:U@T:Title}");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username2"));
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username2"));
+
+    entry2->setUsername("Username3");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username3"));
+
+    entry2->setTitle("Other");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username1"));
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:U@T:Other}"), QString("Username3"));
+
+    entry2->setTitle("Title");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username3"));
+
+    // moving an entry changes which one is found first
+    entry1->setGroup(root);
+    entry2->setGroup(group);
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username1"));
+
+    delete entry1;
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username3"));
+
+    auto* entry3 = new Entry();
+    entry3->setUuid(QUuid::createUuid());
+    entry3->setTitle("Title");
+    entry3->setUsername("Username4");
+    entry3->setGroup(root);
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(reference), QString("Username4"));
+
+    entry3->attributes()->set("Custom", "Value");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:U@O:Value}"), QString("Username4"));
+    entry3->attributes()->remove("Custom");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:U@O:Value}"), QString());
+}
+
 void TestEntry::testResolveNonIdPlaceholdersToUuid()
 {
     Database db;
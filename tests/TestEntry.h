@@ -29,12 +29,17 @@ class TestEntry : public QObject
 private slots:
     void initTestCase();
     void testHistoryItemDeletion();
+    void testHistorySnapshots();
     void testCopyDataFrom();
+    void testAttributeStorage();
+    void testAttachmentSpill();
+    void testAttachmentDeduplication();
     void testClone();
     void testResolveUrl();
     void testResolveUrlPlaceholders();
     void testResolveRecursivePlaceholders();
     void testResolveReferencePlaceholders();
+    void testResolveReferenceIndex();
     void testResolveNonIdPlaceholdersToUuid();
     void testResolveClonedEntry();
     void testIsRecycled();
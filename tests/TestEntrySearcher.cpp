@@ -18,6 +18,10 @@
 #include "TestEntrySearcher.h"
 #include "TestGlobal.h"
 
+#include "core/Database.h"
+#include "core/EntrySearchIndex.h"
+#include "core/Tools.h"
+
 QTEST_GUILESS_MAIN(TestEntrySearcher)
 
 void TestEntrySearcher::init()
@@ -370,3 +374,199 @@ void TestEntrySearcher::testSkipProtected()
         m_entrySearcher.search("_testAttribute:testE1 _testProtected:apple _testAttribute:testE2", m_rootGroup);
     QCOMPARE(m_searchResult, {});
 }
+
+void TestEntrySearcher::testSearchIndex()
+{
+    Database db;
+    Group* root = db.rootGroup();
+    Group* group = new Group();
+    group->setParent(root);
+
+    Entry* e1 = new Entry();
+    e1->setUuid(QUuid::createUuid());
+    e1->setTitle("Online Banking");
+    e1->setUrl("https://bank.example.com");
+    e1->setGroup(root);
+
+    Entry* e2 = new Entry();
+    e2->setTitle("Mail");
+    e2->setUsername("banker");
+    e2->setGroup(group);
+
+    // the title is only known after resolving the reference
+    Entry* e3 = new Entry();
+    e3->setTitle(QString("{REF:T@I:%1}").arg(e1->uuidToHex()));
+    e3->setGroup(group);
+
+    Entry* e4 = new Entry();
+    e4->setTitle("Other");
+    e4->attributes()->set("Account", "Savings bank");
+    e4->attributes()->set("Pin", "1234", true);
+    e4->setGroup(root);
+
+    m_searchResult = m_entrySearcher.search("bank", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e1, e2, e3}));
+    m_searchResult = m_entrySearcher.search("BAN", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e1, e2, e3}));
+    m_searchResult = m_entrySearcher.search("bank mail", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e2}));
+    m_searchResult = m_entrySearcher.search("-bank", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e4}));
+    m_searchResult = m_entrySearcher.search("attribute:savings", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e4}));
+    // protected values are not indexed but still searched
+    m_searchResult = m_entrySearcher.search("attribute:123", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e4}));
+    m_searchResult = m_entrySearcher.search("bank", group);
+    QCOMPARE(m_searchResult, QList<Entry*>({e2, e3}));
+
+    // modified entries are indexed again
+    e2->setUsername("someone");
+    e4->setNotes("bank statements");
+    m_searchResult = m_entrySearcher.search("bank", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e1, e4, e3}));
+
+    delete e1;
+    m_searchResult = m_entrySearcher.search("bank", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e4}));
+
+    // terms without literals of three characters are matched against every entry
+    m_searchResult = m_entrySearcher.search("b*k", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e4}));
+
+    // an index built ahead of time is kept up to date as well
+    db.searchIndex()->build(root);
+    Entry* e5 = new Entry();
+    e5->setTitle("Bankside");
+    e5->setGroup(root);
+    m_searchResult = m_entrySearcher.search("bank", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({e4, e5}));
+
+    QCOMPARE(EntrySearchIndex::literals(Tools::convertToRegex("foo*bar?baz", true, false, false)),
+             QStringList({"foo", "bar", "baz"}));
+    QCOMPARE(EntrySearchIndex::literals(Tools::convertToRegex("a.b", true, true, false)), QStringList({"a.b"}));
+    QCOMPARE(EntrySearchIndex::literals(Tools::convertToRegex("foo|bar", true, false, false)), QStringList());
+    QCOMPARE(EntrySearchIndex::literals(Tools::convertToRegex("\\d+", false, false, false)), QStringList());
+}
+
+void TestEntrySearcher::testPrepare()
+{
+    Database db;
+    Group* root = db.rootGroup();
+    Group* group = new Group();
+    group->setParent(root);
+    group->setSearchingEnabled(Group::Disable);
+
+    for (int i = 0; i < 10; ++i) {
+        Entry* entry = new Entry();
+        entry->setTitle(QString("Entry %1").arg(i));
+        entry->setGroup(i % 3 == 0 ? group : root);
+        if (i % 2 == 0 && i % 3 != 0) {
+            entry->setNotes("match");
+        }
+    }
+
+    // searching the prepared entries in batches gives the same results as a full search
+    const QList<Entry*> candidates = m_entrySearcher.prepare("notes:match", root);
+    QList<Entry*> results;
+    for (int i = 0; i < candidates.size(); i += 3) {
+        results.append(m_entrySearcher.repeatEntries(candidates.mid(i, 3)));
+    }
+    QCOMPARE(results.size(), 3);
+    QCOMPARE(results, m_entrySearcher.search("notes:match", root));
+}
+
+void TestEntrySearcher::testRefinement()
+{
+    Database db;
+    Group* root = db.rootGroup();
+
+    Entry* github = new Entry();
+    github->setTitle("GitHub");
+    github->setGroup(root);
+
+    Entry* gitlab = new Entry();
+    gitlab->setTitle("GitLab");
+    gitlab->setGroup(root);
+
+    Entry* gitea = new Entry();
+    gitea->setTitle("Gitea");
+    gitea->setGroup(root);
+
+    m_searchResult = m_entrySearcher.search("git", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({github, gitlab, gitea}));
+    m_searchResult = m_entrySearcher.search("gith", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({github}));
+    QCOMPARE(m_entrySearcher.m_lastSearch.matches, QList<Entry*>({github}));
+    // a broader query searches everything again
+    m_searchResult = m_entrySearcher.search("git", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({github, gitlab, gitea}));
+
+    // entries modified in the meantime are found
+    gitea->setTitle("GitHub Enterprise");
+    m_searchResult = m_entrySearcher.search("githu", root);
+    QCOMPARE(m_searchResult, QList<Entry*>({github, gitea}));
+
+    auto parse = [this](const QString& searchString) {
+        m_entrySearcher.parseSearchTerms(searchString);
+        return m_entrySearcher.m_searchTerms;
+    };
+    const auto previous = parse("git -lab");
+    QVERIFY(EntrySearcher::isRefinement(previous, parse("git -lab")));
+    QVERIFY(EntrySearcher::isRefinement(previous, parse("github -lab")));
+    QVERIFY(EntrySearcher::isRefinement(previous, parse("GIT -lab title:hub")));
+    QVERIFY(!EntrySearcher::isRefinement(previous, parse("git -labs")));
+    QVERIFY(!EntrySearcher::isRefinement(previous, parse("gi -lab")));
+    QVERIFY(!EntrySearcher::isRefinement(previous, parse("git")));
+    QVERIFY(!EntrySearcher::isRefinement(previous, parse("g*t -lab")));
+    QVERIFY(!EntrySearcher::isRefinement(previous, parse("title:git -lab")));
+    QVERIFY(!EntrySearcher::isRefinement(parse("+git"), parse("+github")));
+}
+
+void TestEntrySearcher::testParallelSearch()
+{
+    Database db;
+    Group* root = db.rootGroup();
+
+    Entry* referenced = new Entry();
+    referenced->setUuid(QUuid::createUuid());
+    referenced->setTitle("Referenced");
+    referenced->setGroup(root);
+
+    QList<Group*> groups;
+    for (int i = 0; i < 10; ++i) {
+        Group* group = new Group();
+        group->setName(QString("Group %1").arg(i));
+        group->setParent(root);
+        groups.append(group);
+    }
+
+    // enough entries to be searched in parallel, some of them resolve references
+    for (int i = 0; i < 3000; ++i) {
+        Entry* entry = new Entry();
+        entry->setUuid(QUuid::createUuid());
+        if (i % 7 == 0) {
+            entry->setTitle(QString("{REF:T@I:%1} %2").arg(referenced->uuidToHex()).arg(i));
+        } else {
+            entry->setTitle(QString("Entry %1").arg(i));
+        }
+        entry->setGroup(groups.at(i % groups.size()));
+    }
+
+    const QList<Entry*> entries = root->entriesRecursive();
+    const QStringList searchStrings{"referenced", "entry 1", "-entry", "group:\"group 3\" 7"};
+    for (const QString& searchString : searchStrings) {
+        m_entrySearcher.parseSearchTerms(searchString);
+        QList<Entry*> expected;
+        for (Entry* entry : entries) {
+            if (m_entrySearcher.searchEntryImpl(entry)) {
+                expected.append(entry);
+            }
+        }
+        QCOMPARE(m_entrySearcher.repeatEntries(entries), expected);
+    }
+
+    m_searchResult = m_entrySearcher.search("referenced", root);
+    QCOMPARE(m_searchResult.size(), 430);
+    QCOMPARE(m_searchResult.first(), referenced);
+}
@@ -38,6 +38,10 @@ private slots:
     void testCustomAttributesAreSearched();
     void testGroup();
     void testSkipProtected();
+    void testSearchIndex();
+    void testPrepare();
+    void testRefinement();
+    void testParallelSearch();
 
 private:
     Group* m_rootGroup;
@@ -554,6 +554,122 @@ void TestGroup::testFindEntry()
     QVERIFY(!entry);
 }
 
+void TestGroup::testFindByUuid()
+{
+    QScopedPointer<Database> db(new Database());
+    QScopedPointer<Database> db2(new Database());
+
+    auto group1 = new Group();
+    group1->setUuid(QUuid::createUuid());
+    group1->setParent(db->rootGroup());
+    auto group2 = new Group();
+    group2->setUuid(QUuid::createUuid());
+    group2->setParent(group1);
+
+    auto entry = new Entry();
+    entry->setUuid(QUuid::createUuid());
+    entry->setGroup(group2);
+
+    QCOMPARE(db->rootGroup()->findEntryByUuid(entry->uuid()), entry);
+    QCOMPARE(group1->findEntryByUuid(entry->uuid()), entry);
+    QVERIFY(!group1->findEntryByUuid(entry->uuid(), false));
+    QCOMPARE(group2->findEntryByUuid(entry->uuid(), false), entry);
+    QCOMPARE(db->rootGroup()->findGroupByUuid(group2->uuid()), group2);
+    QCOMPARE(group2->findGroupByUuid(group2->uuid()), group2);
+    QVERIFY(!group2->findGroupByUuid(group1->uuid()));
+
+    // the index follows uuid changes
+    const QUuid oldUuid = entry->uuid();
+    entry->setUuid(QUuid::createUuid());
+    QVERIFY(!db->rootGroup()->findEntryByUuid(oldUuid));
+    QCOMPARE(db->rootGroup()->findEntryByUuid(entry->uuid()), entry);
+    group2->setUuid(QUuid::createUuid());
+    QCOMPARE(db->rootGroup()->findGroupByUuid(group2->uuid()), group2);
+
+    // and moves between groups and databases
+    entry->setGroup(db->rootGroup());
+    QVERIFY(!group1->findEntryByUuid(entry->uuid()));
+    QCOMPARE(db->rootGroup()->findEntryByUuid(entry->uuid(), false), entry);
+
+    group1->setParent(db2->rootGroup());
+    QVERIFY(!db->rootGroup()->findGroupByUuid(group2->uuid()));
+    QCOMPARE(db2->rootGroup()->findGroupByUuid(group2->uuid()), group2);
+
+    const QUuid groupUuid = group2->uuid();
+    delete group1;
+    QVERIFY(!db2->rootGroup()->findGroupByUuid(groupUuid));
+
+    const QUuid entryUuid = entry->uuid();
+    delete entry;
+    QVERIFY(!db->rootGroup()->findEntryByUuid(entryUuid));
+}
+
+void TestGroup::testRecursiveViews()
+{
+    QScopedPointer<Database> db(new Database());
+    Group* root = db->rootGroup();
+
+    auto group1 = new Group();
+    group1->setParent(root);
+    auto group2 = new Group();
+    group2->setParent(group1);
+    auto group3 = new Group();
+    group3->setParent(root);
+
+    auto entry1 = new Entry();
+    entry1->setGroup(root);
+    auto entry2 = new Entry();
+    entry2->setGroup(group2);
+    auto entry3 = new Entry();
+    entry3->setGroup(group1);
+
+    QCOMPARE(root->groupsRecursive(true), QList<Group*>({root, group1, group2, group3}));
+    QCOMPARE(root->groupsRecursive(false), QList<Group*>({group1, group2, group3}));
+    QCOMPARE(root->entriesRecursive(), QList<Entry*>({entry1, entry3, entry2}));
+    QCOMPARE(group1->entriesRecursive(), QList<Entry*>({entry3, entry2}));
+
+    // the views follow changes anywhere in the subtree
+    auto entry4 = new Entry();
+    entry4->setGroup(group2);
+    QCOMPARE(root->entriesRecursive(), QList<Entry*>({entry1, entry3, entry2, entry4}));
+    group2->moveEntryUp(entry4);
+    QCOMPARE(root->entriesRecursive(), QList<Entry*>({entry1, entry3, entry4, entry2}));
+
+    group2->setParent(group3);
+    QCOMPARE(root->groupsRecursive(true), QList<Group*>({root, group1, group3, group2}));
+    QCOMPARE(root->entriesRecursive(), QList<Entry*>({entry1, entry3, entry4, entry2}));
+    QCOMPARE(group1->entriesRecursive(), QList<Entry*>({entry3}));
+    QCOMPARE(group3->entriesRecursive(), QList<Entry*>({entry4, entry2}));
+
+    entry3->setGroup(group2);
+    QCOMPARE(root->entriesRecursive(), QList<Entry*>({entry1, entry4, entry2, entry3}));
+    QVERIFY(group1->entriesRecursive().isEmpty());
+
+    delete entry4;
+    QCOMPARE(root->entriesRecursive(), QList<Entry*>({entry1, entry2, entry3}));
+
+    group3->setName("A");
+    group1->setName("B");
+    root->sortChildrenRecursively();
+    QCOMPARE(root->groupsRecursive(true), QList<Group*>({root, group3, group2, group1}));
+
+    delete group3;
+    QCOMPARE(root->groupsRecursive(true), QList<Group*>({root, group1}));
+    QCOMPARE(root->entriesRecursive(), QList<Entry*>({entry1}));
+
+    // groups outside of a database
+    QScopedPointer<Group> group4(new Group());
+    auto group5 = new Group();
+    group5->setParent(group4.data());
+    auto entry5 = new Entry();
+    entry5->setGroup(group5);
+    QCOMPARE(group4->entriesRecursive(), QList<Entry*>({entry5}));
+    group1->setParent(group5);
+    QCOMPARE(group4->groupsRecursive(true), QList<Group*>({group4.data(), group5, group1}));
+    QCOMPARE(group4->entriesRecursive(), QList<Entry*>({entry5}));
+    QCOMPARE(root->groupsRecursive(true), QList<Group*>({root}));
+}
+
 void TestGroup::testFindGroupByPath()
 {
     QScopedPointer<Database> db(new Database());
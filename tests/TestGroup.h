@@ -38,6 +38,8 @@ private slots:
     void testClone();
     void testCopyCustomIcons();
     void testFindEntry();
+    void testFindByUuid();
+    void testRecursiveViews();
     void testFindGroupByPath();
     void testPrint();
     void testLocate();
@@ -22,7 +22,9 @@
 
 #include "FailDevice.h"
 #include "crypto/Crypto.h"
+#include "crypto/Random.h"
 #include "streams/HashedBlockStream.h"
+#include "streams/HmacBlockStream.h"
 
 QTEST_GUILESS_MAIN(TestHashedBlockStream)
 
@@ -102,3 +104,51 @@ void TestHashedBlockStream::testWriteFailure()
     QVERIFY(!writer.reset());
     QCOMPARE(writer.errorString(), QString("FAILDEVICE"));
 }
+
+void TestHashedBlockStream::testHmacReadAhead()
+{
+    QByteArray key = randomGen()->randomArray(64);
+    QByteArray input = randomGen()->randomArray(10000);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+
+    HmacBlockStream writer(&buffer, key, 512);
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+    QCOMPARE(writer.write(input), qint64(input.size()));
+    writer.close();
+
+    buffer.reset();
+    HmacBlockStream reader(&buffer, key);
+    reader.setReadAhead(4);
+    QVERIFY(reader.open(QIODevice::ReadOnly));
+    QCOMPARE(reader.read(3000), input.left(3000));
+    QCOMPARE(reader.read(input.size()), input.mid(3000));
+    QCOMPARE(reader.read(1).size(), 0);
+    QVERIFY(reader.atEnd());
+}
+
+void TestHashedBlockStream::testHmacReadAheadCorrupted()
+{
+    QByteArray key = randomGen()->randomArray(64);
+    QByteArray input = randomGen()->randomArray(10000);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+
+    HmacBlockStream writer(&buffer, key, 512);
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+    QCOMPARE(writer.write(input), qint64(input.size()));
+    writer.close();
+
+    // corrupt the data of the third block
+    const int blockOffset = 2 * (32 + 4 + 512) + 32 + 4;
+    buffer.buffer()[blockOffset] = static_cast<char>(buffer.buffer().at(blockOffset) ^ 0xFF);
+
+    buffer.reset();
+    HmacBlockStream reader(&buffer, key);
+    reader.setReadAhead(4);
+    QVERIFY(reader.open(QIODevice::ReadOnly));
+    QCOMPARE(reader.read(input.size()).size(), 0);
+    QCOMPARE(reader.errorString(), QString("Mismatch between hash and data."));
+}
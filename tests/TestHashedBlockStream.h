@@ -29,6 +29,8 @@ private slots:
     void testWriteRead();
     void testReset();
     void testWriteFailure();
+    void testHmacReadAhead();
+    void testHmacReadAheadCorrupted();
 };
 
 #endif // KEEPASSX_TESTHASHEDBLOCKSTREAM_H
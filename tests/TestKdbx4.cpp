@@ -20,6 +20,8 @@
 
 #include "config-keepassx-tests.h"
 #include "core/Metadata.h"
+#include "crypto/Random.h"
+#include "format/KdbxXmlEntryCache.h"
 #include "format/KdbxXmlReader.h"
 #include "format/KdbxXmlWriter.h"
 #include "format/KeePass2.h"
@@ -29,6 +31,44 @@
 #include "keys/PasswordKey.h"
 #include "mock/MockChallengeResponseKey.h"
 
+namespace
+{
+    QSharedPointer<Database> createPayloadDatabase(int entryCount, int attachmentSize)
+    {
+        auto db = QSharedPointer<Database>::create();
+        for (int i = 0; i < entryCount; ++i) {
+            auto* entry = new Entry();
+            entry->setUuid(QUuid::createUuid());
+            entry->setTitle(QString("Entry %1").arg(i));
+            entry->setUsername(QString("user%1").arg(i));
+            entry->setPassword(QString::fromLatin1(randomGen()->randomArray(16).toHex()));
+            entry->attributes()->set("Secret", QString("secret %1").arg(i), true);
+            entry->attachments()->set(QString("attachment%1.bin").arg(i), randomGen()->randomArray(attachmentSize));
+            entry->setGroup(db->rootGroup());
+        }
+        return db;
+    }
+
+    QByteArray writeAndExtract(Database* db, QSharedPointer<CompositeKey> key)
+    {
+        QBuffer buffer;
+        buffer.open(QBuffer::ReadWrite);
+        KeePass2Writer writer;
+        if (!writer.writeDatabase(&buffer, db)) {
+            return {};
+        }
+
+        buffer.seek(0);
+        KeePass2Reader reader;
+        auto readDb = QSharedPointer<Database>::create();
+        QByteArray xml;
+        if (!reader.readDatabase(&buffer, key, readDb.data()) || !readDb->extract(xml)) {
+            return {};
+        }
+        return xml;
+    }
+} // namespace
+
 int main(int argc, char* argv[])
 {
     QCoreApplication app(argc, argv);
@@ -444,8 +484,259 @@ void TestKdbx4Argon2::testCustomData()
     QCOMPARE(newEntry->customData()->value(customDataKey2), customData2);
 }
 
+void TestKdbx4Argon2::testBinaryPool()
+{
+    auto db = createPayloadDatabase(4, 256);
+    db->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2D)));
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("test"));
+    QVERIFY(db->setKey(key));
+
+    // identical attachments of several entries share one pool item
+    const QByteArray shared = randomGen()->randomArray(512);
+    const QList<Entry*> entries = db->rootGroup()->entries();
+    for (Entry* entry : entries) {
+        entry->attachments()->set("shared.bin", shared);
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::ReadWrite));
+    KeePass2Writer writer;
+    QVERIFY2(writer.writeDatabase(&buffer, db.data()), qPrintable(writer.errorString()));
+
+    buffer.seek(0);
+    KeePass2Reader reader;
+    auto readDb = QSharedPointer<Database>::create();
+    QVERIFY2(reader.readDatabase(&buffer, key, readDb.data()), qPrintable(reader.errorString()));
+
+    const QList<Entry*> readEntries = readDb->rootGroup()->entries();
+    QCOMPARE(readEntries.size(), entries.size());
+    for (int i = 0; i < readEntries.size(); ++i) {
+        const QString name = QString("attachment%1.bin").arg(i);
+        QCOMPARE(readEntries.at(i)->attachments()->keys(), entries.at(i)->attachments()->keys());
+        QCOMPARE(readEntries.at(i)->attachments()->value(name), entries.at(i)->attachments()->value(name));
+        QCOMPARE(readEntries.at(i)->attachments()->value("shared.bin"), shared);
+    }
+
+    // references out of the pool range are bound to empty attachments
+    auto newUuid = [] { return QString::fromLatin1(QUuid::createUuid().toRfc4122().toBase64()); };
+    const QString xml = QString("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+                                "<KeePassFile><Root><Group><UUID>%1</UUID><Name>Root</Name>"
+                                "<Entry><UUID>%2</UUID><Binary><Key>a</Key><Value Ref=\"0\"/></Binary></Entry>"
+                                "<Entry><UUID>%3</UUID><Binary><Key>b</Key><Value Ref=\"0\"/></Binary>"
+                                "<Binary><Key>c</Key><Value Ref=\"2\"/></Binary></Entry>"
+                                "</Group></Root></KeePassFile>")
+                            .arg(newUuid(), newUuid(), newUuid());
+
+    QHash<int, QByteArray> binaryPool;
+    binaryPool.insert(0, shared);
+    binaryPool.insert(1, QByteArray("unused"));
+
+    QBuffer xmlBuffer;
+    xmlBuffer.setData(xml.toUtf8());
+    QVERIFY(xmlBuffer.open(QIODevice::ReadOnly));
+    KdbxXmlReader xmlReader(KeePass2::FILE_VERSION_4, std::move(binaryPool));
+    auto xmlDb = xmlReader.readDatabase(&xmlBuffer);
+    QVERIFY2(!xmlReader.hasError(), qPrintable(xmlReader.errorString()));
+
+    const QList<Entry*> xmlEntries = xmlDb->rootGroup()->entries();
+    QCOMPARE(xmlEntries.size(), 2);
+    QCOMPARE(xmlEntries.at(0)->attachments()->value("a"), shared);
+    QCOMPARE(xmlEntries.at(1)->attachments()->value("b"), shared);
+    QVERIFY(xmlEntries.at(1)->attachments()->hasKey("c"));
+    QVERIFY(xmlEntries.at(1)->attachments()->value("c").isEmpty());
+    QCOMPARE(xmlEntries.at(0)->attachments()->digest("a"), xmlEntries.at(1)->attachments()->digest("b"));
+}
+
+void TestKdbx4Argon2::testPipelinedRead()
+{
+    QFETCH(QUuid, cipherUuid);
+    QFETCH(bool, compressed);
+
+    // enough payload for several HMAC blocks
+    auto sourceDb = createPayloadDatabase(48, 64 * 1024);
+    sourceDb->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2D)));
+    sourceDb->setCipher(cipherUuid);
+    sourceDb->setCompressionAlgorithm(compressed ? Database::CompressionGZip : Database::CompressionNone);
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("test"));
+    QVERIFY(sourceDb->setKey(key));
+
+    QBuffer buffer;
+    buffer.open(QBuffer::ReadWrite);
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, sourceDb.data()));
+
+    KeePass2Reader sequentialReader;
+    auto sequentialDb = QSharedPointer<Database>::create();
+    QVERIFY(sequentialReader.readDatabase(&buffer, key, sequentialDb.data()));
+    QVERIFY(!sequentialReader.hasError());
+
+    KeePass2Reader pipelinedReader;
+    pipelinedReader.setPipelined(true);
+    auto pipelinedDb = QSharedPointer<Database>::create();
+    QVERIFY(pipelinedReader.readDatabase(&buffer, key, pipelinedDb.data()));
+    QVERIFY(!pipelinedReader.hasError());
+
+    QCOMPARE(pipelinedDb->rootGroup()->entries().size(), 48);
+
+    QByteArray sequentialXml;
+    QByteArray pipelinedXml;
+    QVERIFY(sequentialDb->extract(sequentialXml));
+    QVERIFY(pipelinedDb->extract(pipelinedXml));
+    QCOMPARE(pipelinedXml, sequentialXml);
+}
+
+void TestKdbx4Argon2::testPipelinedRead_data()
+{
+    QTest::addColumn<QUuid>("cipherUuid");
+    QTest::addColumn<bool>("compressed");
+
+    QTest::newRow("AES-256 / GZip") << KeePass2::CIPHER_AES256 << true;
+    QTest::newRow("AES-256 / None") << KeePass2::CIPHER_AES256 << false;
+    QTest::newRow("ChaCha20 / GZip") << KeePass2::CIPHER_CHACHA20 << true;
+    QTest::newRow("ChaCha20 / None") << KeePass2::CIPHER_CHACHA20 << false;
+}
+
+void TestKdbx4Argon2::testPipelinedReadCorrupted()
+{
+    auto sourceDb = createPayloadDatabase(48, 64 * 1024);
+    sourceDb->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2D)));
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("test"));
+    QVERIFY(sourceDb->setKey(key));
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::WriteOnly);
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, sourceDb.data()));
+    buffer.close();
+
+    // flip a byte inside the last payload block
+    data[data.size() - 1024] = static_cast<char>(data.at(data.size() - 1024) ^ 0xFF);
+
+    buffer.open(QBuffer::ReadOnly);
+    KeePass2Reader reader;
+    reader.setPipelined(true);
+    auto db = QSharedPointer<Database>::create();
+    QVERIFY(!reader.readDatabase(&buffer, key, db.data()));
+    QVERIFY(reader.hasError());
+}
+
+void TestKdbx4Argon2::benchmarkPipelinedRead()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(bool, pipelined);
+
+    auto sourceDb = createPayloadDatabase(256, 256 * 1024);
+    sourceDb->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2D)));
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("test"));
+    QVERIFY(sourceDb->setKey(key));
+
+    QBuffer buffer;
+    buffer.open(QBuffer::ReadWrite);
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, sourceDb.data()));
+
+    QBENCHMARK
+    {
+        KeePass2Reader reader;
+        reader.setPipelined(pipelined);
+        auto db = QSharedPointer<Database>::create();
+        QVERIFY(reader.readDatabase(&buffer, key, db.data()));
+    }
+}
+
+void TestKdbx4Argon2::benchmarkPipelinedRead_data()
+{
+    QTest::addColumn<bool>("pipelined");
+
+    QTest::newRow("Sequential") << false;
+    QTest::newRow("Pipelined") << true;
+}
+
+void TestKdbx4Argon2::testEntryCache()
+{
+    auto db = createPayloadDatabase(8, 1024);
+    db->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2D)));
+    auto key = QSharedPointer<CompositeKey>::create();
+    key->addKey(QSharedPointer<PasswordKey>::create("test"));
+    QVERIFY(db->setKey(key));
+
+    Entry* entry = db->rootGroup()->entries().at(3);
+    entry->beginUpdate();
+    entry->setPassword("history");
+    entry->endUpdate();
+    QCOMPARE(entry->historyItems().size(), 1);
+
+    auto cache = db->xmlEntryCache();
+    const QByteArray firstXml = writeAndExtract(db.data(), key);
+    QVERIFY(!firstXml.isEmpty());
+    QCOMPARE(cache->size(), 8);
+
+    // unchanged database is written from the cache
+    QCOMPARE(writeAndExtract(db.data(), key), firstXml);
+
+    // history items are cached with their entry, e.g. when a custom icon is removed
+    const QDateTime lastModified = entry->timeInfo().lastModificationTime();
+    Entry* historyItem = entry->historyItems().at(0);
+    historyItem->setUpdateTimeinfo(false);
+    historyItem->setIcon(7);
+    historyItem->setUpdateTimeinfo(true);
+    QCOMPARE(cache->size(), 7);
+    QCOMPARE(entry->timeInfo().lastModificationTime(), lastModified);
+    QVERIFY(writeAndExtract(db.data(), key).contains("<IconID>7</IconID>"));
+    QCOMPARE(cache->size(), 8);
+
+    entry->setPassword("changed");
+    QCOMPARE(cache->size(), 7);
+
+    auto* group = new Group();
+    group->setUuid(QUuid::createUuid());
+    group->setParent(db->rootGroup());
+    db->rootGroup()->entries().at(5)->setGroup(group);
+
+    const QByteArray cachedXml = writeAndExtract(db.data(), key);
+    QVERIFY(!cachedXml.isEmpty());
+    QVERIFY(cachedXml.contains("changed"));
+    QVERIFY(cachedXml.contains("history"));
+
+    cache->clear();
+    QCOMPARE(writeAndExtract(db.data(), key), cachedXml);
+}
+
 void TestKdbx4AesKdf::initTestCaseImpl()
 {
     m_xmlDb->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_AES_KDBX4)));
     m_kdbxSourceDb->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_AES_KDBX4)));
 }
+
+void TestKdbx4Argon2::benchmarkXmlRead()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    auto sourceDb = createPayloadDatabase(10000, 16);
+    QByteArray xml;
+    QVERIFY(sourceDb->extract(xml));
+
+    QBENCHMARK
+    {
+        QBuffer buffer(&xml);
+        buffer.open(QBuffer::ReadOnly);
+        KdbxXmlReader reader(KeePass2::FILE_VERSION_4);
+        auto db = reader.readDatabase(&buffer);
+        QVERIFY(db);
+        QVERIFY(!reader.hasError());
+    }
+}
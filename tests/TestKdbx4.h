@@ -31,6 +31,14 @@ private slots:
     void testUpgradeMasterKeyIntegrity();
     void testUpgradeMasterKeyIntegrity_data();
     void testCustomData();
+    void testBinaryPool();
+    void testPipelinedRead();
+    void testPipelinedRead_data();
+    void testPipelinedReadCorrupted();
+    void benchmarkPipelinedRead();
+    void benchmarkPipelinedRead_data();
+    void testEntryCache();
+    void benchmarkXmlRead();
 
 protected:
     void initTestCaseImpl() override;
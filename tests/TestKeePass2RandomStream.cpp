@@ -20,11 +20,20 @@
 
 #include "crypto/Crypto.h"
 #include "crypto/CryptoHash.h"
+#include "crypto/Random.h"
 #include "crypto/SymmetricCipher.h"
 #include "format/KeePass2RandomStream.h"
 
 QTEST_GUILESS_MAIN(TestKeePass2RandomStream)
 
+Q_DECLARE_METATYPE(KeePass2::ProtectedStreamAlgo)
+Q_DECLARE_METATYPE(SymmetricCipher::Algorithm)
+
+namespace
+{
+    const QByteArray ChunkedKeystreamKey("\x11\x22\x33\x44\x55\x66\x77\x88");
+} // namespace
+
 void TestKeePass2RandomStream::initTestCase()
 {
     QVERIFY(Crypto::init());
@@ -79,3 +88,53 @@ void TestKeePass2RandomStream::test()
     QCOMPARE(cipherData, cipherDataEncrypt);
     QCOMPARE(randomStreamData, cipherData);
 }
+
+void TestKeePass2RandomStream::testChunkedKeystream()
+{
+    QFETCH(KeePass2::ProtectedStreamAlgo, algo);
+    QFETCH(SymmetricCipher::Algorithm, referenceAlgo);
+    QFETCH(QByteArray, referenceKey);
+    QFETCH(QByteArray, referenceIv);
+
+    const QByteArray data = randomGen()->randomArray(20000);
+
+    SymmetricCipher cipher(referenceAlgo, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+    QVERIFY(cipher.init(referenceKey, referenceIv));
+    bool ok;
+    const QByteArray expected = cipher.process(data, &ok);
+    QVERIFY(ok);
+
+    // values of varying size crossing the internal keystream buffer
+    KeePass2RandomStream randomStream(algo);
+    QVERIFY(randomStream.init(ChunkedKeystreamKey));
+    QByteArray result;
+    int offset = 0;
+    for (int size = 1; offset < data.size(); size = (size * 7 + 3) % 5000) {
+        QByteArray value = data.mid(offset, size);
+        if (size % 2 == 0) {
+            QVERIFY(randomStream.processInPlace(value));
+        } else {
+            value = randomStream.process(value, &ok);
+            QVERIFY(ok);
+        }
+        result.append(value);
+        offset += value.size();
+    }
+
+    QCOMPARE(result, expected);
+}
+
+void TestKeePass2RandomStream::testChunkedKeystream_data()
+{
+    QTest::addColumn<KeePass2::ProtectedStreamAlgo>("algo");
+    QTest::addColumn<SymmetricCipher::Algorithm>("referenceAlgo");
+    QTest::addColumn<QByteArray>("referenceKey");
+    QTest::addColumn<QByteArray>("referenceIv");
+
+    const QByteArray keyIv = CryptoHash::hash(ChunkedKeystreamKey, CryptoHash::Sha512);
+    QTest::newRow("ChaCha20") << KeePass2::ProtectedStreamAlgo::ChaCha20 << SymmetricCipher::ChaCha20
+                              << keyIv.left(32) << keyIv.mid(32, 12);
+    QTest::newRow("Salsa20") << KeePass2::ProtectedStreamAlgo::Salsa20 << SymmetricCipher::Salsa20
+                             << CryptoHash::hash(ChunkedKeystreamKey, CryptoHash::Sha256)
+                             << KeePass2::INNER_STREAM_SALSA20_IV;
+}
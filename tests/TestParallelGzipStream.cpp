@@ -0,0 +1,125 @@
+/*
+ *  Copyright (C) 2021 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestParallelGzipStream.h"
+#include "TestGlobal.h"
+
+#include <QBuffer>
+
+#include "crypto/Crypto.h"
+#include "crypto/Random.h"
+#include "streams/ParallelGzipStream.h"
+#include "streams/QtIOCompressor"
+
+QTEST_GUILESS_MAIN(TestParallelGzipStream)
+
+namespace
+{
+    QByteArray createCompressibleData(int size)
+    {
+        QByteArray data;
+        while (data.size() < size) {
+            data.append(QString("<Entry %1>").arg(data.size()).toLatin1());
+            data.append(randomGen()->randomArray(16).toHex());
+        }
+        data.truncate(size);
+        return data;
+    }
+} // namespace
+
+void TestParallelGzipStream::initTestCase()
+{
+    QVERIFY(Crypto::init());
+}
+
+void TestParallelGzipStream::testWrite()
+{
+    QFETCH(int, size);
+    QFETCH(int, chunkSize);
+
+    const QByteArray data = createCompressibleData(size);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    ParallelGzipStream gzipStream(&buffer, chunkSize, ParallelGzipStream::DefaultCompressionLevel);
+    QVERIFY(gzipStream.open(QIODevice::WriteOnly));
+    for (int i = 0; i < data.size(); i += 1000) {
+        const QByteArray part = data.mid(i, 1000);
+        QCOMPARE(gzipStream.write(part), qint64(part.size()));
+    }
+    QVERIFY(gzipStream.reset());
+
+    // the output is a single regular gzip member
+    buffer.reset();
+    QtIOCompressor compressor(&buffer);
+    compressor.setStreamFormat(QtIOCompressor::GzipFormat);
+    QVERIFY(compressor.open(QIODevice::ReadOnly));
+    QCOMPARE(compressor.readAll(), data);
+    QVERIFY(buffer.atEnd());
+}
+
+void TestParallelGzipStream::testWrite_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow("Single byte") << 1 << ParallelGzipStream::DefaultChunkSize;
+    QTest::newRow("Partial chunk") << 5000 << ParallelGzipStream::DefaultChunkSize;
+    QTest::newRow("Exact chunk") << ParallelGzipStream::DefaultChunkSize << ParallelGzipStream::DefaultChunkSize;
+    QTest::newRow("Several chunks") << 5 * ParallelGzipStream::DefaultChunkSize + 123
+                                    << ParallelGzipStream::DefaultChunkSize;
+    QTest::newRow("Chunks smaller than window") << 100000 << 1024;
+}
+
+void TestParallelGzipStream::benchmarkCompression()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(bool, parallel);
+
+    const QByteArray data = createCompressibleData(16 * 1024 * 1024);
+
+    QBENCHMARK
+    {
+        QBuffer buffer;
+        buffer.open(QBuffer::WriteOnly);
+        if (parallel) {
+            ParallelGzipStream gzipStream(&buffer);
+            QVERIFY(gzipStream.open(QIODevice::WriteOnly));
+            QCOMPARE(gzipStream.write(data), qint64(data.size()));
+            QVERIFY(gzipStream.reset());
+        } else {
+            QtIOCompressor compressor(&buffer);
+            compressor.setStreamFormat(QtIOCompressor::GzipFormat);
+            QVERIFY(compressor.open(QIODevice::WriteOnly));
+            QCOMPARE(compressor.write(data), qint64(data.size()));
+            compressor.close();
+        }
+    }
+}
+
+void TestParallelGzipStream::benchmarkCompression_data()
+{
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("QtIOCompressor") << false;
+    QTest::newRow("Parallel") << true;
+}